@@ -0,0 +1,257 @@
+// Batch renderer object: Renders a list of scenes concurrently, saving each image and writing a summary report
+// By Adam Badke
+
+#include "batchrenderer.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+// STL includes:
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <set>
+
+// Peak memory lookup:
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using std::cout;
+
+// Get the peak resident memory used by the process so far, in bytes. 0 if it is unavailable
+static size_t getPeakMemoryBytes(){
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    #ifdef __APPLE__
+        return usage.ru_maxrss;             // Bytes
+    #else
+        return usage.ru_maxrss * 1024;      // Kilobytes
+    #endif
+#endif
+}
+
+// A single job in a batch: A request, and where its result goes
+struct BatchJob
+{
+    RenderRequest request;
+    string imageFilename;
+    RenderResult result;
+    bool wasSaved = false;
+};
+
+// Renders a batch job and saves its image, on the batch's thread pool
+class BatchJobRunner : public QRunnable
+{
+public:
+    BatchJobRunner(RenderService* newService, BatchJob* newJob){
+        service = newService;
+        job = newJob;
+    }
+
+    void run(){
+        job->result = service->render(job->request);
+        if (!job->result.succeeded)
+            return;
+
+        // The renderer's packed ARGB pixels match QImage's 32 bit format, so the buffer is saved without conversion
+        QImage image((const uchar*)job->result.pixels.data(), job->result.width, job->result.height, job->result.width * (int)sizeof(unsigned int), QImage::Format_RGB32);
+        job->wasSaved = image.save(QString::fromStdString(job->imageFilename));
+
+        job->result.pixels = vector<unsigned int>(); // Release the image: Only the statistics are needed for the report
+    }
+
+private:
+    RenderService* service;
+    BatchJob* job;
+};
+
+// Constructor
+BatchRenderer::BatchRenderer(int maxConcurrentJobs){
+    this->maxConcurrentJobs = maxConcurrentJobs;
+}
+
+// Add every request in a manifest file
+bool BatchRenderer::addManifest(const string& manifestFilename){
+    std::ifstream manifest(manifestFilename);
+    if (!manifest.good()){
+        cout << "Error: Could not open batch manifest " << manifestFilename << "\n";
+        return false;
+    }
+
+    bool isValid = true;
+    string line;
+    int lineNumber = 0;
+    while (std::getline(manifest, line)){
+        lineNumber++;
+
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string::npos || line[start] == '#')
+            continue;
+
+        RenderRequest request;
+        string error;
+        if (RenderRequest::parse(line, &request, &error))
+            addRequest(request);
+        else{
+            cout << "Error: " << manifestFilename << " line " << lineNumber << ": " << error << "\n";
+            isValid = false;
+        }
+    }
+
+    return isValid;
+}
+
+// Add a request for every .simp file matching a wildcard pattern, or for a single scene name
+int BatchRenderer::addScenes(const string& pattern){
+    if (pattern.find_first_of("*?[") == string::npos){
+        RenderRequest request;
+        request.sceneName = pattern;
+        addRequest(request);
+        return 1;
+    }
+
+    QFileInfo patternInfo(QString::fromStdString(pattern));
+    QDir directory = patternInfo.dir();
+    QStringList matches = directory.entryList(QStringList(patternInfo.fileName()), QDir::Files, QDir::Name);
+
+    int numAdded = 0;
+    for (const QString& match : matches){
+        if (!match.endsWith(".simp"))
+            continue;
+
+        RenderRequest request;
+        request.sceneName = directory.filePath(match).toStdString();
+        addRequest(request);
+        numAdded++;
+    }
+
+    if (numAdded == 0)
+        cout << "Warning: No .simp files match " << pattern << "\n";
+
+    return numAdded;
+}
+
+// Add a single request
+void BatchRenderer::addRequest(const RenderRequest& request){
+    requests.push_back(request);
+}
+
+// Render every request
+int BatchRenderer::run(const string& outputDirectory, const string& reportFilename){
+    if (requests.empty()){
+        cout << "Error: Nothing to render\n";
+        return 0;
+    }
+
+    QDir outputDir(QString::fromStdString(outputDirectory));
+    if (!outputDir.mkpath(".")){
+        cout << "Error: Could not create output directory " << outputDirectory << "\n";
+        return (int)requests.size();
+    }
+
+    // Name each job's image after its scene. Scenes requested more than once get a numbered suffix
+    vector<BatchJob> jobs(requests.size());
+    std::set<string> usedNames;
+    for (unsigned int i = 0; i < requests.size(); i++){
+        jobs[i].request = requests[i];
+
+        string baseName = QFileInfo(QString::fromStdString(requests[i].sceneName)).fileName().toStdString();
+        if (baseName.size() > 5 && baseName.compare(baseName.size() - 5, 5, ".simp") == 0)
+            baseName.erase(baseName.size() - 5);
+
+        string name = baseName;
+        for (int suffix = 2; usedNames.count(name) > 0; suffix++)
+            name = baseName + "_" + std::to_string(suffix);
+        usedNames.insert(name);
+
+        jobs[i].imageFilename = outputDir.filePath(QString::fromStdString(name + ".png")).toStdString();
+    }
+
+    // Balance parallelism: Rasterized frames are drawn on a single thread, so the cores go to running separate jobs first.
+    // There's no point running more jobs at once than there are jobs to run. Ray cast jobs share the cores left over for each job between their own threads
+    int numCores = std::max(QThread::idealThreadCount(), 1);
+    int numWorkers = maxConcurrentJobs > 0 ? maxConcurrentJobs : numCores;
+    numWorkers = std::max(1, std::min(numWorkers, (int)jobs.size()));
+
+    int rayCastThreads = std::max(1, numCores / numWorkers);
+    service.setRayCastThreads(rayCastThreads);
+
+    cout << "Batch rendering " << jobs.size() << " scene(s) with " << numWorkers << " concurrent job(s), 1 thread per job (" << rayCastThreads << " for ray cast jobs)\n";
+
+    // Render. Jobs are started in order, so repeated scenes are likely to find their predecessor already cached
+    auto batchStart = std::chrono::steady_clock::now();
+
+    QThreadPool jobPool;
+    jobPool.setMaxThreadCount(numWorkers);
+    for (auto& currentJob : jobs)
+        jobPool.start(new BatchJobRunner(&service, &currentJob));
+    jobPool.waitForDone();
+
+    double batchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batchStart).count();
+
+    // Build the summary report:
+    std::ostringstream report;
+    report << "Job\tScene\tResolution\tScene cached\tLoad (ms)\tRender (ms)\tArena peak (KB)\tArena reserved (KB)\tImage (KB)\tOutput\n";
+
+    int numFailed = 0;
+    double totalJobMilliseconds = 0;
+    for (unsigned int i = 0; i < jobs.size(); i++){
+        const RenderResult& result = jobs[i].result;
+        totalJobMilliseconds += result.loadMilliseconds + result.renderMilliseconds;
+
+        report << i << "\t" << jobs[i].request.sceneName << "\t" << jobs[i].request.width << "x" << jobs[i].request.height << "\t";
+
+        if (!result.succeeded){
+            report << "-\t-\t-\t-\t-\t-\tFailed: " << result.error << "\n";
+            numFailed++;
+            continue;
+        }
+
+        report << (result.wasSceneCached ? "yes" : "no") << "\t" << result.loadMilliseconds << "\t" << result.renderMilliseconds << "\t"
+               << result.frameArenaPeakBytes / 1024 << "\t" << result.frameArenaReservedBytes / 1024 << "\t"
+               << ((size_t)result.width * result.height * sizeof(unsigned int)) / 1024 << "\t";
+
+        if (jobs[i].wasSaved)
+            report << jobs[i].imageFilename << "\n";
+        else{
+            report << "Failed: Could not save " << jobs[i].imageFilename << "\n";
+            numFailed++;
+        }
+    }
+
+    report << "\nJobs:\t" << jobs.size() << " (" << numFailed << " failed), " << numWorkers << " concurrent\n";
+    report << "Wall time:\t" << batchMilliseconds << " ms (" << totalJobMilliseconds << " ms of job time, " << (batchMilliseconds > 0 ? totalJobMilliseconds / batchMilliseconds : 0) << "x parallel speedup)\n";
+    report << "Peak memory:\t" << getPeakMemoryBytes() / (1024 * 1024) << " MB (whole process)\n";
+
+    cout << report.str();
+
+    // Write the report:
+    string reportPath = outputDir.filePath(QString::fromStdString(reportFilename)).toStdString();
+    std::ofstream reportFile(reportPath);
+    if (reportFile.good()){
+        reportFile << report.str();
+        cout << "Report written to " << reportPath << "\n";
+    }
+    else
+        cout << "Error: Could not write report " << reportPath << "\n";
+
+    return numFailed;
+}
@@ -0,0 +1,51 @@
+// Batch renderer object: Renders a list of scenes concurrently, saving each image and writing a summary report
+// By Adam Badke
+
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include "renderservice.h"
+
+// STL includes:
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Summary report written to the output directory, if no other filename is given
+const string DEFAULT_BATCH_REPORT_NAME = "batch_report.txt";
+
+class BatchRenderer
+{
+public:
+    // Constructor: Renders up to maxConcurrentJobs scenes at once. 0 = one job per core
+    BatchRenderer(int maxConcurrentJobs = 0);
+
+    // Add every request in a manifest file: One request per line, in the format of RenderRequest::parse. Blank lines and lines starting with # are ignored
+    // Return: True if the manifest was read and all of its requests were valid, false otherwise
+    bool addManifest(const string& manifestFilename);
+
+    // Add a request for every .simp file matching a wildcard pattern (eg. "page*.simp"), or for a single scene name
+    // Return: The number of requests added
+    int addScenes(const string& pattern);
+
+    // Add a single request
+    void addRequest(const RenderRequest& request);
+
+    // Render every request, saving the images to outputDirectory and the summary to reportFilename (relative to outputDirectory)
+    // Return: The number of requests that failed
+    int run(const string& outputDirectory, const string& reportFilename = DEFAULT_BATCH_REPORT_NAME);
+
+private:
+    // Batch renderers cannot be copied
+    BatchRenderer(const BatchRenderer&) = delete;
+    BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+    vector<RenderRequest> requests;
+    int maxConcurrentJobs;
+
+    RenderService service;  // Shared by every job: Repeated scenes are parsed once, and renderers (with their world space geometry) are reused between jobs
+};
+
+#endif // BATCHRENDERER_H
@@ -0,0 +1,373 @@
+// Benchmark functions: Microbenchmarks and performance reports, run from the command line with the -benchmark argument
+// By Adam Badke
+
+#include "benchmark.h"
+#include "renderutilities.h"
+#include "color.h"
+#include "specularpower.h"
+#include "depthbuffer.h"
+#include "spankernel.h"
+#include "renderer.h"
+#include "offscreendrawable.h"
+#include "fileinterpreter.h"
+
+// STL includes:
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using std::cout;
+using std::vector;
+
+// Number of random inputs for each microbenchmark, and the number of passes made over them
+const int NUM_BENCHMARK_INPUTS = 1 << 16;
+const int NUM_BENCHMARK_PASSES = 32;
+
+// The bundled scenes rendered by the rasterizer benchmark, and the resolution they're rendered at
+const char* const BENCHMARK_SCENES[] = { "01", "02", "03", "04", "05", "06", "07", "08", "09" };
+const int BENCHMARK_SCENE_RESOLUTION = 300;
+
+// Time a benchmark body, which is called once per pass
+// Return: The average time per input, in nanoseconds
+template <typename Body>
+static double timeBenchmark(Body body){
+    auto startTime = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < NUM_BENCHMARK_PASSES; pass++)
+        body();
+    auto endTime = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(endTime - startTime).count() / ((double)NUM_BENCHMARK_PASSES * NUM_BENCHMARK_INPUTS);
+}
+
+// Get the largest difference between the channels of 2 packed colors
+static unsigned int getMaxChannelDifference(unsigned int color1, unsigned int color2){
+    unsigned int maxDifference = 0;
+    for (int shift = 0; shift < 32; shift += 8){
+        int channel1 = (color1 >> shift) & 0xff;
+        int channel2 = (color2 >> shift) & 0xff;
+        unsigned int difference = (unsigned int)(channel1 > channel2 ? channel1 - channel2 : channel2 - channel1);
+        if (difference > maxDifference)
+            maxDifference = difference;
+    }
+
+    return maxDifference;
+}
+
+// Get the largest channel difference between 2 sets of packed colors
+static unsigned int getMaxChannelDifference(const vector<unsigned int>& colors1, const vector<unsigned int>& colors2){
+    unsigned int maxDifference = 0;
+    for (unsigned int i = 0; i < colors1.size() && i < colors2.size(); i++){
+        unsigned int difference = getMaxChannelDifference(colors1[i], colors2[i]);
+        if (difference > maxDifference)
+            maxDifference = difference;
+    }
+
+    return maxDifference;
+}
+
+// Get a random double in [0, maxValue]
+static double getRandomRatio(double maxValue){
+    return maxValue * (std::rand() / (double)RAND_MAX);
+}
+
+// Print a single microbenchmark result
+static void printComparison(const char* name, double packedTime, double simdTime, unsigned int maxDifference){
+    cout << "  " << name << ":\tpacked " << packedTime << " ns, Color " << simdTime << " ns (" << packedTime / simdTime << "x), max channel difference " << maxDifference << "\n";
+}
+
+// Run all benchmarks, printing their results to cout
+int runBenchmarks(){
+    std::srand(361); // Fixed seed, so runs are comparable
+
+    benchmarkColorMath();
+    benchmarkSpecularPower();
+    benchmarkSpanKernels();
+    benchmarkRasterizers();
+
+    return 0;
+}
+
+// Benchmark the packed ARGB color helpers against the SIMD Color type
+void benchmarkColorMath(){
+    cout << "Color math (per operation):\n";
+
+    // Generate random inputs: Colors, and light intensities that sometimes exceed 1 so saturation is exercised
+    vector<unsigned int> colors(NUM_BENCHMARK_INPUTS), otherColors(NUM_BENCHMARK_INPUTS);
+    vector<double> ratios(NUM_BENCHMARK_INPUTS * 6), depths(NUM_BENCHMARK_INPUTS * 2);
+    for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+        colors[i] = getRandomColor();
+        otherColors[i] = getRandomColor();
+        depths[i * 2] = 1 + getRandomRatio(100);
+        depths[i * 2 + 1] = 1 + getRandomRatio(100);
+    }
+    for (unsigned int i = 0; i < ratios.size(); i++)
+        ratios[i] = getRandomRatio(1.25);
+
+    vector<unsigned int> packedResults(NUM_BENCHMARK_INPUTS), simdResults(NUM_BENCHMARK_INPUTS);
+
+    // The lighting equation: ambient + diffuse + specular
+    double packedTime = timeBenchmark([&](){
+        for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+            const double* ratio = &ratios[i * 6];
+            packedResults[i] = addColors( multiplyColorChannels(colors[i], 1.0, 0.1, 0.1, 0.1),
+                                          addColors( multiplyColorChannels(colors[i], 1.0, ratio[0], ratio[1], ratio[2]),
+                                                     combineColorChannels(ratio[3], ratio[4], ratio[5]) ) );
+        }
+    });
+    double simdTime = timeBenchmark([&](){
+        Color ambientIntensity(0.1f, 0.1f, 0.1f, 1.0f);
+        for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+            const double* ratio = &ratios[i * 6];
+            Color baseColor = Color::fromARGB(colors[i]);
+            simdResults[i] = ( baseColor * ambientIntensity
+                               + baseColor * Color((float)ratio[0], (float)ratio[1], (float)ratio[2], 1.0f).saturate()
+                               + Color((float)ratio[3], (float)ratio[4], (float)ratio[5], 1.0f).saturate()
+                             ).saturate().toARGB();
+        }
+    });
+    printComparison("Lighting", packedTime, simdTime, getMaxChannelDifference(packedResults, simdResults));
+
+    // Perspective correct color lerp:
+    packedTime = timeBenchmark([&](){
+        for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+            double ratio = ratios[i] * 0.8;
+            double z1 = depths[i * 2], z2 = depths[i * 2 + 1];
+            packedResults[i] = combineColorChannels( getPerspCorrectLerpValue(extractColorChannel(colors[i], 1), z1, extractColorChannel(otherColors[i], 1), z2, ratio),
+                                                     getPerspCorrectLerpValue(extractColorChannel(colors[i], 2), z1, extractColorChannel(otherColors[i], 2), z2, ratio),
+                                                     getPerspCorrectLerpValue(extractColorChannel(colors[i], 3), z1, extractColorChannel(otherColors[i], 3), z2, ratio) );
+        }
+    });
+    simdTime = timeBenchmark([&](){
+        for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+            double ratio = ratios[i] * 0.8;
+            double z1 = depths[i * 2], z2 = depths[i * 2 + 1];
+            double denominator = (ratio * z1) + ((1 - ratio) * z2);
+            simdResults[i] = Color::fromARGB(colors[i]).blend( (float)(((1 - ratio) * z2) / denominator), Color::fromARGB(otherColors[i]), (float)((ratio * z1) / denominator) ).toARGB();
+        }
+    });
+    printComparison("Lerp", packedTime, simdTime, getMaxChannelDifference(packedResults, simdResults));
+
+    // Distance fog:
+    packedTime = timeBenchmark([&](){
+        for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+            double ratio = ratios[i] * 0.8;
+            packedResults[i] = addColors( multiplyColorChannels(colors[i], 1 - ratio), multiplyColorChannels(otherColors[i], ratio) );
+        }
+    });
+    simdTime = timeBenchmark([&](){
+        for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+            double ratio = ratios[i] * 0.8;
+            simdResults[i] = Color::fromARGB(colors[i]).blend( (float)(1 - ratio), Color::fromARGB(otherColors[i]), (float)ratio ).saturate().toARGB();
+        }
+    });
+    printComparison("Fog", packedTime, simdTime, getMaxChannelDifference(packedResults, simdResults));
+
+    cout << "\n";
+}
+
+// Benchmark precomputed specular exponent evaluation against std::pow, reporting its accuracy
+void benchmarkSpecularPower(){
+    cout << "Specular power (per evaluation):\n";
+
+    // Cosines in [0, 1], as produced by the lighting calculations
+    vector<double> bases(NUM_BENCHMARK_INPUTS);
+    for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++)
+        bases[i] = getRandomRatio(1.0);
+
+    vector<double> powResults(NUM_BENCHMARK_INPUTS), fastResults(NUM_BENCHMARK_INPUTS);
+
+    // The exponents used by the bundled scenes, plus a fractional exponent that falls back to std::pow
+    const double exponents[] = {1, 2, 8, 20, 64, 120, 175, 10.5};
+    for (double exponent : exponents){
+        SpecularPower specularPower(exponent);
+
+        double powTime = timeBenchmark([&](){
+            for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++)
+                powResults[i] = std::pow(bases[i], exponent);
+        });
+        double fastTime = timeBenchmark([&](){
+            for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++)
+                fastResults[i] = specularPower.evaluate(bases[i]);
+        });
+
+        // Measure the error, both relative and after quantizing to an 8 bit channel (as a full intensity light would be):
+        double maxRelativeError = 0;
+        unsigned int channelsDiffering = 0;
+        for (int i = 0; i < NUM_BENCHMARK_INPUTS; i++){
+            if (powResults[i] > 0){
+                double relativeError = std::fabs(fastResults[i] - powResults[i]) / powResults[i];
+                if (relativeError > maxRelativeError)
+                    maxRelativeError = relativeError;
+            }
+            if (Color((float)powResults[i], 0.0f, 0.0f).toARGB() != Color((float)fastResults[i], 0.0f, 0.0f).toARGB())
+                channelsDiffering++;
+        }
+
+        cout << "  Exponent " << exponent << (specularPower.isIntegerExponent() ? " (squaring)" : " (std::pow)")
+             << ":\tstd::pow " << powTime << " ns, SpecularPower " << fastTime << " ns (" << powTime / fastTime << "x), max relative error "
+             << maxRelativeError << ", " << channelsDiffering << "/" << NUM_BENCHMARK_INPUTS << " quantized channels differ\n";
+    }
+
+    cout << "\n";
+}
+
+// Benchmark depth testing scanlines with the span kernels at each supported instruction set, against testing one pixel at a time
+void benchmarkSpanKernels(){
+    cout << "Span kernels (per pixel, depth test and compaction of the visible pixels):\n";
+
+    // A depth buffer filled with random depths, and random scanlines across it. Each scanline's depth varies linearly in 1/z, as in a triangle
+    const int bufferSize = 512;
+    const int spanLength = 64;
+    const int numSpans = NUM_BENCHMARK_INPUTS / spanLength;
+    const double hither = 1, range = 100;
+
+    DepthBuffer depthBuffer(bufferSize, bufferSize);
+    for (int y = 0; y < bufferSize; y++){
+        for (int x = 0; x < bufferSize; x++)
+            depthBuffer.setDepth(x, y, (float)getRandomRatio(1.0));
+    }
+
+    vector<int> spanX(numSpans), spanY(numSpans);
+    vector<double> spanInverseZ(numSpans), spanInverseZStep(numSpans);
+    for (int i = 0; i < numSpans; i++){
+        spanX[i] = std::rand() % (bufferSize - spanLength);
+        spanY[i] = std::rand() % bufferSize;
+
+        double startZ = hither + getRandomRatio(range);
+        double endZ = hither + getRandomRatio(range);
+        spanInverseZ[i] = 1.0 / startZ;
+        spanInverseZStep[i] = (1.0 / endZ - 1.0 / startZ) / (spanLength - 1);
+    }
+
+    vector<int> referenceX(NUM_BENCHMARK_INPUTS), kernelX(NUM_BENCHMARK_INPUTS);
+    vector<double> referenceZ(NUM_BENCHMARK_INPUTS), kernelZ(NUM_BENCHMARK_INPUTS);
+    int numReference = 0, numKernel = 0;
+
+    // One pixel at a time, as Renderer::isVisible():
+    double pixelTime = timeBenchmark([&](){
+        numReference = 0;
+        for (int i = 0; i < numSpans; i++){
+            for (int offset = 0; offset < spanLength; offset++){
+                double correctZ = 1.0 / (spanInverseZ[i] + spanInverseZStep[i] * (double)offset);
+                if (depthBuffer.isCloser(spanX[i] + offset, spanY[i], (float)((correctZ - hither) / range))){
+                    referenceX[numReference] = spanX[i] + offset;
+                    referenceZ[numReference] = correctZ;
+                    numReference++;
+                }
+            }
+        }
+    });
+    cout << "  One pixel at a time:\t" << pixelTime << " ns, " << numReference << "/" << NUM_BENCHMARK_INPUTS << " pixels visible\n";
+
+    // Span kernels, in groups aligned to the depth buffer's tiles, as Renderer::depthTestScanline():
+    SpanKernelLevel supportedLevel = getSupportedSpanKernelLevel();
+    for (int level = spanKernelScalar; level <= supportedLevel; level++){
+        setSpanKernelLevel((SpanKernelLevel)level);
+
+        double kernelTime = timeBenchmark([&](){
+            SpanGroup group;
+            group.depthHither = hither;
+            group.depthRange = range;
+
+            double correctZ[SPAN_KERNEL_WIDTH];
+            float scaledDepths[SPAN_KERNEL_WIDTH];
+            int lanes[SPAN_KERNEL_WIDTH];
+
+            numKernel = 0;
+            for (int i = 0; i < numSpans; i++){
+                int xFirst = spanX[i], xLast = spanX[i] + spanLength - 1;
+                group.inverseZ = spanInverseZ[i];
+                group.inverseZStep = spanInverseZStep[i];
+
+                for (int groupX = xFirst & ~DepthBuffer::TILE_MASK; groupX <= xLast; groupX += SPAN_KERNEL_WIDTH){
+                    group.firstLaneOffset = groupX - xFirst;
+                    group.laneMask = getSpanLaneMask(xFirst - groupX, xLast - groupX);
+
+                    unsigned int visibleMask = depthTestSpanGroup(group, depthBuffer.getTileRow(groupX, spanY[i]), correctZ, scaledDepths);
+                    int numLanes = compactSpanGroupMask(visibleMask, lanes);
+                    for (int lane = 0; lane < numLanes; lane++){
+                        kernelX[numKernel + lane] = groupX + lanes[lane];
+                        kernelZ[numKernel + lane] = correctZ[ lanes[lane] ];
+                    }
+                    numKernel += numLanes;
+                }
+            }
+        });
+
+        // Count the pixels whose visibility or depth differs from testing one pixel at a time:
+        int numDiffering = std::abs(numKernel - numReference);
+        for (int i = 0; i < numKernel && i < numReference; i++){
+            if (kernelX[i] != referenceX[i] || kernelZ[i] != referenceZ[i])
+                numDiffering++;
+        }
+
+        cout << "  " << getSpanKernelLevelName((SpanKernelLevel)level) << " kernel:\t" << kernelTime << " ns (" << pixelTime / kernelTime << "x), " << numDiffering << " pixels differ\n";
+    }
+    setSpanKernelLevel(supportedLevel);
+
+    cout << "\n";
+}
+
+// Benchmark rendering each bundled scene with the edge function rasterizer and with ray casting, against the scanline rasterizer
+// Each scene is rendered once beforehand, so the timed frames all reuse its world space geometry
+void benchmarkRasterizers(){
+    cout << "Rasterizers (per frame at " << BENCHMARK_SCENE_RESOLUTION << "x" << BENCHMARK_SCENE_RESOLUTION << ", " << std::max(std::thread::hardware_concurrency(), 1u) << " core(s) available to ray casting):\n";
+
+    const RasterizerMode modes[] = { scanlineRasterizer, edgeFunctionRasterizer, rayCastRasterizer };
+    const char* const modeNames[] = { "scanline", "edge function", "ray cast" };
+    const int numPixels = BENCHMARK_SCENE_RESOLUTION * BENCHMARK_SCENE_RESOLUTION;
+
+    for (const char* sceneName : BENCHMARK_SCENES){
+        string filename = "./" + string(sceneName) + ".simp";
+        if (!std::ifstream(filename).good())
+            continue;
+
+        FileInterpreter sceneInterpreter;
+        Scene theScene = sceneInterpreter.buildSceneFromFile(filename);
+
+        OffscreenDrawable drawable(BENCHMARK_SCENE_RESOLUTION, BENCHMARK_SCENE_RESOLUTION);
+        Renderer renderer(&drawable, BENCHMARK_SCENE_RESOLUTION, BENCHMARK_SCENE_RESOLUTION, 1);
+        renderer.setPresentInterval(0); // Nobody is watching: Only present finished frames
+        renderer.renderScene(theScene);
+
+        cout << "  " << sceneName << ":\t";
+
+        vector<unsigned int> scanlinePixels;
+        double scanlineTime = 0;
+        for (int i = 0; i < 3; i++){
+            renderer.setRasterizer(modes[i]);
+
+            auto startTime = std::chrono::steady_clock::now();
+            renderer.renderScene(theScene);
+            auto endTime = std::chrono::steady_clock::now();
+            double renderTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+            vector<unsigned int> pixels(drawable.getPixels(), drawable.getPixels() + numPixels);
+            cout << modeNames[i] << " " << renderTime << " ms";
+
+            if (modes[i] == scanlineRasterizer){
+                scanlinePixels = pixels;
+                scanlineTime = renderTime;
+            }
+            else{
+                // Count the pixels that differ noticeably from the scanline rasterizer's:
+                int numDiffering = 0;
+                for (int j = 0; j < numPixels; j++){
+                    if (getMaxChannelDifference(pixels[j], scanlinePixels[j]) > 8)
+                        numDiffering++;
+                }
+
+                cout << " (" << scanlineTime / renderTime << "x, " << numDiffering << " pixels differ)";
+            }
+
+            cout << (i < 2 ? ", " : "\n");
+        }
+    }
+
+    cout << "\n";
+}
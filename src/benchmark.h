@@ -0,0 +1,23 @@
+// Benchmark functions: Microbenchmarks and performance reports, run from the command line with the -benchmark argument
+// By Adam Badke
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Run all benchmarks, printing their results to cout
+// Return: A process exit code. 0 on success
+int runBenchmarks();
+
+// Benchmark the packed ARGB color helpers against the SIMD Color type
+void benchmarkColorMath();
+
+// Benchmark precomputed specular exponent evaluation against std::pow, reporting its accuracy
+void benchmarkSpecularPower();
+
+// Benchmark depth testing scanlines with the span kernels at each supported instruction set, against testing one pixel at a time
+void benchmarkSpanKernels();
+
+// Benchmark rendering each bundled scene found in the working directory with the edge function rasterizer and with ray casting, against the scanline rasterizer
+void benchmarkRasterizers();
+
+#endif // BENCHMARK_H
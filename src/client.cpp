@@ -159,7 +159,9 @@ void Client::nextPage() {
         clientRenderer->renderScene(theScene);
         t2 = high_resolution_clock::now();
         duration = duration_cast<microseconds>( t2 - t1 ).count();
-        cout << "Mesh drawn in:\t" << duration << "ms\n\n";
+        cout << "Mesh drawn in:\t" << duration << "ms\n";
+        clientRenderer->printFrameStatistics();
+        cout << "\n";
 
     } // End "commandLineMode" else
 
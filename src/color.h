@@ -0,0 +1,205 @@
+// Color object: A linear float RGBA color, held in a single SIMD register where SSE is available
+// By Adam Badke
+
+#ifndef COLOR_H
+#define COLOR_H
+
+// Use SSE2 wherever the compiler targets it (always the case for x86-64):
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define COLOR_USE_SSE
+    #include <emmintrin.h>
+#endif
+
+class Color
+{
+public:
+    // Default constructor: Transparent black
+    Color();
+
+    // Channel constructor. Channels are linear, and nominally in [0, 1]
+    Color(float red, float green, float blue, float alpha = 1.0f);
+
+    // Unpack a 32 bit ARGB color
+    static Color fromARGB(unsigned int color);
+
+    // Pack this color into a 32 bit ARGB value, clamping each channel to [0, 1] and rounding
+    unsigned int toARGB() const;
+
+    // Component-wise arithmetic:
+    Color operator+(const Color& rhs) const;
+    Color operator*(const Color& rhs) const;
+    Color operator*(float ratio) const;
+    Color& operator+=(const Color& rhs);
+
+    // Clamp each channel to at most 1. Matches the saturation of the packed color helpers
+    Color saturate() const;
+
+    // Linearly interpolate between 2 colors: this * startWeight + end * endWeight
+    Color blend(float startWeight, const Color& end, float endWeight) const;
+
+    // Channel accessors:
+    float red() const;
+    float green() const;
+    float blue() const;
+    float alpha() const;
+
+private:
+#ifdef COLOR_USE_SSE
+    explicit Color(__m128 newLanes);
+    __m128 lanes;           // (red, green, blue, alpha), lowest lane first
+#else
+    float lanes[4];         // (red, green, blue, alpha)
+#endif
+};
+
+// Inline definitions: Colors are created and combined several times per lit pixel
+//*********************************************************************************
+
+#ifdef COLOR_USE_SSE
+
+inline Color::Color() : lanes(_mm_setzero_ps()) {}
+
+inline Color::Color(__m128 newLanes) : lanes(newLanes) {}
+
+inline Color::Color(float red, float green, float blue, float alpha) : lanes(_mm_setr_ps(red, green, blue, alpha)) {}
+
+inline Color Color::fromARGB(unsigned int color){
+    // Unpack the channels into integer lanes, then convert them all at once:
+    __m128i packed = _mm_cvtsi32_si128( (int)color );                         // [B G R A] bytes, in the low 32 bits
+    __m128i zero = _mm_setzero_si128();
+    __m128i widened = _mm_unpacklo_epi16( _mm_unpacklo_epi8(packed, zero), zero ); // (B, G, R, A) as 32 bit integers
+    __m128 bgra = _mm_mul_ps( _mm_cvtepi32_ps(widened), _mm_set1_ps(1.0f / 255.0f) );
+
+    return Color( _mm_shuffle_ps(bgra, bgra, _MM_SHUFFLE(3, 0, 1, 2)) );       // Swizzle to (R, G, B, A)
+}
+
+inline unsigned int Color::toARGB() const{
+    // Clamp to [0, 1], scale and round to the nearest integer:
+    __m128 clamped = _mm_min_ps( _mm_max_ps(lanes, _mm_setzero_ps()), _mm_set1_ps(1.0f) );
+    __m128 scaled = _mm_add_ps( _mm_mul_ps(clamped, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f) );
+    __m128i channels = _mm_cvttps_epi32( _mm_shuffle_ps(scaled, scaled, _MM_SHUFFLE(3, 0, 1, 2)) ); // Swizzle to (B, G, R, A)
+
+    // Narrow the lanes to bytes. Values are already in [0, 255], so saturation never triggers
+    __m128i narrowed = _mm_packus_epi16( _mm_packs_epi32(channels, channels), _mm_setzero_si128() );
+
+    return (unsigned int)_mm_cvtsi128_si32(narrowed);
+}
+
+inline Color Color::operator+(const Color& rhs) const{
+    return Color( _mm_add_ps(lanes, rhs.lanes) );
+}
+
+inline Color Color::operator*(const Color& rhs) const{
+    return Color( _mm_mul_ps(lanes, rhs.lanes) );
+}
+
+inline Color Color::operator*(float ratio) const{
+    return Color( _mm_mul_ps(lanes, _mm_set1_ps(ratio)) );
+}
+
+inline Color& Color::operator+=(const Color& rhs){
+    lanes = _mm_add_ps(lanes, rhs.lanes);
+    return *this;
+}
+
+inline Color Color::saturate() const{
+    return Color( _mm_min_ps(lanes, _mm_set1_ps(1.0f)) );
+}
+
+inline Color Color::blend(float startWeight, const Color& end, float endWeight) const{
+    return Color( _mm_add_ps( _mm_mul_ps(lanes, _mm_set1_ps(startWeight)), _mm_mul_ps(end.lanes, _mm_set1_ps(endWeight)) ) );
+}
+
+inline float Color::red() const{
+    return _mm_cvtss_f32(lanes);
+}
+
+inline float Color::green() const{
+    return _mm_cvtss_f32( _mm_shuffle_ps(lanes, lanes, _MM_SHUFFLE(1, 1, 1, 1)) );
+}
+
+inline float Color::blue() const{
+    return _mm_cvtss_f32( _mm_shuffle_ps(lanes, lanes, _MM_SHUFFLE(2, 2, 2, 2)) );
+}
+
+inline float Color::alpha() const{
+    return _mm_cvtss_f32( _mm_shuffle_ps(lanes, lanes, _MM_SHUFFLE(3, 3, 3, 3)) );
+}
+
+#else // Scalar fallback:
+
+inline Color::Color(){
+    lanes[0] = lanes[1] = lanes[2] = lanes[3] = 0.0f;
+}
+
+inline Color::Color(float red, float green, float blue, float alpha){
+    lanes[0] = red;
+    lanes[1] = green;
+    lanes[2] = blue;
+    lanes[3] = alpha;
+}
+
+inline Color Color::fromARGB(unsigned int color){
+    const float scale = 1.0f / 255.0f;
+    return Color( ((color >> 16) & 0xff) * scale, ((color >> 8) & 0xff) * scale, (color & 0xff) * scale, ((color >> 24) & 0xff) * scale );
+}
+
+inline unsigned int Color::toARGB() const{
+    unsigned int channels[4];
+    for (int i = 0; i < 4; i++){
+        float value = lanes[i];
+        if (value < 0.0f)
+            value = 0.0f;
+        if (value > 1.0f)
+            value = 1.0f;
+        channels[i] = (unsigned int)(value * 255.0f + 0.5f);
+    }
+
+    return (channels[3] << 24) | (channels[0] << 16) | (channels[1] << 8) | channels[2];
+}
+
+inline Color Color::operator+(const Color& rhs) const{
+    return Color(lanes[0] + rhs.lanes[0], lanes[1] + rhs.lanes[1], lanes[2] + rhs.lanes[2], lanes[3] + rhs.lanes[3]);
+}
+
+inline Color Color::operator*(const Color& rhs) const{
+    return Color(lanes[0] * rhs.lanes[0], lanes[1] * rhs.lanes[1], lanes[2] * rhs.lanes[2], lanes[3] * rhs.lanes[3]);
+}
+
+inline Color Color::operator*(float ratio) const{
+    return Color(lanes[0] * ratio, lanes[1] * ratio, lanes[2] * ratio, lanes[3] * ratio);
+}
+
+inline Color& Color::operator+=(const Color& rhs){
+    for (int i = 0; i < 4; i++)
+        lanes[i] += rhs.lanes[i];
+    return *this;
+}
+
+inline Color Color::saturate() const{
+    return Color(lanes[0] < 1.0f ? lanes[0] : 1.0f, lanes[1] < 1.0f ? lanes[1] : 1.0f, lanes[2] < 1.0f ? lanes[2] : 1.0f, lanes[3] < 1.0f ? lanes[3] : 1.0f);
+}
+
+inline Color Color::blend(float startWeight, const Color& end, float endWeight) const{
+    return (*this * startWeight) + (end * endWeight);
+}
+
+inline float Color::red() const{
+    return lanes[0];
+}
+
+inline float Color::green() const{
+    return lanes[1];
+}
+
+inline float Color::blue() const{
+    return lanes[2];
+}
+
+inline float Color::alpha() const{
+    return lanes[3];
+}
+
+#endif // COLOR_USE_SSE
+
+#endif // COLOR_H
@@ -0,0 +1,225 @@
+// Depth buffer object: A contiguous, tiled float depth buffer with constant time clears, and a hierarchical max depth pyramid for occlusion culling
+// By Adam Badke
+
+#include "depthbuffer.h"
+
+#include <cstdint>
+
+// Alignment of the depth storage, in bytes. Keeps each tile row within a single cache line
+const size_t DEPTH_BUFFER_ALIGNMENT = 64;
+
+// Out of class definition of the clear depth (required when it is odr-used)
+constexpr float DepthBuffer::CLEAR_DEPTH;
+
+// Constructor
+DepthBuffer::DepthBuffer(int newWidth, int newHeight){
+    width = newWidth;
+    height = newHeight;
+
+    // Round the dimensions up to a whole number of tiles:
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    int numTiles = tilesX * tilesY;
+
+    // Allocate a single contiguous block of depths, and align it:
+    allocation = new char[ sizeof(float) * numTiles * TILE_AREA + DEPTH_BUFFER_ALIGNMENT ];
+    uintptr_t address = reinterpret_cast<uintptr_t>(allocation);
+    address = (address + DEPTH_BUFFER_ALIGNMENT - 1) & ~(uintptr_t)(DEPTH_BUFFER_ALIGNMENT - 1);
+    depths = reinterpret_cast<float*>(address);
+
+    // Every tile starts out stale, so nothing needs to be written until it is used:
+    tileEpochs = new unsigned int[numTiles];
+    for (int i = 0; i < numTiles; i++)
+        tileEpochs[i] = 0;
+
+    currentEpoch = 1;
+
+    // Build the depth pyramid levels, halving the dimensions until a single cell covers the whole buffer:
+    int levelWidth = tilesX;
+    int levelHeight = tilesY;
+    while (true){
+        levelWidths.push_back(levelWidth);
+        levelHeights.push_back(levelHeight);
+        maxDepthLevels.push_back( vector<float>(levelWidth * levelHeight, CLEAR_DEPTH) );
+
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+
+    tileIsDirty.assign(numTiles, 0);
+}
+
+// Destructor
+DepthBuffer::~DepthBuffer(){
+    delete [] allocation;
+    delete [] tileEpochs;
+}
+
+// Clear the whole buffer. Tiles are only reset when they are next accessed
+void DepthBuffer::clear(){
+    currentEpoch++;
+
+    // Handle epoch wrap around: Mark every tile as stale explicitly
+    if (currentEpoch == 0){
+        for (int i = 0; i < tilesX * tilesY; i++)
+            tileEpochs[i] = 0;
+
+        currentEpoch = 1;
+    }
+
+    // Reset the depth pyramid:
+    for (unsigned int level = 0; level < maxDepthLevels.size(); level++){
+        for (unsigned int i = 0; i < maxDepthLevels[level].size(); i++)
+            maxDepthLevels[level][i] = CLEAR_DEPTH;
+    }
+
+    for (unsigned int i = 0; i < dirtyTiles.size(); i++)
+        tileIsDirty[ dirtyTiles[i] ] = 0;
+    dirtyTiles.clear();
+}
+
+// Reset a tile to the clear depth, if it hasn't been written since the last clear
+void DepthBuffer::validateTile(int tileIndex){
+    if (tileEpochs[tileIndex] == currentEpoch)
+        return;
+
+    float* tileDepths = &depths[tileIndex * TILE_AREA];
+    for (int i = 0; i < TILE_AREA; i++)
+        tileDepths[i] = CLEAR_DEPTH;
+
+    tileEpochs[tileIndex] = currentEpoch;
+}
+
+// Check whether everything within a rectangle of pixels is at least as far away as a given depth, using the hierarchical depth pyramid
+bool DepthBuffer::isRectOccluded(int xMin, int yMin, int xMax, int yMax, float minDepth){
+
+    // Clamp the rectangle to the buffer:
+    if (xMin < 0)
+        xMin = 0;
+    if (yMin < 0)
+        yMin = 0;
+    if (xMax > width - 1)
+        xMax = width - 1;
+    if (yMax > height - 1)
+        yMax = height - 1;
+
+    // Rectangles entirely outside of the buffer can't be seen
+    if (xMin > xMax || yMin > yMax)
+        return true;
+
+    updatePyramid();
+
+    int tileXMin = xMin >> TILE_SHIFT;
+    int tileYMin = yMin >> TILE_SHIFT;
+    int tileXMax = xMax >> TILE_SHIFT;
+    int tileYMax = yMax >> TILE_SHIFT;
+
+    // Start at the finest level where the rectangle overlaps at most 2x2 cells:
+    int level = 0;
+    while ( ((tileXMax >> level) - (tileXMin >> level) > 1 || (tileYMax >> level) - (tileYMin >> level) > 1) && level < (int)maxDepthLevels.size() - 1)
+        level++;
+
+    for (int cellY = tileYMin >> level; cellY <= tileYMax >> level; cellY++){
+        for (int cellX = tileXMin >> level; cellX <= tileXMax >> level; cellX++){
+            if (!isCellOccluded(level, cellX, cellY, tileXMin, tileYMin, tileXMax, tileYMax, minDepth))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Recursively check whether every pyramid cell overlapping a rectangle of tiles is occluded
+bool DepthBuffer::isCellOccluded(int level, int cellX, int cellY, int tileXMin, int tileYMin, int tileXMax, int tileYMax, float minDepth){
+
+    // The whole cell is behind the nearest point: Occluded
+    if (minDepth >= maxDepthLevels[level][cellY * levelWidths[level] + cellX])
+        return true;
+
+    // We can't refine the tiles any further: Potentially visible
+    if (level == 0)
+        return false;
+
+    // Check the overlapping children on the level below:
+    int childXMin = cellX * 2;
+    int childYMin = cellY * 2;
+    int childXMax = childXMin + 1;
+    int childYMax = childYMin + 1;
+
+    if (childXMin < (tileXMin >> (level - 1)))
+        childXMin = tileXMin >> (level - 1);
+    if (childYMin < (tileYMin >> (level - 1)))
+        childYMin = tileYMin >> (level - 1);
+    if (childXMax > (tileXMax >> (level - 1)))
+        childXMax = tileXMax >> (level - 1);
+    if (childYMax > (tileYMax >> (level - 1)))
+        childYMax = tileYMax >> (level - 1);
+
+    for (int childY = childYMin; childY <= childYMax; childY++){
+        for (int childX = childXMin; childX <= childXMax; childX++){
+            if (!isCellOccluded(level - 1, childX, childY, tileXMin, tileYMin, tileXMax, tileYMax, minDepth))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Rebuild the pyramid entries of all dirty tiles
+void DepthBuffer::updatePyramid(){
+    for (unsigned int i = 0; i < dirtyTiles.size(); i++){
+        int tileIndex = dirtyTiles[i];
+        tileIsDirty[tileIndex] = 0;
+
+        // Find the max depth of the tile. Depths only ever decrease between clears, so this never grows
+        float* tileDepths = &depths[tileIndex * TILE_AREA];
+        float maxDepth = tileDepths[0];
+        for (int j = 1; j < TILE_AREA; j++){
+            if (tileDepths[j] > maxDepth)
+                maxDepth = tileDepths[j];
+        }
+
+        int cellX = tileIndex % tilesX;
+        int cellY = tileIndex / tilesX;
+        maxDepthLevels[0][tileIndex] = maxDepth;
+
+        // Propagate the change up through the pyramid:
+        for (unsigned int level = 1; level < maxDepthLevels.size(); level++){
+            cellX /= 2;
+            cellY /= 2;
+
+            // Take the max of the (up to) 4 children of the cell:
+            int childWidth = levelWidths[level - 1];
+            int childHeight = levelHeights[level - 1];
+            float cellMax = maxDepthLevels[level - 1][(cellY * 2) * childWidth + (cellX * 2)];
+            for (int childY = cellY * 2; childY <= cellY * 2 + 1 && childY < childHeight; childY++){
+                for (int childX = cellX * 2; childX <= cellX * 2 + 1 && childX < childWidth; childX++){
+                    if (maxDepthLevels[level - 1][childY * childWidth + childX] > cellMax)
+                        cellMax = maxDepthLevels[level - 1][childY * childWidth + childX];
+                }
+            }
+
+            // Stop once the max stops changing
+            float& currentMax = maxDepthLevels[level][cellY * levelWidths[level] + cellX];
+            if (currentMax == cellMax)
+                break;
+            currentMax = cellMax;
+        }
+    }
+
+    dirtyTiles.clear();
+}
+
+// Buffer width, in pixels
+int DepthBuffer::getWidth() const{
+    return width;
+}
+
+// Buffer height, in pixels
+int DepthBuffer::getHeight() const{
+    return height;
+}
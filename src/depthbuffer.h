@@ -0,0 +1,155 @@
+// Depth buffer object: A contiguous, tiled float depth buffer with constant time clears, and a hierarchical max depth pyramid for occlusion culling
+// By Adam Badke
+
+#ifndef DEPTHBUFFER_H
+#define DEPTHBUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+class DepthBuffer
+{
+public:
+    // Tile dimensions: Each tile is a contiguous TILE_SIZE x TILE_SIZE block of depths, stored row by row
+    static const int TILE_SHIFT = 3;
+    static const int TILE_SIZE = 1 << TILE_SHIFT;
+    static const int TILE_MASK = TILE_SIZE - 1;
+    static const int TILE_AREA = TILE_SIZE * TILE_SIZE;
+
+    // The depth of an empty pixel: Depths are normalized so that the far clipping plane is 1.0
+    static constexpr float CLEAR_DEPTH = 1.0f;
+
+    // Constructor
+    DepthBuffer(int newWidth, int newHeight);
+
+    // Destructor
+    ~DepthBuffer();
+
+    // Clear the whole buffer. Tiles are only reset when they are next accessed
+    void clear();
+
+    // Check if a depth is in front of the stored depth at a pixel
+    // Pre-condition: (x, y) is inside the buffer
+    bool isCloser(int x, int y, float depth);
+
+    // Get the stored depth at a pixel
+    // Pre-condition: (x, y) is inside the buffer
+    float getDepth(int x, int y);
+
+    // Store a depth at a pixel
+    // Pre-condition: (x, y) is inside the buffer
+    void setDepth(int x, int y, float depth);
+
+    // Get the TILE_SIZE contiguous depths of the tile row holding a pixel: Element i is the depth at ((x & ~TILE_MASK) + i, y). Used by span kernels
+    // The tile is reset first if it is stale, so the depths are always valid. Call markTileWritten() after changing them
+    // Pre-condition: (x, y) is inside the buffer
+    float* getTileRow(int x, int y);
+
+    // Flag the tile holding a pixel as written, so its entry in the depth pyramid is rebuilt
+    // Pre-condition: (x, y) is inside the buffer, and its tile is not stale
+    void markTileWritten(int x, int y);
+
+    // Check whether everything within a rectangle of pixels is at least as far away as a given depth, using the hierarchical depth pyramid
+    // Note: Conservative. Only returns true if no pixel at or beyond minDepth could pass a depth test inside the rectangle. Rectangles are clamped to the buffer
+    bool isRectOccluded(int xMin, int yMin, int xMax, int yMax, float minDepth);
+
+    // Buffer dimensions, in pixels
+    int getWidth() const;
+    int getHeight() const;
+
+private:
+    int width, height;          // Buffer dimensions, in pixels
+    int tilesX, tilesY;         // Buffer dimensions, in tiles
+
+    char* allocation;           // The raw allocation the aligned depth storage was carved from
+    float* depths;              // Tiled depth storage. Aligned to a cache line
+    unsigned int* tileEpochs;   // The clear epoch each tile was last written in. Tiles from an older epoch are treated as cleared
+
+    unsigned int currentEpoch;  // Incremented on each clear
+
+    // Hierarchical depth pyramid: Level 0 holds the max depth of each tile, and each following level holds the max of 2x2 cells of the level below
+    vector< vector<float> > maxDepthLevels;
+    vector<int> levelWidths, levelHeights;
+
+    vector<unsigned char> tileIsDirty;  // Whether a tile has been written since its pyramid entry was last rebuilt
+    vector<int> dirtyTiles;             // The indexes of the dirty tiles
+
+    // Rebuild the pyramid entries of all dirty tiles
+    void updatePyramid();
+
+    // Recursively check whether every pyramid cell overlapping a rectangle of tiles is occluded
+    bool isCellOccluded(int level, int cellX, int cellY, int tileXMin, int tileYMin, int tileXMax, int tileYMax, float minDepth);
+
+    // Get the index of a pixel's tile
+    int getTileIndex(int x, int y) const;
+
+    // Get the index of a pixel in the depth storage
+    int getDepthIndex(int x, int y) const;
+
+    // Reset a tile to the clear depth, if it hasn't been written since the last clear
+    void validateTile(int tileIndex);
+
+    // Copy constructor/assignment: Not supported
+    DepthBuffer(const DepthBuffer&);
+    DepthBuffer& operator=(const DepthBuffer&);
+};
+
+// Inline definitions: These are called once or more per rasterized pixel
+//**********************************************************************
+
+// Get the index of a pixel's tile
+inline int DepthBuffer::getTileIndex(int x, int y) const{
+    return (y >> TILE_SHIFT) * tilesX + (x >> TILE_SHIFT);
+}
+
+// Get the index of a pixel in the depth storage. Pixels along a scanline are contiguous within each tile
+inline int DepthBuffer::getDepthIndex(int x, int y) const{
+    return getTileIndex(x, y) * TILE_AREA + ((y & TILE_MASK) << TILE_SHIFT) + (x & TILE_MASK);
+}
+
+// Check if a depth is in front of the stored depth at a pixel
+inline bool DepthBuffer::isCloser(int x, int y, float depth){
+    return depth < getDepth(x, y);
+}
+
+// Get the stored depth at a pixel
+inline float DepthBuffer::getDepth(int x, int y){
+    if (tileEpochs[getTileIndex(x, y)] != currentEpoch)
+        return CLEAR_DEPTH;
+
+    return depths[getDepthIndex(x, y)];
+}
+
+// Store a depth at a pixel
+inline void DepthBuffer::setDepth(int x, int y, float depth){
+    int tileIndex = getTileIndex(x, y);
+    validateTile(tileIndex);
+
+    depths[getDepthIndex(x, y)] = depth;
+
+    // Flag the tile's pyramid entry for rebuilding:
+    if (!tileIsDirty[tileIndex]){
+        tileIsDirty[tileIndex] = 1;
+        dirtyTiles.push_back(tileIndex);
+    }
+}
+
+// Get the contiguous depths of the tile row holding a pixel
+inline float* DepthBuffer::getTileRow(int x, int y){
+    validateTile(getTileIndex(x, y));
+
+    return &depths[getDepthIndex(x & ~TILE_MASK, y)];
+}
+
+// Flag the tile holding a pixel as written
+inline void DepthBuffer::markTileWritten(int x, int y){
+    int tileIndex = getTileIndex(x, y);
+    if (!tileIsDirty[tileIndex]){
+        tileIsDirty[tileIndex] = 1;
+        dirtyTiles.push_back(tileIndex);
+    }
+}
+
+#endif // DEPTHBUFFER_H
@@ -7,6 +7,18 @@ public:
     virtual void setPixel(int x, int y, unsigned int color) = 0;
     virtual unsigned int getPixel(int x, int y) = 0;
     virtual void updateScreen() = 0;
+
+    // Blit a rectangle of packed ARGB pixels in one call. Rows of the source are rowStride pixels apart
+    // Drawables that can copy whole rows at once should override this: The default falls back to setPixel()
+    virtual void setPixels(int x, int y, int width, int height, const unsigned int* pixels, int rowStride){
+        for (int row = 0; row < height; row++){
+            for (int col = 0; col < width; col++){
+                setPixel(x + col, y + row, pixels[row * rowStride + col]);
+            }
+        }
+    }
+
+    virtual ~Drawable() {}
 };
 
 #endif // DRAWABLE_H
@@ -11,10 +11,14 @@
 #include "transformationmatrix.h"
 #include <stack>
 #include <vector>
+#include <utility>
+#include <algorithm>
 #include "renderutilities.h"
 #include "normalvector.h"
 #include "light.h"
 #include "polygon.h"
+#include "scenesnapshot.h"
+#include "meshsimplifier.h"
 
 using std::ifstream;
 using std::cout;
@@ -22,28 +26,53 @@ using std::list;
 using std::stack;
 using std::vector;
 
+// Generated levels of detail never drop below this many triangles: Small meshes lose their shape long before they save any time
+const int MIN_AUTO_LOD_TRIANGLES = 64;
+
 // No arg constructor
 FileInterpreter::FileInterpreter(){
-    // Does nothing
+    autoLodLevels = 0;
+    autoLodRatio = 0.5;
 }
 
-// Read a file and assemble a mesh, given the filename
+// Read a file and assemble a mesh, given the filename. Loads the file's scene snapshot instead, if it has an up to date one
 // Return: A mesh object contstructed from the .simp file descriptions
 Scene FileInterpreter::buildSceneFromFile(string filename){
 
+    // Skip parsing entirely if the scene has already been compiled, and none of its files have changed since:
+    Scene theScene;
+    if (SceneSnapshot::load(filename + SCENE_SNAPSHOT_EXTENSION, &theScene))
+        return theScene;
+
+    return compileScene(filename);
+}
+
+// Build a scene from a .simp file, and save it as a snapshot that later calls to buildSceneFromFile() can load directly
+// Return: The scene constructed from the .simp file descriptions
+Scene FileInterpreter::compileScene(string filename){
+
     // Assemble the resulting polys into a scene, and return it
     Scene theScene;
     currentScene = &theScene; // Save the address of the scene being constructed
+    dependencies.clear();
+    generatedLevels.clear();
+    autoLodLevels = 0;
+    autoLodRatio = 0.5;
 
     theScene.theMeshes = getMeshHelper(filename, false, false, false, false, 0xffffffff, phong , 0.3, 8, 0.5); // Set the default values to start
 
-    // Generate bounding boxes:
+    // Generate bounding boxes and clusters:
     for (auto &currentMesh : theScene.theMeshes){
         currentMesh.generateBoundingBox();
+        currentMesh.generateClusters();
     }
 
     currentScene = nullptr; // Remove the reference to the local object for safety
 
+    // Save the snapshot. Failing to save it isn't an error: The scene will just be parsed again next time
+    if (!SceneSnapshot::save(&theScene, dependencies, filename + SCENE_SNAPSHOT_EXTENSION))
+        cout << "Warning: Could not save a snapshot of " << filename << "\n";
+
     return theScene;
 }
 
@@ -68,8 +97,11 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
     stack<TransformationMatrix> theCTMStack;    // Stack of CTM's
 
     vector<Polygon> currentFaces;               // A working vector of polygon faces
+    vector<LodChain> currentLodChains;          // The levels of detail of any obj's in currentFaces
     vector<Mesh> extractedMeshes;               // A collection of assembled meshes
 
+    dependencies.push_back(filename); // Recorded even if the file is missing, so the snapshot is invalidated once it appears
+
     // Open the file, and process it:
     ifstream* input = new ifstream(); // File reading object
     input->open(filename);
@@ -105,6 +137,36 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
                         theIterator++;
                         currentScene->noRayShadows = true;
                     }
+                    else if (theIterator->compare("bouncecutoff") == 0 ){
+                        theIterator++;
+                        currentScene->bounceCutoff = stod(*theIterator++);
+                    }
+                    else if (theIterator->compare("lightcutoff") == 0 ){
+                        theIterator++;
+                        currentScene->lightCutoff = stod(*theIterator++);
+                    }
+
+                    // Handle level of detail commands:
+                    else if (theIterator->compare("lod") == 0 ){
+                        theIterator++;
+                        currentScene->lodThreshold = stod(*theIterator++);
+                        currentScene->lodHysteresis = stod(*theIterator++);
+                    }
+                    else if (theIterator->compare("proxyrays") == 0 ){
+                        theIterator++;
+                        if (theIterator->compare("shadows") == 0)
+                            currentScene->proxyRays = proxyShadowRays;
+                        else if (theIterator->compare("secondary") == 0)
+                            currentScene->proxyRays = proxySecondaryRays;
+                        else
+                            currentScene->proxyRays = noProxyRays;
+                        theIterator++;
+                    }
+                    else if (theIterator->compare("autolod") == 0 ){
+                        theIterator++;
+                        autoLodLevels = stoi(*theIterator++);
+                        autoLodRatio = stod(*theIterator++);
+                    }
                     // Handle open brace "{"
                     else if(theIterator->compare("{") == 0){
                         theIterator++;
@@ -287,33 +349,67 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
                         theShadingModel = phong;
                     }
 
-                    // Handle obj commands
+                    // Handle obj commands. The obj may be followed by progressively coarser versions of itself, to use as levels of detail
+                    // Eg. obj "unitSphere" "unitSphere_20"
+                    // Obj's without their own levels of detail have them generated, if an autolod command is in effect
                     else if (theIterator->compare("obj") == 0){
                         theIterator++;
 
                         // Extract the polygons:
-                        vector<Polygon> objContents = getPolysFromObj("./" + *theIterator + ".obj");
+                        vector<vector<Polygon>> objLevels;
+                        string objFilename;
+                        while (theIterator != currentLineTokens.end()){
+                            objFilename = "./" + *theIterator++ + ".obj";
+                            vector<Polygon> objContents = getPolysFromObj(objFilename);
+
+                            // Skip missing levels of detail, rather than letting the mesh vanish in the distance:
+                            if (objContents.empty() && !objLevels.empty())
+                                continue;
+
+                            objLevels.emplace_back(std::move(objContents));
+                        }
+
+                        if (objLevels.size() == 1 && autoLodLevels > 0 && !objLevels[0].empty()){
+                            vector<vector<Polygon>> generatedLevels = generateLevelsOfDetail(objFilename, &objLevels[0]);
+                            objLevels.insert(objLevels.end(), std::make_move_iterator(generatedLevels.begin()), std::make_move_iterator(generatedLevels.end()) );
+                        }
 
                         // Process the recieved polygons:
-                        for (unsigned int i = 0; i < objContents.size(); i++){
-                            objContents[i].transform(&CTM);
+                        for (auto &objContents : objLevels){
+                            for (unsigned int i = 0; i < objContents.size(); i++){
+                                objContents[i].transform(&CTM);
+
+                                // Set the surface color instructions:
+                                if (usesSurfaceColor)
+                                    objContents[i].setSurfaceColor(theSurfaceColor);
+
+                                objContents[i].setSpecularCoefficient(theSpecCoefficient);
+                                objContents[i].setSpecularExponent(theSpecExponent);
+                                objContents[i].setShadingModel(theShadingModel);
+                                objContents[i].setReflectivity(theReflectivity);
+
+                                // Set the fog and ambient lighting:
+                                objContents[i].setAffectedByAmbientLight(usesAmbientLighting);
 
-                            // Set the surface color instructions:
-                            if (usesSurfaceColor)
-                                objContents[i].setSurfaceColor(theSurfaceColor);
+                                // Calculate the face normal of the polygon:
+                                objContents[i].faceNormal = objContents[i].getFaceNormal();
+                            }
+                        }
 
-                            objContents[i].setSpecularCoefficient(theSpecCoefficient);
-                            objContents[i].setSpecularExponent(theSpecExponent);
-                            objContents[i].setShadingModel(theShadingModel);
-                            objContents[i].setReflectivity(theReflectivity);
+                        if (objLevels.empty())
+                            continue;
 
-                            // Set the fog and ambient lighting:
-                            objContents[i].setAffectedByAmbientLight(usesAmbientLighting);
+                        // Keep the coarser levels aside until the mesh is assembled:
+                        if (objLevels.size() > 1){
+                            LodChain newChain;
+                            newChain.firstFace = (unsigned int)currentFaces.size();
+                            newChain.numFaces = (unsigned int)objLevels[0].size();
+                            newChain.coarserLevels.assign(std::make_move_iterator(objLevels.begin() + 1), std::make_move_iterator(objLevels.end()) );
 
-                            // Calculate the face normal of the polygon:
-                            objContents[i].faceNormal = objContents[i].getFaceNormal();
+                            currentLodChains.emplace_back(std::move(newChain));
                         }
-                        currentFaces.insert(currentFaces.end(), objContents.begin(), objContents.end() );
+
+                        currentFaces.insert(currentFaces.end(), std::make_move_iterator(objLevels[0].begin()), std::make_move_iterator(objLevels[0].end()) );
                     }
 
                     // Handle file commands
@@ -325,14 +421,12 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
 
                         theIterator++;
 
-                        // Loop through each mesh, and then through each face of each mesh, applying the current CTM
+                        // Loop through each mesh, applying the current CTM to its faces and levels of detail
                         for (int i = 0; i < newMeshes.size(); i++){
-                            for (unsigned int j = 0; j < newMeshes[i].faces.size(); j++){
-                                newMeshes[i].faces[j].transform(&CTM);
-                            }
+                            newMeshes[i].transform(&CTM);
                         }
                         // Add the new meshes to our final collection of meshes:
-                        extractedMeshes.insert(extractedMeshes.end(), newMeshes.begin(), newMeshes.end() );
+                        extractedMeshes.insert(extractedMeshes.end(), std::make_move_iterator(newMeshes.begin()), std::make_move_iterator(newMeshes.end()) );
                     }
 
                     // Handle line commands:
@@ -376,7 +470,7 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
                         newFace.transform(&CTM); // Apply the CTM to the line
 
                         // Place the new line into the vector:
-                        currentFaces.emplace_back(newFace);
+                        currentFaces.emplace_back(std::move(newFace));
                     }
 
                     // Handle "polygon" or "triangle" commands:
@@ -455,7 +549,7 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
                         newFace.faceNormal = faceNormal;
 
                         // Place the new face in the vector:
-                        currentFaces.emplace_back(newFace);
+                        currentFaces.emplace_back(std::move(newFace));
                     }
 
                     // Handle closed brace "}": Pop the top of the matrix stack, overwriting the CTM with the popped matrix
@@ -464,22 +558,20 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
                         CTM = theCTMStack.top();
                         theCTMStack.pop();
 
-                        // Apply the current CTM to the faces from the block
+                        // Apply the current CTM to the faces from the block, and their levels of detail
                         for (unsigned int i = 0; i < currentFaces.size(); i++){
                             currentFaces[i].transform(&CTM);
                         }
+                        for (auto &currentChain : currentLodChains){
+                            for (auto &currentLevel : currentChain.coarserLevels){
+                                for (auto &currentFace : currentLevel)
+                                    currentFace.transform(&CTM);
+                            }
+                        }
 
                         // Insert the processed faces into the final mesh object:
                         if (currentFaces.size() > 0 ){
-                            Mesh newMesh;
-                            newMesh.faces = currentFaces;
-                            currentFaces.clear();
-
-                            // Set the mesh flags:
-                            newMesh.isWireframe = isWireframe;
-
-                            // Add the mesh
-                            extractedMeshes.emplace_back( newMesh );
+                            extractedMeshes.emplace_back( assembleMesh(&currentFaces, &currentLodChains, isWireframe) );
                         }
 
                         if (!currentUseSurfaceColor) // Handle recursive cases where we've inherited a color and it needs to apply to the loaded file
@@ -503,17 +595,47 @@ vector<Mesh> FileInterpreter::getMeshHelper(string filename, bool currentIsWiref
 
     // Insert any final set of faces into a mesh, and add it to the scene
     if (currentFaces.size() > 0){
+        extractedMeshes.emplace_back( assembleMesh(&currentFaces, &currentLodChains, isWireframe) );
+    }
+
+    return extractedMeshes;
+}
+
+// Assemble a mesh from a set of faces, building its levels of detail from any LOD chains among the faces. Empties the faces and chains
+// Return: The assembled mesh
+Mesh FileInterpreter::assembleMesh(vector<Polygon>* faces, vector<LodChain>* lodChains, bool isWireframe){
+    Mesh newMesh;
+
+    // The mesh has as many levels as its longest chain
+    unsigned int numCoarserLevels = 0;
+    for (auto &currentChain : *lodChains)
+        numCoarserLevels = std::max(numCoarserLevels, (unsigned int)currentChain.coarserLevels.size());
+
+    // Each coarser level is made of the faces that aren't part of any chain, and each chain's version of that level. Shorter chains use their coarsest level
+    newMesh.lodLevels.resize(numCoarserLevels);
+    for (unsigned int level = 0; level < numCoarserLevels; level++){
+        vector<Polygon>& levelFaces = newMesh.lodLevels[level];
 
-        Mesh newMesh;
-        newMesh.faces = currentFaces;
+        unsigned int nextFace = 0;
+        for (auto &currentChain : *lodChains){
+            levelFaces.insert(levelFaces.end(), faces->begin() + nextFace, faces->begin() + currentChain.firstFace);
 
-        // Set the mesh flags:
-        newMesh.isWireframe = isWireframe;
+            vector<Polygon>& chainLevel = currentChain.coarserLevels[std::min(level, (unsigned int)currentChain.coarserLevels.size() - 1)];
+            levelFaces.insert(levelFaces.end(), chainLevel.begin(), chainLevel.end());
 
-        extractedMeshes.emplace_back( newMesh );
+            nextFace = currentChain.firstFace + currentChain.numFaces;
+        }
+        levelFaces.insert(levelFaces.end(), faces->begin() + nextFace, faces->end());
     }
 
-    return extractedMeshes;
+    newMesh.faces = std::move(*faces);
+    faces->clear(); // Ensure the moved-from vector is in a known (empty) state
+    lodChains->clear();
+
+    // Set the mesh flags:
+    newMesh.isWireframe = isWireframe;
+
+    return newMesh;
 }
 
 // Interpret a string that has been read
@@ -647,6 +769,8 @@ vector<Polygon> FileInterpreter::getPolysFromObj(string filename){
     vector<NormalVector> theNormals; // We burn the first index with a dummy vertex to maintain vertex # to vector index equivalence
     theNormals.emplace_back( NormalVector() ); // Dummy vertex: All vertices from index 1 onward are valid!
 
+    dependencies.push_back(filename);
+
     ifstream* input = new ifstream(); // File reading object
     input->open(filename);
     if (input->is_open() ){
@@ -796,13 +920,13 @@ vector<Polygon> FileInterpreter::getPolysFromObj(string filename){
                         vector<Polygon>* triangulatedFaces = newFace.getTriangulatedFaces();
                         // Add the triangulated faces to the mesh:
                         for (unsigned int i = 0; i < triangulatedFaces->size(); i++){
-                            theFaces.emplace_back(triangulatedFaces->at(i) );
+                            theFaces.emplace_back( std::move(triangulatedFaces->at(i)) );
                         }
                         // Cleanup:
                         delete triangulatedFaces;
 
                     } else // Otherwise, add the new face to our vector of extracted faces:
-                        theFaces.emplace_back(newFace);
+                        theFaces.emplace_back( std::move(newFace) );
 
                 } // End "f" face command handling
                 else
@@ -818,3 +942,43 @@ vector<Polygon> FileInterpreter::getPolysFromObj(string filename){
 
     return theFaces;
 }
+
+// Generate progressively coarser versions of an obj's faces, using the autolod settings
+// Return: The coarser levels, finest first
+vector<vector<Polygon>> FileInterpreter::generateLevelsOfDetail(string objFilename, vector<Polygon>* fullDetailFaces){
+    string settingsKey = "levels " + std::to_string(autoLodLevels) + " ratio " + std::to_string(autoLodRatio);
+    string levelsKey = objFilename + " " + settingsKey;
+    auto generatedLevel = generatedLevels.find(levelsKey);
+    if (generatedLevel != generatedLevels.end())
+        return generatedLevel->second;
+
+    // Reuse the levels generated last time, unless the obj or the settings have changed:
+    vector<vector<Polygon>> levels;
+    string cacheFilename = objFilename + MESH_LEVELS_EXTENSION;
+    if (SceneSnapshot::loadMeshLevels(cacheFilename, settingsKey, &levels)){
+        generatedLevels[levelsKey] = levels;
+        return levels;
+    }
+
+    // Each level continues simplifying from the last, keeping autoLodRatio of its triangles:
+    MeshSimplifier theSimplifier(fullDetailFaces);
+    for (int i = 0; i < autoLodLevels; i++){
+        int previousTriangles = theSimplifier.getTriangleCount();
+        int targetTriangles = (int)(previousTriangles * autoLodRatio);
+        if (targetTriangles < MIN_AUTO_LOD_TRIANGLES)
+            break;
+
+        vector<Polygon> currentLevel = theSimplifier.simplify(targetTriangles);
+        if (theSimplifier.getTriangleCount() >= previousTriangles)
+            break;
+
+        levels.emplace_back(std::move(currentLevel));
+    }
+
+    // Failing to save the cache isn't an error: The levels will just be generated again next time
+    if (!SceneSnapshot::saveMeshLevels(&levels, objFilename, settingsKey, cacheFilename))
+        cout << "Warning: Could not save the levels of detail of " << objFilename << "\n";
+
+    generatedLevels[levelsKey] = levels;
+    return levels;
+}
@@ -16,11 +16,13 @@
 #include "scene.h"
 
 #include <vector>
+#include <map>
 
 
 using std::string;
 using std::list;
 using std::vector;
+using std::map;
 
 class FileInterpreter
 {
@@ -29,20 +31,47 @@ public:
     // No arg constructor
     FileInterpreter();
 
-    // Read a file and assemble a mesh, given the filename. Invokes the recursive helper function
+    // Read a file and assemble a mesh, given the filename. Loads the file's scene snapshot instead, if it has an up to date one
     // Return: A mesh object contstructed from the .simp file descriptions
     Scene buildSceneFromFile(string fileName);
 
+    // Build a scene from a .simp file, and save it as a snapshot that later calls to buildSceneFromFile() can load directly
+    // Return: The scene constructed from the .simp file descriptions
+    Scene compileScene(string fileName);
+
 private:
     Scene* currentScene; // A Scene object: Used to insert values during construction
 
+    vector<string> dependencies; // The files read while building the current scene. Changes to any of them invalidate its snapshot
+
+    // Automatic level of detail settings, applied to obj's that don't list their own levels. Set by the autolod command
+    int autoLodLevels;          // Number of coarser levels to generate. 0 = none
+    double autoLodRatio;        // The fraction of the previous level's triangles kept by each level
+
+    map<string, vector<vector<Polygon>>> generatedLevels; // The levels generated for each obj and autolod setting while building the current scene, so obj's used many times are only loaded from their cache once
+
+    // The levels of detail of an obj: Its full detail faces are part of the faces being gathered for a mesh, and its coarser levels are kept aside until the mesh is assembled
+    struct LodChain{
+        unsigned int firstFace;                 // The position of the obj's full detail faces among the mesh's faces
+        unsigned int numFaces;
+        vector<vector<Polygon>> coarserLevels;
+    };
+
     // Recursive helper function: Extracts polygons
     vector<Mesh> getMeshHelper(string filename, bool currentDrawFilled, bool currentDepthFog, bool currentAmbientLighting, bool currentUseSurfaceColor, unsigned int currentSurfaceColor, ShadingModel currentShadingModel, double currentSpecCoef, double currentSpecExponent, double currentReflectivity);
 
+    // Assemble a mesh from a set of faces, building its levels of detail from any LOD chains among the faces. Empties the faces and chains
+    // Return: The assembled mesh
+    Mesh assembleMesh(vector<Polygon>* faces, vector<LodChain>* lodChains, bool isWireframe);
+
     // Read an obj file
     // Return: A vector<Polygon> containing all of the faces described by the obj
     vector<Polygon> getPolysFromObj(string filename);
 
+    // Generate progressively coarser versions of an obj's faces, using the autolod settings. Levels are loaded from the obj's cache if it is up to date, and saved to it otherwise
+    // Return: The coarser levels, finest first. Generation stops early once the faces are too small, or can't be reduced any further
+    vector<vector<Polygon>> generateLevelsOfDetail(string objFilename, vector<Polygon>* fullDetailFaces);
+
     // Interpret a string that has been read
     // Return: A list of split and cleansed tokens
     list<string> interpretTokenLine(string newString);
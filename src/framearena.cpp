@@ -0,0 +1,134 @@
+// Frame arena object: A bump allocator for short-lived renderer temporaries. Reset once per rendered frame
+// By Adam Badke
+
+#include "framearena.h"
+
+// Constructor
+FrameArena::FrameArena(size_t newBlockSize){
+    blockSize = newBlockSize;
+
+    currentBlock = 0;
+    currentOffset = 0;
+
+    bytesInUse = 0;
+    peakBytes = 0;
+    allocationCount = 0;
+}
+
+// Destructor
+FrameArena::~FrameArena(){
+    runDestructors(0);
+
+    for (unsigned int i = 0; i < blocks.size(); i++)
+        delete [] blocks[i].memory;
+}
+
+// Allocate raw, uninitialized memory from the arena
+void* FrameArena::allocate(size_t numBytes, size_t alignment){
+    allocationCount++;
+
+    // Try to fit the allocation into the current block, or any of the following blocks we've already allocated:
+    while (currentBlock < blocks.size()){
+        size_t alignedOffset = (currentOffset + alignment - 1) & ~(alignment - 1);
+
+        if (alignedOffset + numBytes <= blocks[currentBlock].size){
+            bytesInUse += (alignedOffset - currentOffset) + numBytes;
+            if (bytesInUse > peakBytes)
+                peakBytes = bytesInUse;
+
+            currentOffset = alignedOffset + numBytes;
+
+            return blocks[currentBlock].memory + alignedOffset;
+        }
+
+        // Skip to the next block. Count the unused tail of this one, so rewinding restores the correct total
+        bytesInUse += blocks[currentBlock].size - currentOffset;
+
+        currentBlock++;
+        currentOffset = 0;
+
+        // If the next block is too small for this allocation, insert a dedicated block ahead of it:
+        if (currentBlock < blocks.size() && blocks[currentBlock].size < numBytes + alignment)
+            break;
+    }
+
+    // Allocate a new block. Oversized requests get a block of their own
+    Block newBlock;
+    newBlock.size = (numBytes + alignment > blockSize) ? numBytes + alignment : blockSize;
+    newBlock.memory = new char[newBlock.size];
+    blocks.insert(blocks.begin() + currentBlock, newBlock);
+
+    // New blocks are allocated with new[], which is suitably aligned for any fundamental type
+    bytesInUse += numBytes;
+    if (bytesInUse > peakBytes)
+        peakBytes = bytesInUse;
+
+    currentOffset = numBytes;
+
+    return newBlock.memory;
+}
+
+// Get a marker for the current arena position
+FrameArena::Marker FrameArena::getMarker() const{
+    Marker theMarker;
+    theMarker.blockIndex = currentBlock;
+    theMarker.blockOffset = currentOffset;
+    theMarker.bytesInUse = bytesInUse;
+    theMarker.numDestructors = destructors.size();
+
+    return theMarker;
+}
+
+// Free everything allocated since the marker was taken
+void FrameArena::rewind(const Marker& marker){
+    runDestructors(marker.numDestructors);
+
+    currentBlock = marker.blockIndex;
+    currentOffset = marker.blockOffset;
+    bytesInUse = marker.bytesInUse;
+}
+
+// Free everything, and reset the per-frame statistics. Called at the start of each frame
+void FrameArena::reset(){
+    runDestructors(0);
+
+    currentBlock = 0;
+    currentOffset = 0;
+
+    bytesInUse = 0;
+    peakBytes = 0;
+    allocationCount = 0;
+}
+
+// Run the destructors registered after a given point, in reverse order of construction
+void FrameArena::runDestructors(size_t firstRecord){
+    while (destructors.size() > firstRecord){
+        DestructorRecord& current = destructors.back();
+        current.destroy(current.object, current.count);
+        destructors.pop_back();
+    }
+}
+
+// Peak number of bytes in use since the last reset
+size_t FrameArena::getPeakBytes() const{
+    return peakBytes;
+}
+
+// Number of allocations made since the last reset
+size_t FrameArena::getAllocationCount() const{
+    return allocationCount;
+}
+
+// Total memory held by the arena's blocks
+size_t FrameArena::getReservedBytes() const{
+    size_t total = 0;
+    for (unsigned int i = 0; i < blocks.size(); i++)
+        total += blocks[i].size;
+
+    return total;
+}
+
+// Number of blocks the arena has requested from the system
+unsigned int FrameArena::getBlockCount() const{
+    return (unsigned int)blocks.size();
+}
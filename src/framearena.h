@@ -0,0 +1,158 @@
+// Frame arena object: A bump allocator for short-lived renderer temporaries. Reset once per rendered frame
+// By Adam Badke
+
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+class FrameArena
+{
+public:
+    // A saved arena position. Rewinding to a marker frees everything allocated after it was taken
+    struct Marker{
+        unsigned int blockIndex;
+        size_t blockOffset;
+        size_t bytesInUse;
+        size_t numDestructors;
+    };
+
+    // Constructor
+    FrameArena(size_t newBlockSize = 64 * 1024);
+
+    // Destructor
+    ~FrameArena();
+
+    // Allocate raw, uninitialized memory from the arena
+    void* allocate(size_t numBytes, size_t alignment);
+
+    // Allocate and default construct an array of objects. Destructors (if any) are run when the arena is rewound past them
+    template <typename T>
+    T* allocateArray(unsigned int count);
+
+    // Allocate and construct a single object. Its destructor (if any) is run when the arena is rewound past it
+    template <typename T, typename... Args>
+    T* create(Args&&... args);
+
+    // Get a marker for the current arena position
+    Marker getMarker() const;
+
+    // Free everything allocated since the marker was taken
+    void rewind(const Marker& marker);
+
+    // Free everything, and reset the per-frame statistics. Called at the start of each frame
+    void reset();
+
+    // Per-frame statistics:
+    size_t getPeakBytes() const;            // Peak number of bytes in use since the last reset
+    size_t getAllocationCount() const;      // Number of allocations made since the last reset
+    size_t getReservedBytes() const;        // Total memory held by the arena's blocks
+    unsigned int getBlockCount() const;     // Number of blocks the arena has requested from the system
+
+private:
+    // A contiguous chunk of memory that allocations are bumped out of
+    struct Block{
+        char* memory;
+        size_t size;
+    };
+
+    // A record of an object (or array of objects) that needs its destructor called on rewind
+    struct DestructorRecord{
+        void (*destroy)(void* object, unsigned int count);
+        void* object;
+        unsigned int count;
+    };
+
+    vector<Block> blocks;               // Blocks are kept for reuse between frames
+    vector<DestructorRecord> destructors;
+
+    size_t blockSize;                   // Default size of newly allocated blocks
+    unsigned int currentBlock;          // Index of the block currently being bumped
+    size_t currentOffset;               // Offset of the next free byte in the current block
+
+    size_t bytesInUse;
+    size_t peakBytes;
+    size_t allocationCount;
+
+    // Run the destructors registered after a given point, in reverse order of construction
+    void runDestructors(size_t firstRecord);
+
+    // Register a destructor for an array of objects
+    template <typename T>
+    void registerDestructor(T* object, unsigned int count);
+
+    // Type erased destructor helper
+    template <typename T>
+    static void destroyObjects(void* object, unsigned int count);
+};
+
+// RAII helper: Rewinds an arena to its position at construction when the scope ends
+class ArenaScope
+{
+public:
+    // Constructor
+    explicit ArenaScope(FrameArena* arena) : theArena(arena), theMarker(arena->getMarker()) {}
+
+    // Destructor
+    ~ArenaScope() { theArena->rewind(theMarker); }
+
+private:
+    ArenaScope(const ArenaScope&);              // Non-copyable
+    ArenaScope& operator=(const ArenaScope&);
+
+    FrameArena* theArena;
+    FrameArena::Marker theMarker;
+};
+
+// Template definitions:
+//**********************
+
+// Allocate and default construct an array of objects
+template <typename T>
+T* FrameArena::allocateArray(unsigned int count){
+    T* result = static_cast<T*>( allocate(sizeof(T) * count, alignof(T)) );
+    for (unsigned int i = 0; i < count; i++)
+        new (&result[i]) T();
+
+    registerDestructor(result, count);
+
+    return result;
+}
+
+// Allocate and construct a single object
+template <typename T, typename... Args>
+T* FrameArena::create(Args&&... args){
+    T* result = new ( allocate(sizeof(T), alignof(T)) ) T( std::forward<Args>(args)... );
+
+    registerDestructor(result, 1);
+
+    return result;
+}
+
+// Register a destructor for an array of objects. Trivially destructible types are skipped
+template <typename T>
+void FrameArena::registerDestructor(T* object, unsigned int count){
+    if (!std::is_trivially_destructible<T>::value){
+        DestructorRecord newRecord;
+        newRecord.destroy = &FrameArena::destroyObjects<T>;
+        newRecord.object = object;
+        newRecord.count = count;
+        destructors.push_back(newRecord);
+    }
+}
+
+// Type erased destructor helper
+template <typename T>
+void FrameArena::destroyObjects(void* object, unsigned int count){
+    T* objects = static_cast<T*>(object);
+    for (unsigned int i = count; i > 0; i--)
+        objects[i - 1].~T();
+}
+
+#endif // FRAMEARENA_H
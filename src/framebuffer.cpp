@@ -0,0 +1,148 @@
+// Frame buffer object: The renderer's internal linear float RGBA color buffer. Quantized to packed ARGB only when presented to a Drawable
+// By Adam Badke
+
+#include "framebuffer.h"
+
+// Scale factors between 8 bit color channels and linear floats:
+const float CHANNEL_TO_FLOAT = 1.0f / 255.0f;
+const float FLOAT_TO_CHANNEL = 255.0f;
+
+// Quantize a linear float channel to 8 bits, clamping it to [0, 255]
+static unsigned int quantizeChannel(float value){
+    if (value <= 0.0f)
+        return 0;
+    if (value >= 1.0f)
+        return 255;
+
+    return (unsigned int)(value * FLOAT_TO_CHANNEL + 0.5f);
+}
+
+// Constructor
+FrameBuffer::FrameBuffer(int newWidth, int newHeight){
+    width = newWidth;
+    height = newHeight;
+
+    pixels.assign(width * height * 4, 0.0f);
+    quantized.assign(width * height, 0);
+
+    clearDirty();
+}
+
+// Write a packed 32 bit ARGB color to a pixel
+void FrameBuffer::setPixel(int x, int y, unsigned int color){
+    float* pixel = &pixels[(y * width + x) * 4];
+    pixel[0] = ((color >> 16) & 0xff) * CHANNEL_TO_FLOAT;
+    pixel[1] = ((color >> 8) & 0xff) * CHANNEL_TO_FLOAT;
+    pixel[2] = (color & 0xff) * CHANNEL_TO_FLOAT;
+    pixel[3] = ((color >> 24) & 0xff) * CHANNEL_TO_FLOAT;
+
+    markDirty(x, y);
+}
+
+// Write a linear float color to a pixel. Channels are in [0, 1]
+void FrameBuffer::setPixel(int x, int y, float red, float green, float blue, float alpha){
+    float* pixel = &pixels[(y * width + x) * 4];
+    pixel[0] = red;
+    pixel[1] = green;
+    pixel[2] = blue;
+    pixel[3] = alpha;
+
+    markDirty(x, y);
+}
+
+// Write a linear float color to a pixel
+void FrameBuffer::setPixel(int x, int y, const Color& color){
+    setPixel(x, y, color.red(), color.green(), color.blue(), color.alpha());
+}
+
+// Get a pixel's color, quantized to a packed 32 bit ARGB value
+unsigned int FrameBuffer::getPixel(int x, int y) const{
+    const float* pixel = &pixels[(y * width + x) * 4];
+
+    return (quantizeChannel(pixel[3]) << 24) | (quantizeChannel(pixel[0]) << 16) | (quantizeChannel(pixel[1]) << 8) | quantizeChannel(pixel[2]);
+}
+
+// Get a pixel's linear float color
+Color FrameBuffer::getColor(int x, int y) const{
+    const float* pixel = &pixels[(y * width + x) * 4];
+
+    return Color(pixel[0], pixel[1], pixel[2], pixel[3]);
+}
+
+// Fill a rectangle of pixels with a packed ARGB color. The rectangle is clamped to the buffer
+void FrameBuffer::fillRectangle(int topLeftX, int topLeftY, int botRightX, int botRightY, unsigned int color){
+    if (topLeftX < 0)
+        topLeftX = 0;
+    if (topLeftY < 0)
+        topLeftY = 0;
+    if (botRightX > width - 1)
+        botRightX = width - 1;
+    if (botRightY > height - 1)
+        botRightY = height - 1;
+
+    for (int y = topLeftY; y <= botRightY; y++){
+        for (int x = topLeftX; x <= botRightX; x++){
+            setPixel(x, y, color);
+        }
+    }
+}
+
+// Check whether any pixels have been written since the last presentation
+bool FrameBuffer::isDirty() const{
+    return dirtyXMin <= dirtyXMax;
+}
+
+// Quantize the pixels written since the last presentation, and blit them to a drawable in a single call
+void FrameBuffer::present(Drawable* theDrawable){
+    if (!isDirty())
+        return;
+
+    // Quantize the dirty rectangle into the staging buffer:
+    for (int y = dirtyYMin; y <= dirtyYMax; y++){
+        const float* pixel = &pixels[(y * width + dirtyXMin) * 4];
+        unsigned int* destination = &quantized[y * width + dirtyXMin];
+
+        for (int x = dirtyXMin; x <= dirtyXMax; x++){
+            *destination = (quantizeChannel(pixel[3]) << 24) | (quantizeChannel(pixel[0]) << 16) | (quantizeChannel(pixel[1]) << 8) | quantizeChannel(pixel[2]);
+
+            pixel += 4;
+            destination++;
+        }
+    }
+
+    // Hand the whole rectangle to the drawable at once:
+    theDrawable->setPixels(dirtyXMin, dirtyYMin, dirtyXMax - dirtyXMin + 1, dirtyYMax - dirtyYMin + 1, &quantized[dirtyYMin * width + dirtyXMin], width);
+    theDrawable->updateScreen();
+
+    clearDirty();
+}
+
+// Expand the dirty rectangle to include a pixel
+void FrameBuffer::markDirty(int x, int y){
+    if (x < dirtyXMin)
+        dirtyXMin = x;
+    if (x > dirtyXMax)
+        dirtyXMax = x;
+    if (y < dirtyYMin)
+        dirtyYMin = y;
+    if (y > dirtyYMax)
+        dirtyYMax = y;
+}
+
+// Reset the dirty rectangle to be empty
+void FrameBuffer::clearDirty(){
+    dirtyXMin = width;
+    dirtyYMin = height;
+    dirtyXMax = -1;
+    dirtyYMax = -1;
+}
+
+// Buffer width, in pixels
+int FrameBuffer::getWidth() const{
+    return width;
+}
+
+// Buffer height, in pixels
+int FrameBuffer::getHeight() const{
+    return height;
+}
@@ -0,0 +1,68 @@
+// Frame buffer object: The renderer's internal linear float RGBA color buffer. Quantized to packed ARGB only when presented to a Drawable
+// By Adam Badke
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "drawable.h"
+#include "color.h"
+#include <vector>
+
+using std::vector;
+
+class FrameBuffer
+{
+public:
+    // Constructor
+    FrameBuffer(int newWidth, int newHeight);
+
+    // Write a packed 32 bit ARGB color to a pixel
+    // Pre-condition: (x, y) is inside the buffer, in UI window space (ie. (0,0) is in the top left of the screen!)
+    void setPixel(int x, int y, unsigned int color);
+
+    // Write a linear float color to a pixel. Channels are in [0, 1]
+    // Pre-condition: (x, y) is inside the buffer, in UI window space
+    void setPixel(int x, int y, float red, float green, float blue, float alpha);
+
+    // Write a linear float color to a pixel
+    // Pre-condition: (x, y) is inside the buffer, in UI window space
+    void setPixel(int x, int y, const Color& color);
+
+    // Get a pixel's color, quantized to a packed 32 bit ARGB value
+    // Pre-condition: (x, y) is inside the buffer, in UI window space
+    unsigned int getPixel(int x, int y) const;
+
+    // Get a pixel's linear float color
+    // Pre-condition: (x, y) is inside the buffer, in UI window space
+    Color getColor(int x, int y) const;
+
+    // Fill a rectangle of pixels with a packed ARGB color. The rectangle is clamped to the buffer
+    void fillRectangle(int topLeftX, int topLeftY, int botRightX, int botRightY, unsigned int color);
+
+    // Check whether any pixels have been written since the last presentation
+    bool isDirty() const;
+
+    // Quantize the pixels written since the last presentation, and blit them to a drawable in a single call
+    void present(Drawable* theDrawable);
+
+    // Buffer dimensions, in pixels
+    int getWidth() const;
+    int getHeight() const;
+
+private:
+    int width, height;
+
+    vector<float> pixels;               // Linear RGBA channels, 4 floats per pixel, stored row by row
+    vector<unsigned int> quantized;     // Staging buffer of packed ARGB values, handed to the drawable when presenting
+
+    // The bounds of the pixels written since the last presentation. Empty when dirtyXMin > dirtyXMax
+    int dirtyXMin, dirtyYMin, dirtyXMax, dirtyYMax;
+
+    // Expand the dirty rectangle to include a pixel
+    void markDirty(int x, int y);
+
+    // Reset the dirty rectangle to be empty
+    void clearDirty();
+};
+
+#endif // FRAMEBUFFER_H
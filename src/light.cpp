@@ -3,6 +3,8 @@
 
 #include "light.h"
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 using std::cout;
 
@@ -53,6 +55,26 @@ double Light::getAttenuationFactor(double distance){
     return (1.0 /((double) (attenuationA + (attenuationB * distance) ) ));
 }
 
+// Calculate the distance beyond which this light can't add more than cutoff to any color channel of a point
+double Light::getInfluenceRadius(double cutoff, double contributionScale) const{
+    if (cutoff <= 0)
+        return std::numeric_limits<double>::infinity();
+
+    // The light's largest possible contribution at distance d is maxContribution / (attenuationA + attenuationB * d)
+    double maxContribution = std::max(redIntensity, std::max(greenIntensity, blueIntensity)) * contributionScale;
+    if (maxContribution <= 0)
+        return 0;
+
+    // Solve maxContribution / (attenuationA + attenuationB * d) = cutoff for d. Without distance attenuation, the light is either always or never significant
+    double minAttenuationDenominator = maxContribution / cutoff;
+    if (attenuationB == 0)
+        return attenuationA > minAttenuationDenominator ? 0 : std::numeric_limits<double>::infinity();
+    if (attenuationB < 0)
+        return std::numeric_limits<double>::infinity();
+
+    return std::max( (minAttenuationDenominator - attenuationA) / attenuationB, 0.0 );
+}
+
 // Debug this light:
 void Light::debug(){
     cout << "\nLight: ";
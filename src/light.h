@@ -25,6 +25,11 @@ public:
     // Calculate the attenuation of this light to a point, as a ratio
     double getAttenuationFactor(double distance);
 
+    // Calculate the distance beyond which this light can't add more than cutoff to any color channel of a point
+    // contributionScale bounds the light's contribution to a point, as a multiple of its brightest attenuated intensity
+    // Return: The distance, or infinity if the light never falls below the cutoff
+    double getInfluenceRadius(double cutoff, double contributionScale) const;
+
     // Light attributes:
     Vertex position; // This lights position, as a point in space
 
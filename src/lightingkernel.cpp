@@ -0,0 +1,179 @@
+// Lighting kernel: Computes light geometry for a batch of surface points at once, vectorized with SSE2 where available
+// By Adam Badke
+
+#include "lightingkernel.h"
+
+#include <cmath>
+
+// Use SSE2 wherever the compiler targets it (always the case for x86-64):
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define LIGHTING_KERNEL_USE_SSE
+    #include <emmintrin.h>
+#endif
+
+// Rebuild the list from a collection of lights, finding each light's influence radius for a contribution cutoff
+void LightList::build(const vector<Light>& lights, double cutoff, double contributionScale){
+    unsigned int numLights = (unsigned int)lights.size();
+
+    positionX.resize(numLights);
+    positionY.resize(numLights);
+    positionZ.resize(numLights);
+    redIntensity.resize(numLights);
+    greenIntensity.resize(numLights);
+    blueIntensity.resize(numLights);
+    attenuationA.resize(numLights);
+    attenuationB.resize(numLights);
+    influenceRadius.resize(numLights);
+
+    for (unsigned int i = 0; i < numLights; i++){
+        positionX[i] = lights[i].position.x;
+        positionY[i] = lights[i].position.y;
+        positionZ[i] = lights[i].position.z;
+
+        redIntensity[i] = lights[i].redIntensity;
+        greenIntensity[i] = lights[i].greenIntensity;
+        blueIntensity[i] = lights[i].blueIntensity;
+
+        attenuationA[i] = lights[i].attenuationA;
+        attenuationB[i] = lights[i].attenuationB;
+
+        influenceRadius[i] = lights[i].getInfluenceRadius(cutoff, contributionScale);
+    }
+}
+
+// Get the number of lights in the list
+unsigned int LightList::size() const{
+    return (unsigned int)positionX.size();
+}
+
+// Clear every tile's list, and resize the grid
+void LightTileGrid::reset(int newColumns, int newRows){
+    columns = newColumns;
+    rows = newRows;
+
+    tileStarts.clear();
+    tileStarts.push_back(0);
+    lights.clear();
+}
+
+// Append a light to the list of the next tile
+void LightTileGrid::addLight(unsigned int lightIndex){
+    lights.push_back(lightIndex);
+}
+
+// Finish the list of the current tile, and move to the next one
+void LightTileGrid::finishTile(){
+    tileStarts.push_back((unsigned int)lights.size());
+}
+
+// Get the number of tiles in the grid
+int LightTileGrid::getTileCount() const{
+    return columns * rows;
+}
+
+// Get the number of lights listed by all of the tiles
+unsigned int LightTileGrid::getListedLightCount() const{
+    return (unsigned int)lights.size();
+}
+
+// Compute the geometry of one light for every point in a batch
+void computeLightGeometry(const LightList& lights, unsigned int lightIndex, const SurfacePointBatch& points, LightGeometryBatch* result){
+
+    double lightX = lights.positionX[lightIndex];
+    double lightY = lights.positionY[lightIndex];
+    double lightZ = lights.positionZ[lightIndex];
+    double attenuationA = lights.attenuationA[lightIndex];
+    double attenuationB = lights.attenuationB[lightIndex];
+
+#ifdef LIGHTING_KERNEL_USE_SSE
+    __m128d lightXs = _mm_set1_pd(lightX);
+    __m128d lightYs = _mm_set1_pd(lightY);
+    __m128d lightZs = _mm_set1_pd(lightZ);
+    __m128d attenuationAs = _mm_set1_pd(attenuationA);
+    __m128d attenuationBs = _mm_set1_pd(attenuationB);
+    __m128d ones = _mm_set1_pd(1.0);
+    __m128d twos = _mm_set1_pd(2.0);
+
+    for (int i = 0; i < points.count; i += LIGHTING_BATCH_WIDTH){
+        // Light direction: Points from the surface towards the light
+        __m128d directionX = _mm_sub_pd(lightXs, _mm_loadu_pd(&points.positionX[i]));
+        __m128d directionY = _mm_sub_pd(lightYs, _mm_loadu_pd(&points.positionY[i]));
+        __m128d directionZ = _mm_sub_pd(lightZs, _mm_loadu_pd(&points.positionZ[i]));
+
+        // The distance doubles as the length used to normalize the direction:
+        __m128d distance = _mm_sqrt_pd( _mm_add_pd( _mm_add_pd( _mm_mul_pd(directionX, directionX), _mm_mul_pd(directionY, directionY) ), _mm_mul_pd(directionZ, directionZ) ) );
+        __m128d inverseLength = _mm_div_pd(ones, distance);
+        directionX = _mm_mul_pd(directionX, inverseLength);
+        directionY = _mm_mul_pd(directionY, inverseLength);
+        directionZ = _mm_mul_pd(directionZ, inverseLength);
+
+        // Cosine of the angle between the normal and the light direction:
+        __m128d normalX = _mm_loadu_pd(&points.normalX[i]);
+        __m128d normalY = _mm_loadu_pd(&points.normalY[i]);
+        __m128d normalZ = _mm_loadu_pd(&points.normalZ[i]);
+        __m128d normalDotLight = _mm_add_pd( _mm_add_pd( _mm_mul_pd(normalX, directionX), _mm_mul_pd(normalY, directionY) ), _mm_mul_pd(normalZ, directionZ) );
+
+        // Attenuation:
+        __m128d attenuation = _mm_div_pd( ones, _mm_add_pd(attenuationAs, _mm_mul_pd(attenuationBs, distance)) );
+
+        // Reflect the light direction about the normal, and normalize it:
+        __m128d scale = _mm_mul_pd(twos, normalDotLight);
+        __m128d reflectionX = _mm_sub_pd( _mm_mul_pd(normalX, scale), directionX );
+        __m128d reflectionY = _mm_sub_pd( _mm_mul_pd(normalY, scale), directionY );
+        __m128d reflectionZ = _mm_sub_pd( _mm_mul_pd(normalZ, scale), directionZ );
+        __m128d inverseReflectionLength = _mm_div_pd( ones, _mm_sqrt_pd( _mm_add_pd( _mm_add_pd( _mm_mul_pd(reflectionX, reflectionX), _mm_mul_pd(reflectionY, reflectionY) ), _mm_mul_pd(reflectionZ, reflectionZ) ) ) );
+        reflectionX = _mm_mul_pd(reflectionX, inverseReflectionLength);
+        reflectionY = _mm_mul_pd(reflectionY, inverseReflectionLength);
+        reflectionZ = _mm_mul_pd(reflectionZ, inverseReflectionLength);
+
+        // Cosine of the angle between the view vector and the reflection:
+        __m128d viewDotReflection = _mm_add_pd( _mm_add_pd( _mm_mul_pd(_mm_loadu_pd(&points.viewX[i]), reflectionX), _mm_mul_pd(_mm_loadu_pd(&points.viewY[i]), reflectionY) ), _mm_mul_pd(_mm_loadu_pd(&points.viewZ[i]), reflectionZ) );
+
+        // Store the results:
+        _mm_storeu_pd(&result->directionX[i], directionX);
+        _mm_storeu_pd(&result->directionY[i], directionY);
+        _mm_storeu_pd(&result->directionZ[i], directionZ);
+        _mm_storeu_pd(&result->distance[i], distance);
+        _mm_storeu_pd(&result->normalDotLight[i], normalDotLight);
+        _mm_storeu_pd(&result->viewDotReflection[i], viewDotReflection);
+        _mm_storeu_pd(&result->attenuation[i], attenuation);
+    }
+
+#else // Scalar fallback:
+    for (int i = 0; i < points.count; i++){
+        // Light direction: Points from the surface towards the light
+        double directionX = lightX - points.positionX[i];
+        double directionY = lightY - points.positionY[i];
+        double directionZ = lightZ - points.positionZ[i];
+
+        // The distance doubles as the length used to normalize the direction:
+        double distance = sqrt( (directionX * directionX) + (directionY * directionY) + (directionZ * directionZ) );
+        double inverseLength = 1 / distance;
+        directionX *= inverseLength;
+        directionY *= inverseLength;
+        directionZ *= inverseLength;
+
+        // Cosine of the angle between the normal and the light direction:
+        double normalDotLight = (points.normalX[i] * directionX) + (points.normalY[i] * directionY) + (points.normalZ[i] * directionZ);
+
+        // Reflect the light direction about the normal, and normalize it:
+        double scale = 2 * normalDotLight;
+        double reflectionX = (points.normalX[i] * scale) - directionX;
+        double reflectionY = (points.normalY[i] * scale) - directionY;
+        double reflectionZ = (points.normalZ[i] * scale) - directionZ;
+        double inverseReflectionLength = 1 / sqrt( (reflectionX * reflectionX) + (reflectionY * reflectionY) + (reflectionZ * reflectionZ) );
+        reflectionX *= inverseReflectionLength;
+        reflectionY *= inverseReflectionLength;
+        reflectionZ *= inverseReflectionLength;
+
+        // Store the results:
+        result->directionX[i] = directionX;
+        result->directionY[i] = directionY;
+        result->directionZ[i] = directionZ;
+        result->distance[i] = distance;
+        result->normalDotLight[i] = normalDotLight;
+        result->viewDotReflection[i] = (points.viewX[i] * reflectionX) + (points.viewY[i] * reflectionY) + (points.viewZ[i] * reflectionZ);
+        result->attenuation[i] = 1.0 / (attenuationA + (attenuationB * distance));
+    }
+#endif // LIGHTING_KERNEL_USE_SSE
+}
@@ -0,0 +1,79 @@
+// Lighting kernel: Computes light geometry for a batch of surface points at once, vectorized with SSE2 where available
+// By Adam Badke
+
+#ifndef LIGHTINGKERNEL_H
+#define LIGHTINGKERNEL_H
+
+#include "light.h"
+#include <vector>
+
+using std::vector;
+
+// Number of points processed together by the kernel. Surface point arrays must be padded to a multiple of this
+const int LIGHTING_BATCH_WIDTH = 2;
+
+// A collection of lights, in structure of arrays form
+class LightList
+{
+public:
+    // Rebuild the list from a collection of lights, finding each light's influence radius for a contribution cutoff (see Light::getInfluenceRadius())
+    void build(const vector<Light>& lights, double cutoff, double contributionScale);
+
+    // Get the number of lights in the list
+    unsigned int size() const;
+
+    // Light attributes:
+    vector<double> positionX, positionY, positionZ;
+    vector<double> redIntensity, greenIntensity, blueIntensity;
+    vector<double> attenuationA, attenuationB;
+    vector<double> influenceRadius;     // Points at least this far from a light are not lit by it. Infinite if the light is never culled
+};
+
+// Lists of the lights that can reach each tile of the screen, in compressed form: The lights of tile t are lights[tileStarts[t]] to lights[tileStarts[t + 1] - 1]
+class LightTileGrid
+{
+public:
+    // Clear every tile's list, and resize the grid
+    void reset(int newColumns, int newRows);
+
+    // Append a light to the list of the next tile. Tiles are filled in order, one at a time
+    void addLight(unsigned int lightIndex);
+
+    // Finish the list of the current tile, and move to the next one
+    void finishTile();
+
+    // Get the number of tiles in the grid
+    int getTileCount() const;
+
+    // Get the number of lights listed by all of the tiles
+    unsigned int getListedLightCount() const;
+
+    int columns = 0, rows = 0;
+    vector<unsigned int> tileStarts;    // The index of each tile's first light, and the end of the last tile's list
+    vector<unsigned int> lights;
+};
+
+// A batch of surface points, in structure of arrays form
+struct SurfacePointBatch
+{
+    int count;                                  // The number of valid points. Arrays hold count rounded up to a multiple of LIGHTING_BATCH_WIDTH
+    double *positionX, *positionY, *positionZ;
+    double *normalX, *normalY, *normalZ;        // Normalized surface normals
+    double *viewX, *viewY, *viewZ;              // Normalized view vectors: Point from the surface towards the viewer
+};
+
+// The geometry of a single light, relative to each point in a batch
+struct LightGeometryBatch
+{
+    double *directionX, *directionY, *directionZ;  // Normalized light directions: Point from the surface towards the light
+    double *distance;                               // Distance from the surface to the light
+    double *normalDotLight;                         // Cosine of the angle between the surface normal and the light direction
+    double *viewDotReflection;                      // Cosine of the angle between the view vector and the reflected light direction
+    double *attenuation;                            // The light's attenuation factor at the surface
+};
+
+// Compute the geometry of one light for every point in a batch
+// Note: Uses the same operations, in the same order, as NormalVector and Light. Results are identical to the scalar calculations
+void computeLightGeometry(const LightList& lights, unsigned int lightIndex, const SurfacePointBatch& points, LightGeometryBatch* result);
+
+#endif // LIGHTINGKERNEL_H
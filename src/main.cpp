@@ -1,10 +1,82 @@
 #include "window361.h"
 #include "client.h"
+#include "benchmark.h"
+#include "fileinterpreter.h"
+#include "renderserver.h"
+#include "batchrenderer.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <QThread>
+#include <QFileInfo>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <vector>
 
 int main(int argc, char *argv[])
 {
+    // Handle benchmark mode: Runs from the command line, without a window
+    if (argc == 2 && std::string(argv[1]) == "-benchmark")
+        return runBenchmarks();
+
+    // Handle compile mode: Builds a snapshot of each named scene, so they load without parsing
+    if (argc > 2 && std::string(argv[1]) == "-compile"){
+        FileInterpreter compiler;
+        for (int i = 2; i < argc; i++){
+            compiler.compileScene("./" + std::string(argv[i]) + ".simp");
+            std::cout << "Compiled " << argv[i] << ".simp\n";
+        }
+        return 0;
+    }
+
+    // Handle batch mode: Renders many scenes concurrently, saving them as images with a summary report
+    // Usage: -batch [-jobs N] [-out directory] [-report filename] items... Each item is a manifest file of requests, a wildcard pattern (eg. "page*.simp"), or a scene name
+    if (argc > 2 && std::string(argv[1]) == "-batch"){
+        QCoreApplication batchApp(argc, argv);
+        int maxConcurrentJobs = 0;
+        std::string outputDirectory = "batch";
+        std::string reportFilename = DEFAULT_BATCH_REPORT_NAME;
+        std::vector<std::string> items;
+
+        for (int i = 2; i < argc; i++){
+            std::string argument = argv[i];
+            if (argument == "-jobs" && i + 1 < argc)
+                maxConcurrentJobs = std::atoi(argv[++i]);
+            else if (argument == "-out" && i + 1 < argc)
+                outputDirectory = argv[++i];
+            else if (argument == "-report" && i + 1 < argc)
+                reportFilename = argv[++i];
+            else
+                items.push_back(argument);
+        }
+
+        BatchRenderer batch(maxConcurrentJobs);
+        for (auto& item : items){
+            QFileInfo itemInfo(QString::fromStdString(item));
+            if (itemInfo.isFile() && itemInfo.suffix() != "simp"){
+                if (!batch.addManifest(item))
+                    return 1;
+            }
+            else
+                batch.addScenes(item);
+        }
+
+        return batch.run(outputDirectory, reportFilename) == 0 ? 0 : 1;
+    }
+
+    // Handle server mode: Renders requests sent over a local socket, keeping scenes and renderers warm between them
+    // Usage: -server [name] [maxConcurrentJobs]
+    if (argc >= 2 && argc <= 4 && std::string(argv[1]) == "-server"){
+        QCoreApplication serverApp(argc, argv);
+        QString serverName = argc > 2 ? QString(argv[2]) : DEFAULT_RENDER_SERVER_NAME;
+        int maxConcurrentJobs = argc > 3 ? std::atoi(argv[3]) : QThread::idealThreadCount();
+
+        RenderServer server(maxConcurrentJobs, 4 * maxConcurrentJobs);
+        if (!server.listen(serverName))
+            return 1;
+
+        return serverApp.exec();
+    }
 
     QApplication app(argc, argv);   // because it's a Qt application
     Window361 window;               // make and show the window--size is already correct
@@ -4,6 +4,11 @@
 #include "mesh.h"
 #include "polygon.h"
 #include <iostream>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
 
 using std::cout;
 
@@ -18,17 +23,52 @@ Mesh::Mesh(){
 // Copy Constructor
 Mesh::Mesh(const Mesh &existingMesh){
     faces = existingMesh.faces;
+    lodLevels = existingMesh.lodLevels;
+    activeLod = existingMesh.activeLod;
     isWireframe = existingMesh.isWireframe;
 
     boundingBoxFaces = existingMesh.boundingBoxFaces;
+    clusters = existingMesh.clusters;
+    faceClusters = existingMesh.faceClusters;
+}
+
+// Move Constructor
+Mesh::Mesh(Mesh&& existingMesh) noexcept {
+    faces = std::move(existingMesh.faces);
+    lodLevels = std::move(existingMesh.lodLevels);
+    activeLod = existingMesh.activeLod;
+    isWireframe = existingMesh.isWireframe;
+
+    boundingBoxFaces = std::move(existingMesh.boundingBoxFaces);
+    clusters = std::move(existingMesh.clusters);
+    faceClusters = std::move(existingMesh.faceClusters);
 }
 
 // Overloaded assignment operator
+// Note: Polygons are assigned element-wise, so refilling a Mesh with the same topology reuses its existing storage
 Mesh& Mesh::operator=(const Mesh& rhs){
     this->faces = rhs.faces;
+    this->lodLevels = rhs.lodLevels;
+    this->activeLod = rhs.activeLod;
     this->isWireframe = rhs.isWireframe;
 
     this->boundingBoxFaces = rhs.boundingBoxFaces;
+    this->clusters = rhs.clusters;
+    this->faceClusters = rhs.faceClusters;
+
+    return *this;
+}
+
+// Overloaded move assignment operator
+Mesh& Mesh::operator=(Mesh&& rhs) noexcept {
+    this->faces = std::move(rhs.faces);
+    this->lodLevels = std::move(rhs.lodLevels);
+    this->activeLod = rhs.activeLod;
+    this->isWireframe = rhs.isWireframe;
+
+    this->boundingBoxFaces = std::move(rhs.boundingBoxFaces);
+    this->clusters = std::move(rhs.clusters);
+    this->faceClusters = std::move(rhs.faceClusters);
 
     return *this;
 }
@@ -46,10 +86,20 @@ void Mesh::transform(TransformationMatrix* theMatrix, bool doRound){
         faces[i].transform(theMatrix, doRound);
     }
 
+    // Transform the faces of each level of detail:
+    for (auto &currentLevel : lodLevels){
+        for (auto &currentFace : currentLevel)
+            currentFace.transform(theMatrix, doRound);
+    }
+
     // Transform the faces of the bounding box:
     for (unsigned int i = 0; i < boundingBoxFaces.size(); i++){
         boundingBoxFaces[i].transform(theMatrix, doRound);
     }
+
+    // Bounding spheres don't survive non-uniform scaling: The clusters must be regenerated
+    clusters.clear();
+    faceClusters.clear();
 }
 
 // Generate/update a bounding box around the faces of this mesh
@@ -63,31 +113,36 @@ void Mesh::generateBoundingBox(){
     double zMin = faces[0].vertices[0].z;
     double zMax = faces[0].vertices[0].z;
 
-    for (int i = 0; i < faces.size(); i++){
+    // Bound every level of detail, so the box covers whichever level is drawn:
+    for (int level = 0; level < getLodCount(); level++){
+        vector<Polygon>& levelFaces = level == 0 ? faces : lodLevels[level - 1];
 
-        // Get the # of vertices for the current polygon once:
-        int numVertices = faces[i].getVertexCount();
+        for (int i = 0; i < levelFaces.size(); i++){
 
-        // Loop through each vertex in the polygon
-        for (int j = 0; j < numVertices; j++){
+            // Get the # of vertices for the current polygon once:
+            int numVertices = levelFaces[i].getVertexCount();
 
-            if (faces[i].vertices[j].x < xMin)
-                xMin = faces[i].vertices[j].x;
+            // Loop through each vertex in the polygon
+            for (int j = 0; j < numVertices; j++){
 
-            if (faces[i].vertices[j].x > xMax)
-                xMax = faces[i].vertices[j].x;
+                if (levelFaces[i].vertices[j].x < xMin)
+                    xMin = levelFaces[i].vertices[j].x;
 
-            if (faces[i].vertices[j].y < yMin)
-                yMin = faces[i].vertices[j].y;
+                if (levelFaces[i].vertices[j].x > xMax)
+                    xMax = levelFaces[i].vertices[j].x;
 
-            if (faces[i].vertices[j].y > yMax)
-                yMax = faces[i].vertices[j].y;
+                if (levelFaces[i].vertices[j].y < yMin)
+                    yMin = levelFaces[i].vertices[j].y;
 
-            if (faces[i].vertices[j].z < zMin)
-                zMin = faces[i].vertices[j].z;
+                if (levelFaces[i].vertices[j].y > yMax)
+                    yMax = levelFaces[i].vertices[j].y;
 
-            if (faces[i].vertices[j].z > zMax)
-                zMax = faces[i].vertices[j].z;
+                if (levelFaces[i].vertices[j].z < zMin)
+                    zMin = levelFaces[i].vertices[j].z;
+
+                if (levelFaces[i].vertices[j].z > zMax)
+                    zMax = levelFaces[i].vertices[j].z;
+            }
         }
     }
 
@@ -170,6 +225,220 @@ void Mesh::generateBoundingBox(){
 
 }
 
+// Partition the faces of each level of detail into clusters of neighbouring faces
+void Mesh::generateClusters(){
+    clusters.assign(getLodCount(), vector<MeshCluster>());
+    faceClusters.assign(getLodCount(), vector<unsigned int>());
+
+    for (int level = 0; level < getLodCount(); level++){
+        vector<Polygon>& levelFaces = level == 0 ? faces : lodLevels[level - 1];
+        vector<MeshCluster>& levelClusters = clusters[level];
+        vector<unsigned int>& levelFaceClusters = faceClusters[level];
+
+        unsigned int numClusters = assignFacesToClusters(&levelFaces, &levelFaceClusters);
+
+        // Find the bounding box and average normal of each cluster:
+        vector<double> boxes(6 * numClusters);
+        for (unsigned int i = 0; i < numClusters; i++){
+            boxes[6 * i] = boxes[6 * i + 1] = boxes[6 * i + 2] = std::numeric_limits<double>::max();
+            boxes[6 * i + 3] = boxes[6 * i + 4] = boxes[6 * i + 5] = -std::numeric_limits<double>::max();
+        }
+
+        levelClusters.resize(numClusters);
+        vector<bool> hasLines(numClusters, false);
+        for (unsigned int i = 0; i < levelFaces.size(); i++){
+            Polygon& currentFace = levelFaces[i];
+            unsigned int clusterIndex = levelFaceClusters[i];
+            double* box = &boxes[6 * clusterIndex];
+
+            for (int j = 0; j < currentFace.getVertexCount(); j++){
+                box[0] = std::min(box[0], currentFace.vertices[j].x);
+                box[1] = std::min(box[1], currentFace.vertices[j].y);
+                box[2] = std::min(box[2], currentFace.vertices[j].z);
+                box[3] = std::max(box[3], currentFace.vertices[j].x);
+                box[4] = std::max(box[4], currentFace.vertices[j].y);
+                box[5] = std::max(box[5], currentFace.vertices[j].z);
+            }
+
+            MeshCluster& currentCluster = levelClusters[clusterIndex];
+            if (currentFace.getVertexCount() < 3)
+                hasLines[clusterIndex] = true;
+            else
+                currentCluster.coneAxis = NormalVector(currentCluster.coneAxis.xn + currentFace.faceNormal.xn, currentCluster.coneAxis.yn + currentFace.faceNormal.yn, currentCluster.coneAxis.zn + currentFace.faceNormal.zn);
+            currentCluster.numFaces++;
+        }
+
+        // Bound each cluster with a sphere about the center of its bounding box:
+        for (unsigned int i = 0; i < numClusters; i++){
+            double* box = &boxes[6 * i];
+            levelClusters[i].center = Vertex((box[0] + box[3]) * 0.5, (box[1] + box[4]) * 0.5, (box[2] + box[5]) * 0.5);
+
+            if (hasLines[i] || levelClusters[i].coneAxis.isZero())
+                levelClusters[i].coneCutoff = 1;
+            else
+                levelClusters[i].coneAxis.normalize();
+        }
+
+        // Find the radius of each sphere, and the width of each normal cone: The cone is as wide as the face normal furthest from its axis
+        vector<double> minDots(numClusters, 1);
+        for (unsigned int i = 0; i < levelFaces.size(); i++){
+            Polygon& currentFace = levelFaces[i];
+            MeshCluster& currentCluster = levelClusters[levelFaceClusters[i]];
+
+            for (int j = 0; j < currentFace.getVertexCount(); j++){
+                double x = currentFace.vertices[j].x - currentCluster.center.x;
+                double y = currentFace.vertices[j].y - currentCluster.center.y;
+                double z = currentFace.vertices[j].z - currentCluster.center.z;
+                currentCluster.radius = std::max(currentCluster.radius, std::sqrt(x * x + y * y + z * z));
+            }
+
+            NormalVector faceNormal = currentFace.faceNormal;
+            double& minDot = minDots[levelFaceClusters[i]];
+            if (faceNormal.isZero())
+                minDot = -1;
+            else{
+                faceNormal.normalize();
+                minDot = std::min(minDot, faceNormal.dotProduct(currentCluster.coneAxis));
+            }
+        }
+
+        for (unsigned int i = 0; i < numClusters; i++){
+            if (levelClusters[i].coneCutoff < 1 && minDots[i] > 0)
+                levelClusters[i].coneCutoff = std::sqrt(1 - minDots[i] * minDots[i]);
+            else
+                levelClusters[i].coneCutoff = 1;
+        }
+    }
+}
+
+// Assign a set of faces to clusters of neighbouring faces
+unsigned int Mesh::assignFacesToClusters(vector<Polygon>* levelFaces, vector<unsigned int>* faceClusterIndices){
+    unsigned int numFaces = (unsigned int)levelFaces->size();
+    faceClusterIndices->assign(numFaces, 0);
+
+    // Find the faces that share each vertex position, by sorting every face's vertices by position:
+    struct FaceVertex{
+        double x, y, z;
+        unsigned int face;
+    };
+    vector<FaceVertex> faceVertices;
+    for (unsigned int i = 0; i < numFaces; i++){
+        Polygon& currentFace = (*levelFaces)[i];
+        for (int j = 0; j < currentFace.getVertexCount(); j++)
+            faceVertices.push_back( {currentFace.vertices[j].x, currentFace.vertices[j].y, currentFace.vertices[j].z, i} );
+    }
+    std::sort(faceVertices.begin(), faceVertices.end(), [](const FaceVertex& lhs, const FaceVertex& rhs){
+        return std::tie(lhs.x, lhs.y, lhs.z, lhs.face) < std::tie(rhs.x, rhs.y, rhs.z, rhs.face);
+    });
+
+    // Number the positions. Each position's faces are a run of faceVertices, starting at positionStarts[position]
+    vector<unsigned int> positionStarts;
+    vector<vector<unsigned int>> facePositions(numFaces);
+    for (unsigned int i = 0; i < faceVertices.size(); i++){
+        if (i == 0 || faceVertices[i].x != faceVertices[i - 1].x || faceVertices[i].y != faceVertices[i - 1].y || faceVertices[i].z != faceVertices[i - 1].z)
+            positionStarts.push_back(i);
+        facePositions[faceVertices[i].face].push_back((unsigned int)positionStarts.size() - 1);
+    }
+    positionStarts.push_back((unsigned int)faceVertices.size());
+
+    // Grow each cluster from the first face that isn't yet in one:
+    vector<bool> isClustered(numFaces, false);
+    vector<unsigned int> candidates;
+    unsigned int numClusters = 0;
+
+    for (unsigned int seed = 0; seed < numFaces; seed++){
+        if (isClustered[seed])
+            continue;
+
+        int numTriangles = 0;
+        NormalVector normalSum;
+        candidates.clear();
+
+        unsigned int nextFace = seed;
+        while (true){
+            // Add the face, and make its neighbours candidates:
+            Polygon& addedFace = (*levelFaces)[nextFace];
+            isClustered[nextFace] = true;
+            (*faceClusterIndices)[nextFace] = numClusters;
+            numTriangles += std::max(1, addedFace.getVertexCount() - 2);
+            normalSum = NormalVector(normalSum.xn + addedFace.faceNormal.xn, normalSum.yn + addedFace.faceNormal.yn, normalSum.zn + addedFace.faceNormal.zn);
+
+            for (unsigned int position : facePositions[nextFace]){
+                for (unsigned int i = positionStarts[position]; i < positionStarts[position + 1]; i++){
+                    if (!isClustered[faceVertices[i].face])
+                        candidates.push_back(faceVertices[i].face);
+                }
+            }
+
+            if (numTriangles >= MESH_CLUSTER_TRIANGLES)
+                break;
+
+            // Choose the candidate whose normal best matches the cluster's, dropping candidates that have since been clustered:
+            NormalVector clusterNormal = normalSum;
+            if (!clusterNormal.isZero())
+                clusterNormal.normalize();
+
+            double bestScore = -std::numeric_limits<double>::max();
+            unsigned int numCandidates = 0;
+            for (unsigned int currentCandidate : candidates){
+                if (isClustered[currentCandidate])
+                    continue;
+                candidates[numCandidates++] = currentCandidate;
+
+                NormalVector candidateNormal = (*levelFaces)[currentCandidate].faceNormal;
+                double score = -2; // Faces without a normal (eg. lines) match nothing
+                if (!candidateNormal.isZero()){
+                    candidateNormal.normalize();
+                    score = candidateNormal.dotProduct(clusterNormal);
+                }
+
+                if (score > bestScore){
+                    bestScore = score;
+                    nextFace = currentCandidate;
+                }
+            }
+            candidates.resize(numCandidates);
+
+            // Stop early if the cluster has no unclustered neighbours left:
+            if (candidates.empty())
+                break;
+        }
+
+        numClusters++;
+    }
+
+    return numClusters;
+}
+
+// Get the clusters of the active level of detail
+vector<MeshCluster>* Mesh::getActiveClusters(){
+    if (activeLod >= (int)clusters.size())
+        return nullptr;
+
+    return &clusters[activeLod];
+}
+
+// Get the cluster index of each face of the active level of detail
+vector<unsigned int>* Mesh::getActiveFaceClusters(){
+    if (activeLod >= (int)faceClusters.size())
+        return nullptr;
+
+    return &faceClusters[activeLod];
+}
+
+// Get the number of levels of detail this mesh has, including its full detail faces
+int Mesh::getLodCount() const{
+    return 1 + (int)lodLevels.size();
+}
+
+// Get the faces of the active level of detail
+vector<Polygon>& Mesh::getActiveFaces(){
+    if (activeLod == 0)
+        return faces;
+
+    return lodLevels[activeLod - 1];
+}
+
 // Debug this mesh
 void Mesh::debug(){
 
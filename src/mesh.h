@@ -11,6 +11,20 @@
 using std::vector;
 class Mesh;
 
+// Triangles gathered into each cluster, approximately
+const int MESH_CLUSTER_TRIANGLES = 64;
+
+// A cluster of neighbouring faces within a mesh: Its bounds let the renderer cull all of its faces at once
+struct MeshCluster{
+    unsigned int numFaces = 0;
+
+    Vertex center;              // Bounding sphere of the faces' vertices
+    double radius = 0;
+
+    NormalVector coneAxis;      // Normal cone: Every face normal lies within the cone about coneAxis
+    double coneCutoff = 0;      // Sine of the cone's half angle. 1 if the cone is too wide to ever cull the cluster (eg. it contains lines, or faces more than 90 degrees from the axis)
+};
+
 class Mesh
 {
 public:
@@ -20,27 +34,61 @@ public:
     // Copy Constructor
     Mesh(const Mesh &existingMesh);
 
+    // Move Constructor
+    Mesh(Mesh&& existingMesh) noexcept;
+
     // Overloaded assignment operator
     Mesh& operator=(const Mesh& rhs);
 
+    // Overloaded move assignment operator
+    Mesh& operator=(Mesh&& rhs) noexcept;
+
     // Transform this Mesh by a transformation matrix
     void transform(TransformationMatrix* theMatrix);
 
     // Transform this Mesh by a transformation matrix
     void transform(TransformationMatrix* theMatrix, bool doRound);
 
-    // Generate/update a bounding box around the faces of this mesh
+    // Generate/update a bounding box around the faces of this mesh, and all of its levels of detail
     // Precondition: The mesh has at least 1 polygon
     void generateBoundingBox();
 
+    // Partition the faces of each level of detail into clusters of neighbouring faces, of about MESH_CLUSTER_TRIANGLES triangles each
+    // The faces keep their order, so they are drawn exactly as they would be without clusters
+    void generateClusters();
+
+    // Get the clusters of the active level of detail
+    // Return: The clusters, or nullptr if they haven't been generated
+    vector<MeshCluster>* getActiveClusters();
+
+    // Get the cluster index of each face of the active level of detail
+    // Return: The indexes, or nullptr if the clusters haven't been generated
+    vector<unsigned int>* getActiveFaceClusters();
+
+    // Get the number of levels of detail this mesh has, including its full detail faces
+    int getLodCount() const;
+
+    // Get the faces of the active level of detail
+    vector<Polygon>& getActiveFaces();
+
     // Debug this mesh
     void debug();
 
     // Mesh attributes:
     //*****************
     vector<Polygon> faces; // This mesh's collection of faces
+    vector<vector<Polygon>> lodLevels;   // Progressively coarser versions of faces, used when the mesh is small on screen. Empty if the mesh has no levels of detail
+    int activeLod = 0;                   // The level of detail being drawn: 0 = faces, n = lodLevels[n - 1]
     vector<Polygon> boundingBoxFaces;    // A collection of 6 faces that make up a bounding box surrounding this polygon
+    vector<vector<MeshCluster>> clusters; // The clusters of each level of detail: clusters[n] partitions level n. Empty until generateClusters() is called, and cleared by transform()
+    vector<vector<unsigned int>> faceClusters; // The cluster each face belongs to: faceClusters[n][i] is the index of face i of level n in clusters[n]
     bool isWireframe = false; // Whether or not this mesh's polygons are to be rendered in wireframe, or filled
+
+private:
+    // Assign a set of faces to clusters, grown from a seed face by repeatedly adding the neighbouring face (sharing a vertex position) whose normal best matches the cluster's
+    // Writes the cluster index of each face to faceClusterIndices
+    // Return: The number of clusters
+    unsigned int assignFacesToClusters(vector<Polygon>* levelFaces, vector<unsigned int>* faceClusterIndices);
 };
 
 #endif // MESH_H
@@ -0,0 +1,433 @@
+// Mesh simplifier object: Reduces a mesh's triangle count by quadric error metric edge collapses, to build coarser levels of detail
+// By Adam Badke
+
+#include "meshsimplifier.h"
+#include "color.h"
+
+// STL includes:
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <utility>
+
+// Boundary edges are held in place by planes perpendicular to their triangle. This weights those planes against the surface's own planes
+const double BOUNDARY_PLANE_WEIGHT = 100.0;
+
+// Collapses that rotate a triangle's normal further than this (as a cosine) are rejected, as they fold the surface over
+const double MIN_NORMAL_DOT_AFTER_COLLAPSE = 0.2;
+
+// Quadric functions
+//******************
+
+// Add the plane ax + by + cz + d = 0, scaled by a weight
+void MeshSimplifier::Quadric::addPlane(double a, double b, double c, double d, double weight){
+    a2 += weight * a * a;
+    ab += weight * a * b;
+    ac += weight * a * c;
+    ad += weight * a * d;
+    b2 += weight * b * b;
+    bc += weight * b * c;
+    bd += weight * b * d;
+    c2 += weight * c * c;
+    cd += weight * c * d;
+    d2 += weight * d * d;
+}
+
+// Add another quadric to this one
+void MeshSimplifier::Quadric::add(const Quadric& rhs){
+    a2 += rhs.a2;
+    ab += rhs.ab;
+    ac += rhs.ac;
+    ad += rhs.ad;
+    b2 += rhs.b2;
+    bc += rhs.bc;
+    bd += rhs.bd;
+    c2 += rhs.c2;
+    cd += rhs.cd;
+    d2 += rhs.d2;
+}
+
+// Get the error of a point: Its weighted sum of squared distances to the planes
+double MeshSimplifier::Quadric::getError(double x, double y, double z) const{
+    return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                      + b2 * y * y     + 2 * bc * y * z + 2 * bd * y
+                                       + c2 * z * z     + 2 * cd * z
+                                                        + d2;
+}
+
+// Find the point with the least error, by solving the quadric's 3x3 linear system with Cramer's rule
+bool MeshSimplifier::Quadric::getOptimalPoint(double* x, double* y, double* z) const{
+    double determinant = a2 * (b2 * c2 - bc * bc) - ab * (ab * c2 - bc * ac) + ac * (ab * bc - b2 * ac);
+
+    // Treat nearly singular systems as singular: Their solutions are unstable, and may lie far from the surface
+    double trace = a2 + b2 + c2;
+    if (std::fabs(determinant) <= 1e-9 * trace * trace * trace)
+        return false;
+
+    *x = (-ad * (b2 * c2 - bc * bc) + bd * (ab * c2 - bc * ac) - cd * (ab * bc - b2 * ac)) / determinant;
+    *y = (a2 * (-bd * c2 + cd * bc) - ab * (-ad * c2 + cd * ac) + ac * (-ad * bc + bd * ac)) / determinant;
+    *z = (a2 * (-b2 * cd + bc * bd) - ab * (-ab * cd + bc * ad) + ac * (-ab * bd + b2 * ad)) / determinant;
+
+    return true;
+}
+
+// MeshSimplifier functions
+//*************************
+
+// Constructor
+MeshSimplifier::MeshSimplifier(vector<Polygon>* faces){
+
+    // Weld vertices with identical positions and attributes. Vertices that share a position but not their attributes are kept apart, as seams
+    std::map<std::tuple<double, double, double, unsigned int, double, double, double>, int> weldedIndices;
+    std::map<std::tuple<double, double, double>, int> positionUses;
+
+    for (auto &currentFace : *faces){
+        int numCorners = currentFace.getVertexCount();
+        if (numCorners < 3)
+            continue;
+
+        vector<int> cornerIndices(numCorners);
+        for (int i = 0; i < numCorners; i++){
+            const Vertex& corner = currentFace.vertices[i];
+            auto key = std::make_tuple(corner.x, corner.y, corner.z, corner.color, corner.normal.xn, corner.normal.yn, corner.normal.zn);
+
+            auto weldedIndex = weldedIndices.find(key);
+            if (weldedIndex == weldedIndices.end()){
+                weldedIndex = weldedIndices.emplace(key, (int)vertices.size()).first;
+
+                SimplifierVertex newVertex;
+                newVertex.position = corner;
+                vertices.emplace_back(std::move(newVertex));
+
+                positionUses[std::make_tuple(corner.x, corner.y, corner.z)]++;
+            }
+            cornerIndices[i] = weldedIndex->second;
+        }
+
+        // Split the face into a fan of triangles, skipping any that are degenerate:
+        for (int i = 1; i + 1 < numCorners; i++){
+            SimplifierTriangle newTriangle;
+            newTriangle.vertices[0] = cornerIndices[0];
+            newTriangle.vertices[1] = cornerIndices[i];
+            newTriangle.vertices[2] = cornerIndices[i + 1];
+
+            if (newTriangle.vertices[0] != newTriangle.vertices[1] && newTriangle.vertices[1] != newTriangle.vertices[2] && newTriangle.vertices[0] != newTriangle.vertices[2])
+                triangles.push_back(newTriangle);
+        }
+    }
+    numTriangles = (int)triangles.size();
+
+    for (auto &currentVertex : vertices)
+        currentVertex.isSeam = positionUses[std::make_tuple(currentVertex.position.x, currentVertex.position.y, currentVertex.position.z)] > 1;
+
+    // Accumulate the plane of each triangle into its vertices' quadrics, weighted by its area, and count how many triangles use each edge:
+    std::map<std::pair<int, int>, std::pair<int, int>> edgeUses; // Edge -> (number of triangles, last triangle)
+    for (int i = 0; i < (int)triangles.size(); i++){
+        int* corners = triangles[i].vertices;
+
+        NormalVector normal;
+        double doubleArea;
+        getTriangleNormal(vertices[corners[0]].position, vertices[corners[1]].position, vertices[corners[2]].position, &normal, &doubleArea);
+        double d = -(normal.xn * vertices[corners[0]].position.x + normal.yn * vertices[corners[0]].position.y + normal.zn * vertices[corners[0]].position.z);
+
+        for (int j = 0; j < 3; j++){
+            vertices[corners[j]].quadric.addPlane(normal.xn, normal.yn, normal.zn, d, doubleArea * 0.5);
+            vertices[corners[j]].triangles.push_back(i);
+
+            auto& uses = edgeUses[std::make_pair(std::min(corners[j], corners[(j + 1) % 3]), std::max(corners[j], corners[(j + 1) % 3]))];
+            uses.first++;
+            uses.second = i;
+        }
+    }
+
+    // Hold boundary edges (used by a single triangle) in place, with a plane through the edge that is perpendicular to its triangle:
+    for (auto &currentEdge : edgeUses){
+        if (currentEdge.second.first != 1)
+            continue;
+
+        int* corners = triangles[currentEdge.second.second].vertices;
+        NormalVector triangleNormal;
+        double doubleArea;
+        getTriangleNormal(vertices[corners[0]].position, vertices[corners[1]].position, vertices[corners[2]].position, &triangleNormal, &doubleArea);
+
+        const Vertex& p0 = vertices[currentEdge.first.first].position;
+        const Vertex& p1 = vertices[currentEdge.first.second].position;
+        NormalVector edgeDirection(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+        double edgeLengthSquared = edgeDirection.dotProduct(edgeDirection);
+
+        NormalVector planeNormal = triangleNormal.crossProduct(edgeDirection);
+        if (planeNormal.isZero())
+            continue;
+        planeNormal.normalize();
+
+        double d = -(planeNormal.xn * p0.x + planeNormal.yn * p0.y + planeNormal.zn * p0.z);
+        vertices[currentEdge.first.first].quadric.addPlane(planeNormal.xn, planeNormal.yn, planeNormal.zn, d, BOUNDARY_PLANE_WEIGHT * edgeLengthSquared);
+        vertices[currentEdge.first.second].quadric.addPlane(planeNormal.xn, planeNormal.yn, planeNormal.zn, d, BOUNDARY_PLANE_WEIGHT * edgeLengthSquared);
+    }
+
+    // Queue every edge's collapse:
+    for (auto &currentEdge : edgeUses){
+        EdgeCollapse newCollapse;
+        Vertex collapsedPosition;
+        if (findCollapse(currentEdge.first.first, currentEdge.first.second, &newCollapse, &collapsedPosition)){
+            collapseQueue.push_back(newCollapse);
+            std::push_heap(collapseQueue.begin(), collapseQueue.end(), isCostlier);
+        }
+    }
+}
+
+// Collapse edges, cheapest first, until the mesh has no more than targetTriangles triangles
+vector<Polygon> MeshSimplifier::simplify(int targetTriangles){
+
+    while (numTriangles > targetTriangles && !collapseQueue.empty()){
+        std::pop_heap(collapseQueue.begin(), collapseQueue.end(), isCostlier);
+        EdgeCollapse queuedCollapse = collapseQueue.back();
+        collapseQueue.pop_back();
+
+        // Skip collapses made stale by earlier collapses:
+        if (vertices[queuedCollapse.u].isRemoved || vertices[queuedCollapse.v].isRemoved
+            || vertices[queuedCollapse.u].version != queuedCollapse.uVersion || vertices[queuedCollapse.v].version != queuedCollapse.vVersion)
+            continue;
+
+        EdgeCollapse currentCollapse;
+        Vertex collapsedPosition;
+        if (!findCollapse(queuedCollapse.u, queuedCollapse.v, &currentCollapse, &collapsedPosition))
+            continue;
+
+        int removedIndex = currentCollapse.u;
+        int keptIndex = currentCollapse.v;
+
+        // Reject collapses that would tear the mesh, or fold it over:
+        if (!isCollapseManifold(removedIndex, keptIndex)
+            || wouldFlipTriangles(removedIndex, keptIndex, collapsedPosition) || wouldFlipTriangles(keptIndex, removedIndex, collapsedPosition))
+            continue;
+
+        SimplifierVertex& removedVertex = vertices[removedIndex];
+        SimplifierVertex& keptVertex = vertices[keptIndex];
+
+        // Remove the triangles along the edge, and move the rest of the removed vertex's triangles onto the kept vertex:
+        for (int triangleIndex : removedVertex.triangles){
+            SimplifierTriangle& currentTriangle = triangles[triangleIndex];
+
+            bool isOnEdge = currentTriangle.vertices[0] == keptIndex || currentTriangle.vertices[1] == keptIndex || currentTriangle.vertices[2] == keptIndex;
+            if (isOnEdge){
+                currentTriangle.isRemoved = true;
+                numTriangles--;
+
+                for (int corner : currentTriangle.vertices){
+                    if (corner == removedIndex)
+                        continue;
+
+                    vector<int>& cornerTriangles = vertices[corner].triangles;
+                    cornerTriangles.erase(std::remove(cornerTriangles.begin(), cornerTriangles.end(), triangleIndex), cornerTriangles.end());
+                }
+            }
+            else{
+                for (int &corner : currentTriangle.vertices){
+                    if (corner == removedIndex)
+                        corner = keptIndex;
+                }
+                keptVertex.triangles.push_back(triangleIndex);
+            }
+        }
+
+        keptVertex.position = collapsedPosition;
+        keptVertex.quadric.add(removedVertex.quadric);
+        keptVertex.version++;
+
+        removedVertex.triangles.clear();
+        removedVertex.isRemoved = true;
+
+        queueEdges(keptIndex);
+    }
+
+    // Assemble the remaining triangles:
+    vector<Polygon> result;
+    result.reserve(numTriangles);
+    for (auto &currentTriangle : triangles){
+        if (currentTriangle.isRemoved)
+            continue;
+
+        Polygon newFace(vertices[currentTriangle.vertices[0]].position, vertices[currentTriangle.vertices[1]].position, vertices[currentTriangle.vertices[2]].position);
+        for (int i = 0; i < 3; i++)
+            newFace.vertices[i].normal = vertices[currentTriangle.vertices[i]].position.normal;
+        newFace.faceNormal = newFace.getFaceNormal();
+
+        result.emplace_back(std::move(newFace));
+    }
+
+    return result;
+}
+
+// Get the number of triangles in the mesh, as it currently stands
+int MeshSimplifier::getTriangleCount() const{
+    return numTriangles;
+}
+
+// Heap ordering for collapses: Puts the cheapest collapse at the top of the queue
+bool MeshSimplifier::isCostlier(const EdgeCollapse& lhs, const EdgeCollapse& rhs){
+    return lhs.cost > rhs.cost;
+}
+
+// Find the cheapest way to collapse an edge, and where the remaining vertex should go
+bool MeshSimplifier::findCollapse(int u, int v, EdgeCollapse* result, Vertex* collapsedPosition){
+
+    // Seams never move: Collapse onto a seam vertex, or not at all
+    if (vertices[u].isSeam && vertices[v].isSeam)
+        return false;
+    if (vertices[u].isSeam)
+        std::swap(u, v);
+
+    const Vertex& uPosition = vertices[u].position;
+    const Vertex& vPosition = vertices[v].position;
+
+    Quadric combinedQuadric = vertices[u].quadric;
+    combinedQuadric.add(vertices[v].quadric);
+
+    double x, y, z;
+    double edgeLengthSquared = (uPosition.x - vPosition.x) * (uPosition.x - vPosition.x) + (uPosition.y - vPosition.y) * (uPosition.y - vPosition.y) + (uPosition.z - vPosition.z) * (uPosition.z - vPosition.z);
+
+    if (vertices[v].isSeam){
+        x = vPosition.x;
+        y = vPosition.y;
+        z = vPosition.z;
+    }
+    else{
+        // Use the optimal point, unless it's ill defined or wanders far from the edge. Otherwise, use the best of the edge's ends and midpoint
+        double midX = (uPosition.x + vPosition.x) * 0.5;
+        double midY = (uPosition.y + vPosition.y) * 0.5;
+        double midZ = (uPosition.z + vPosition.z) * 0.5;
+
+        if (!combinedQuadric.getOptimalPoint(&x, &y, &z) || (x - midX) * (x - midX) + (y - midY) * (y - midY) + (z - midZ) * (z - midZ) > edgeLengthSquared){
+            const double candidates[3][3] = { {uPosition.x, uPosition.y, uPosition.z}, {vPosition.x, vPosition.y, vPosition.z}, {midX, midY, midZ} };
+
+            double leastError = std::numeric_limits<double>::max();
+            for (int i = 0; i < 3; i++){
+                double currentError = combinedQuadric.getError(candidates[i][0], candidates[i][1], candidates[i][2]);
+                if (currentError < leastError){
+                    leastError = currentError;
+                    x = candidates[i][0];
+                    y = candidates[i][1];
+                    z = candidates[i][2];
+                }
+            }
+        }
+    }
+
+    // Interpolate the attributes at the new position's projection onto the edge:
+    double t = 0;
+    if (edgeLengthSquared > 0){
+        t = ((x - uPosition.x) * (vPosition.x - uPosition.x) + (y - uPosition.y) * (vPosition.y - uPosition.y) + (z - uPosition.z) * (vPosition.z - uPosition.z)) / edgeLengthSquared;
+        t = std::max(0.0, std::min(1.0, t));
+    }
+
+    *collapsedPosition = vPosition;
+    collapsedPosition->x = x;
+    collapsedPosition->y = y;
+    collapsedPosition->z = z;
+    collapsedPosition->color = Color::fromARGB(uPosition.color).blend((float)(1 - t), Color::fromARGB(vPosition.color), (float)t).toARGB();
+
+    NormalVector blendedNormal(uPosition.normal.xn * (1 - t) + vPosition.normal.xn * t, uPosition.normal.yn * (1 - t) + vPosition.normal.yn * t, uPosition.normal.zn * (1 - t) + vPosition.normal.zn * t);
+    if (!blendedNormal.isZero()){
+        blendedNormal.normalize();
+        collapsedPosition->normal = blendedNormal;
+    }
+
+    result->cost = combinedQuadric.getError(x, y, z);
+    result->u = u;
+    result->v = v;
+    result->uVersion = vertices[u].version;
+    result->vVersion = vertices[v].version;
+
+    return true;
+}
+
+// Check whether moving a vertex would flip or degenerate any of its triangles
+bool MeshSimplifier::wouldFlipTriangles(int movedVertex, int otherVertex, const Vertex& newPosition){
+    for (int triangleIndex : vertices[movedVertex].triangles){
+        const int* corners = triangles[triangleIndex].vertices;
+
+        // Triangles along the edge are removed by the collapse
+        if (corners[0] == otherVertex || corners[1] == otherVertex || corners[2] == otherVertex)
+            continue;
+
+        const Vertex* oldCorners[3];
+        const Vertex* newCorners[3];
+        for (int i = 0; i < 3; i++){
+            oldCorners[i] = &vertices[corners[i]].position;
+            newCorners[i] = corners[i] == movedVertex ? &newPosition : oldCorners[i];
+        }
+
+        NormalVector oldNormal, newNormal;
+        double oldDoubleArea, newDoubleArea;
+        getTriangleNormal(*oldCorners[0], *oldCorners[1], *oldCorners[2], &oldNormal, &oldDoubleArea);
+        getTriangleNormal(*newCorners[0], *newCorners[1], *newCorners[2], &newNormal, &newDoubleArea);
+
+        if (newDoubleArea <= 0 || oldNormal.dotProduct(newNormal) < MIN_NORMAL_DOT_AFTER_COLLAPSE)
+            return true;
+    }
+
+    return false;
+}
+
+// Check whether collapsing an edge keeps the mesh manifold
+bool MeshSimplifier::isCollapseManifold(int u, int v){
+    vector<int> uNeighbours, vNeighbours;
+    getNeighbours(u, &uNeighbours);
+    getNeighbours(v, &vNeighbours);
+
+    int numShared = 0;
+    for (int currentNeighbour : uNeighbours){
+        if (std::find(vNeighbours.begin(), vNeighbours.end(), currentNeighbour) != vNeighbours.end())
+            numShared++;
+    }
+
+    int numEdgeTriangles = 0;
+    for (int triangleIndex : vertices[u].triangles){
+        const int* corners = triangles[triangleIndex].vertices;
+        if (corners[0] == v || corners[1] == v || corners[2] == v)
+            numEdgeTriangles++;
+    }
+
+    return numShared <= numEdgeTriangles;
+}
+
+// Get the vertices that share a triangle with a vertex
+void MeshSimplifier::getNeighbours(int vertexIndex, vector<int>* result){
+    result->clear();
+    for (int triangleIndex : vertices[vertexIndex].triangles){
+        for (int corner : triangles[triangleIndex].vertices){
+            if (corner != vertexIndex && std::find(result->begin(), result->end(), corner) == result->end())
+                result->push_back(corner);
+        }
+    }
+}
+
+// Queue the collapses of every edge around a vertex
+void MeshSimplifier::queueEdges(int vertexIndex){
+    vector<int> neighbours;
+    getNeighbours(vertexIndex, &neighbours);
+
+    for (int currentNeighbour : neighbours){
+        EdgeCollapse newCollapse;
+        Vertex collapsedPosition;
+        if (findCollapse(vertexIndex, currentNeighbour, &newCollapse, &collapsedPosition)){
+            collapseQueue.push_back(newCollapse);
+            std::push_heap(collapseQueue.begin(), collapseQueue.end(), isCostlier);
+        }
+    }
+}
+
+// Get the unit normal (and twice the area) of a triangle
+void MeshSimplifier::getTriangleNormal(const Vertex& p0, const Vertex& p1, const Vertex& p2, NormalVector* normal, double* doubleArea){
+    double e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+    double e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+
+    *normal = NormalVector(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+    *doubleArea = normal->length();
+
+    if (*doubleArea > 0)
+        *normal *= 1.0 / *doubleArea;
+}
@@ -0,0 +1,100 @@
+// Mesh simplifier object: Reduces a mesh's triangle count by quadric error metric edge collapses, to build coarser levels of detail
+// By Adam Badke
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "polygon.h"
+#include "vertex.h"
+#include "normalvector.h"
+
+// STL includes:
+#include <vector>
+
+using std::vector;
+
+class MeshSimplifier
+{
+public:
+    // Constructor: Welds the vertices of a set of faces into an indexed triangle mesh, ready to be simplified. Faces with more than 3 vertices are split into triangles
+    MeshSimplifier(vector<Polygon>* faces);
+
+    // Collapse edges, cheapest first, until the mesh has no more than targetTriangles triangles or no collapse remains that keeps the mesh well formed
+    // Successive calls continue from the previous result, so a chain of levels can be built by calling this with decreasing targets
+    // Return: The simplified faces, with interpolated vertex colors and normals
+    vector<Polygon> simplify(int targetTriangles);
+
+    // Get the number of triangles in the mesh, as it currently stands
+    int getTriangleCount() const;
+
+private:
+    // A symmetric 4x4 error quadric: The sum of the squared distances to a set of planes
+    struct Quadric{
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+        // Add the plane ax + by + cz + d = 0, scaled by a weight
+        void addPlane(double a, double b, double c, double d, double weight);
+
+        // Add another quadric to this one
+        void add(const Quadric& rhs);
+
+        // Get the error of a point: Its weighted sum of squared distances to the planes
+        double getError(double x, double y, double z) const;
+
+        // Find the point with the least error
+        // Return: True if the point was found, false if the quadric is singular (eg. all of its planes are parallel)
+        bool getOptimalPoint(double* x, double* y, double* z) const;
+    };
+
+    // A welded mesh vertex
+    struct SimplifierVertex{
+        Vertex position;            // Position, color and normal
+        Quadric quadric;
+        vector<int> triangles;      // The triangles that use this vertex
+        bool isSeam = false;        // Shares its position with another vertex (eg. along a hard edge or color boundary): Never moved, so the mesh can't crack open
+        bool isRemoved = false;
+        unsigned int version = 0;   // Incremented each time the vertex changes, to invalidate queued collapses
+    };
+
+    // A mesh triangle, with counter-clockwise winding
+    struct SimplifierTriangle{
+        int vertices[3];
+        bool isRemoved = false;
+    };
+
+    // A candidate edge collapse: Moves vertices u and v to a single position, and removes u
+    struct EdgeCollapse{
+        double cost;
+        int u, v;
+        unsigned int uVersion, vVersion;
+    };
+
+    // Heap ordering for collapses: Puts the cheapest collapse at the top of the queue
+    static bool isCostlier(const EdgeCollapse& lhs, const EdgeCollapse& rhs);
+
+    // Find the cheapest way to collapse an edge, and where the remaining vertex should go
+    // Return: True if the edge can be collapsed, false if both of its vertices are seams
+    bool findCollapse(int u, int v, EdgeCollapse* result, Vertex* collapsedPosition);
+
+    // Check whether moving a vertex would flip or degenerate any of its triangles, ignoring those that are removed by the collapse
+    bool wouldFlipTriangles(int movedVertex, int otherVertex, const Vertex& newPosition);
+
+    // Check whether collapsing an edge keeps the mesh manifold: Its vertices may only share the neighbours across the triangles along the edge
+    bool isCollapseManifold(int u, int v);
+
+    // Get the vertices that share a triangle with a vertex
+    void getNeighbours(int vertexIndex, vector<int>* result);
+
+    // Queue the collapses of every edge around a vertex
+    void queueEdges(int vertexIndex);
+
+    // Get the unit normal (and twice the area) of a triangle
+    void getTriangleNormal(const Vertex& p0, const Vertex& p1, const Vertex& p2, NormalVector* normal, double* doubleArea);
+
+    vector<SimplifierVertex> vertices;
+    vector<SimplifierTriangle> triangles;
+    vector<EdgeCollapse> collapseQueue;     // A binary heap, maintained with std::push_heap/pop_heap
+    int numTriangles;                       // Triangles that haven't been removed
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,50 @@
+// Offscreen drawable object: A Drawable backed by an in-memory pixel buffer, for rendering without a window
+// By Adam Badke
+
+#include "offscreendrawable.h"
+#include <cstring>
+
+// Constructor: All pixels start as opaque black
+OffscreenDrawable::OffscreenDrawable(int newWidth, int newHeight) : width(newWidth), height(newHeight), pixels(newWidth * newHeight, 0xff000000) {}
+
+// Set a single pixel. Coordinates outside of the buffer are ignored
+void OffscreenDrawable::setPixel(int x, int y, unsigned int color){
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return;
+
+    pixels[y * width + x] = color;
+}
+
+// Get a single pixel
+// Pre-condition: The coordinate is inside the buffer
+unsigned int OffscreenDrawable::getPixel(int x, int y){
+    return pixels[y * width + x];
+}
+
+// Nothing to display: The pixels are read back with getPixels()
+void OffscreenDrawable::updateScreen(){
+    // Do nothing
+}
+
+// Blit a rectangle of packed ARGB pixels, a whole row at a time
+// Pre-condition: The rectangle is inside the buffer
+void OffscreenDrawable::setPixels(int x, int y, int width, int height, const unsigned int* pixels, int rowStride){
+    for (int row = 0; row < height; row++){
+        std::memcpy(&this->pixels[(y + row) * this->width + x], pixels + row * rowStride, width * sizeof(unsigned int));
+    }
+}
+
+// Get the buffer width
+int OffscreenDrawable::getWidth() const{
+    return width;
+}
+
+// Get the buffer height
+int OffscreenDrawable::getHeight() const{
+    return height;
+}
+
+// Get the packed ARGB pixels, in row-major order from the top left
+const unsigned int* OffscreenDrawable::getPixels() const{
+    return pixels.data();
+}
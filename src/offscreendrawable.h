@@ -0,0 +1,37 @@
+// Offscreen drawable object: A Drawable backed by an in-memory pixel buffer, for rendering without a window
+// By Adam Badke
+
+#ifndef OFFSCREENDRAWABLE_H
+#define OFFSCREENDRAWABLE_H
+
+#include "drawable.h"
+#include <vector>
+
+using std::vector;
+
+class OffscreenDrawable : public Drawable
+{
+public:
+    // Constructor: All pixels start as opaque black
+    OffscreenDrawable(int newWidth, int newHeight);
+
+    // Drawable interface:
+    void setPixel(int x, int y, unsigned int color);
+    unsigned int getPixel(int x, int y);
+    void updateScreen();
+    void setPixels(int x, int y, int width, int height, const unsigned int* pixels, int rowStride);
+
+    // Get the buffer dimensions
+    int getWidth() const;
+    int getHeight() const;
+
+    // Get the packed ARGB pixels, in row-major order from the top left
+    const unsigned int* getPixels() const;
+
+private:
+    int width;
+    int height;
+    vector<unsigned int> pixels;
+};
+
+#endif // OFFSCREENDRAWABLE_H
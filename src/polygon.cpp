@@ -7,6 +7,7 @@
 #include <vector>
 #include "normalvector.h"
 #include <cmath>
+#include <utility>
 
 using std::vector;
 using std::cout;
@@ -17,6 +18,7 @@ Polygon::Polygon(){ //
 
     vertices = new Vertex[vertexArraySize];
     currentVertices = 0;
+    ownsVertices = true;
 
     isAmbientLit = false;
 
@@ -37,6 +39,7 @@ Polygon::Polygon(Vertex p0, Vertex p1, Vertex p2){
         vertices[i].vertexNumber = i;
 
     currentVertices = 3;
+    ownsVertices = true;
 
     isAmbientLit = false;
 
@@ -46,6 +49,20 @@ Polygon::Polygon(Vertex p0, Vertex p1, Vertex p2){
     faceNormal = this->getFaceNormal();
 }
 
+// External storage constructor: Uses a caller owned array of vertices (eg. from a FrameArena), which this polygon will not free
+Polygon::Polygon(Vertex* vertexStorage, unsigned int vertexStorageSize){
+    vertexArraySize = vertexStorageSize;
+
+    vertices = vertexStorage;
+    currentVertices = 0;
+    ownsVertices = false;
+
+    isAmbientLit = false;
+
+    // Set the shading model to ambient only, by default:
+    theShadingModel = ambientOnly;
+}
+
 // Copy constructor
 Polygon::Polygon(const Polygon& currentPoly){
     this->vertexArraySize = currentPoly.vertexArraySize;
@@ -55,15 +72,39 @@ Polygon::Polygon(const Polygon& currentPoly){
 
     this->theShadingModel = currentPoly.theShadingModel;
     this->specularCoefficient = currentPoly.specularCoefficient;
-    this->specularExponent = currentPoly.specularExponent;
+    this->specularPower = currentPoly.specularPower;
     this->reflectivity = currentPoly.reflectivity;
 
     this->vertices = new Vertex[vertexArraySize];
     for (unsigned int i = 0; i < vertexArraySize; i++){
         this->vertices[i] = currentPoly.vertices[i];
     }
+    this->ownsVertices = true;
+
+    this->faceNormal = currentPoly.faceNormal;
+}
+
+// Move constructor: Takes ownership of the existing polygon's vertex array
+Polygon::Polygon(Polygon&& currentPoly) noexcept {
+    this->vertexArraySize = currentPoly.vertexArraySize;
+    this->currentVertices = currentPoly.currentVertices;
+
+    this->isAmbientLit = currentPoly.isAmbientLit;
+
+    this->theShadingModel = currentPoly.theShadingModel;
+    this->specularCoefficient = currentPoly.specularCoefficient;
+    this->specularPower = currentPoly.specularPower;
+    this->reflectivity = currentPoly.reflectivity;
+
+    this->vertices = currentPoly.vertices;
+    this->ownsVertices = currentPoly.ownsVertices;
 
     this->faceNormal = currentPoly.faceNormal;
+
+    // Leave the moved-from polygon empty, but safely destructible:
+    currentPoly.vertices = nullptr;
+    currentPoly.vertexArraySize = 0;
+    currentPoly.currentVertices = 0;
 }
 
 // Overloaded assignment operator
@@ -71,6 +112,15 @@ Polygon& Polygon::operator=(const Polygon& rhs){
     if (this == &rhs)
         return *this;
 
+    // Only reallocate if the vertex array is a different size: Allows polygon buffers to be refilled without allocating
+    if (vertices == nullptr || this->vertexArraySize != rhs.vertexArraySize){
+        if (vertices != nullptr && ownsVertices)
+            delete[] vertices;
+
+        this->vertices = new Vertex[rhs.vertexArraySize];
+        this->ownsVertices = true;
+    }
+
     this->vertexArraySize = rhs.vertexArraySize;
     this->currentVertices = rhs.currentVertices;
 
@@ -78,13 +128,9 @@ Polygon& Polygon::operator=(const Polygon& rhs){
 
     this->theShadingModel = rhs.theShadingModel;
     this->specularCoefficient = rhs.specularCoefficient;
-    this->specularExponent = rhs.specularExponent;
+    this->specularPower = rhs.specularPower;
     this->reflectivity = rhs.reflectivity;
 
-    if (vertices != nullptr)
-        delete[] vertices;
-
-    this->vertices = new Vertex[vertexArraySize];
     for (unsigned int i = 0; i < currentVertices; i++)
         this->vertices[i] = rhs.vertices[i];
 
@@ -93,10 +139,41 @@ Polygon& Polygon::operator=(const Polygon& rhs){
     return *this;
 }
 
+// Overloaded move assignment operator
+Polygon& Polygon::operator=(Polygon&& rhs) noexcept {
+    if (this == &rhs)
+        return *this;
+
+    if (vertices != nullptr && ownsVertices)
+        delete[] vertices;
+
+    this->vertexArraySize = rhs.vertexArraySize;
+    this->currentVertices = rhs.currentVertices;
+
+    this->isAmbientLit = rhs.isAmbientLit;
+
+    this->theShadingModel = rhs.theShadingModel;
+    this->specularCoefficient = rhs.specularCoefficient;
+    this->specularPower = rhs.specularPower;
+    this->reflectivity = rhs.reflectivity;
+
+    this->vertices = rhs.vertices;
+    this->ownsVertices = rhs.ownsVertices;
+
+    this->faceNormal = rhs.faceNormal;
+
+    // Leave the moved-from polygon empty, but safely destructible:
+    rhs.vertices = nullptr;
+    rhs.vertexArraySize = 0;
+    rhs.currentVertices = 0;
+
+    return *this;
+}
+
 // Destructor;
 Polygon::~Polygon(){
-    // Handle polygons with no vertices
-    if (vertices == nullptr)
+    // Handle polygons with no vertices, or vertices owned by someone else
+    if (vertices == nullptr || !ownsVertices)
         return;
 
     delete[] vertices;
@@ -107,12 +184,26 @@ void Polygon::clearVertices(){
     if (vertices == nullptr)
         return;
 
-    delete[] vertices;
+    if (ownsVertices)
+        delete[] vertices;
 
     vertexArraySize = 3; // Allocate 3 vertices (for a triangle)
 
     vertices = new Vertex[vertexArraySize];
     currentVertices = 0;
+    ownsVertices = true;
+}
+
+// Copy another polygon's drawing attributes (its material and face normal), but not its vertices
+void Polygon::copyAttributes(const Polygon& source){
+    isAmbientLit = source.isAmbientLit;
+
+    theShadingModel = source.theShadingModel;
+    specularCoefficient = source.specularCoefficient;
+    specularPower = source.specularPower;
+    reflectivity = source.reflectivity;
+
+    faceNormal = source.faceNormal;
 }
 
 // Add a vertex to the polygon.
@@ -135,7 +226,9 @@ void Polygon::addVertex(Vertex newPoint){
             newVertices[i] = vertices[i];
         }
         // Deallocate the old array now that we've stored the values elsewhere
-        delete [] vertices;
+        if (ownsVertices)
+            delete [] vertices;
+        ownsVertices = true;
 
         newPoint.vertexNumber = vertexArraySize;
         newVertices[vertexArraySize] = Vertex(newPoint);
@@ -232,52 +325,16 @@ bool Polygon::isLine(){
     return (currentVertices == 2);
 }
 
-// Determine if this polygon is currently between hither and yon
-bool Polygon::isInDepth(double hither, double yon){
-    bool beforeHither = false; // Check if the polygon spans from before the near plane, out past the far plane
-    bool afterYon = false;
-
-    // Loop through each vertex, checking if any of them are in range
-    for (unsigned int i = 0; i < currentVertices; i++){
-        if (vertices[i].z >= hither && vertices[i].z <= yon){
-            return true;
-        }
-        // Check if a polygon has an edge stretched between from before hither to after yon
-        if (vertices[i].z < hither)
-            beforeHither = true;
-        if (vertices[i].z > yon)
-            afterYon = true;
+// Get the view plane position of a camera space vertex, exactly as the perspective transformation would project it (see Vertex::divideByW)
+static void getProjectedPosition(const Vertex& theVertex, double* x, double* y){
+    if (theVertex.z != 1 && theVertex.z != 0){
+        *x = theVertex.x / theVertex.z;
+        *y = theVertex.y / theVertex.z;
     }
-
-    return beforeHither && afterYon;
-}
-
-// Polygon frustum culling: Check if this polygon is in bounds of the view frustum
-bool Polygon::isInFrustum(double xLow, double xHigh, double yLow, double yHigh){
-
-    // If all vertices are in the negative half-spaces of xMin/xMax/yMin/yMax, the polygon should be culled:
-    bool belowXLow = true;
-    bool aboveXHigh = true;
-    bool belowYLow = true;
-    bool aboveYHigh = true;
-    // Check  each vertex:
-    for (unsigned int i = 0; i < currentVertices; i++){
-        if (vertices[i].x > xLow){
-            belowXLow = false;
-        }
-        if (vertices[i].x < xHigh){
-            aboveXHigh = false;
-        }
-        if (vertices[i].y > yLow){
-            belowYLow = false;
-        }
-        if (vertices[i].y < yHigh){
-            aboveYHigh = false;
-        }
+    else{
+        *x = theVertex.x;
+        *y = theVertex.y;
     }
-
-    // If any of the booleans are still true, all vertices must be in that negative half space: Return false.
-    return (!(belowXLow || aboveXHigh || belowYLow || aboveYHigh));
 }
 
 // Clip a polygon to the near/far planes
@@ -326,7 +383,7 @@ Polygon Polygon::clipHelper(Polygon source, Vertex planePoint, NormalVector plan
 
     result.theShadingModel = source.theShadingModel;
     result.specularCoefficient = source.specularCoefficient;
-    result.specularExponent = source.specularExponent;
+    result.specularPower = source.specularPower;
     result.reflectivity = source.reflectivity;
 
     result.faceNormal = source.faceNormal;
@@ -394,15 +451,24 @@ Vertex Polygon::intersection(Vertex prevVertex, Vertex currentVertex, Vertex pla
     return intersectionPoint;
 }
 
-// Check vertex winding: Determine if we're looking at the front or the back of the polygon
+// Check vertex winding: Determine if we'll be looking at the front or the back of the polygon once the perspective transformation is applied
 bool Polygon::isFacingCamera(){
 
     //  Assumes Polygon is only visible if the vertices are counter clockwise with relation to the RASTER
+    // The winding is measured on the projected vertices, so polygons can be culled while they're still in camera space (eg. before lighting)
     double sum = 0;
-    for (unsigned int i = 0; i < currentVertices - 1; i++){
-        sum += (vertices[i + 1].x - vertices[i].x) * (vertices[i + 1].y + vertices[i].y);
+    double firstX, firstY, previousX, previousY;
+    getProjectedPosition(vertices[0], &firstX, &firstY);
+    previousX = firstX;
+    previousY = firstY;
+    for (unsigned int i = 1; i < currentVertices; i++){
+        double x, y;
+        getProjectedPosition(vertices[i], &x, &y);
+        sum += (x - previousX) * (y + previousY);
+        previousX = x;
+        previousY = y;
     }
-    sum += (vertices[0].x - vertices[currentVertices - 1].x) * (vertices[0].y + vertices[currentVertices - 1].y);
+    sum += (firstX - previousX) * (firstY + previousY);
 
     if (sum > 0){ // Assuming CCW vertex winding is relative to cartesian plane (and not the raster)
         return false;
@@ -460,7 +526,53 @@ vector<Polygon>* Polygon::getTriangulatedFaces(){
         newFace.addVertex(vertices[ index + 1 ]);
         index++;
 
-        result->emplace_back(newFace); // Add the new face
+        result->emplace_back(std::move(newFace)); // Add the new face
+    }
+
+    return result;
+}
+
+// Triangulate this polygon into a frame arena. The faces (and their vertices) are freed when the arena is rewound
+// Return: An array of triangular faces, and its length in numFaces. Every triangle will contain the first vertex
+Polygon* Polygon::getTriangulatedFaces(FrameArena* arena, unsigned int* numFaces){
+
+    // Handle polygons with 3 or less vertices: The result is the whole polygon
+    unsigned int verticesPerFace = 3;
+    if (currentVertices < 4){
+        *numFaces = 1;
+        verticesPerFace = currentVertices;
+    }
+    else
+        *numFaces = currentVertices - 2;
+
+    // Allocate the faces, and a single block of vertices for all of them:
+    Vertex* faceVertices = arena->allocateArray<Vertex>(*numFaces * verticesPerFace);
+    Polygon* result = static_cast<Polygon*>( arena->allocate(sizeof(Polygon) * (*numFaces), alignof(Polygon)) );
+
+    for (unsigned int i = 0; i < *numFaces; i++){
+        // Faces don't own their vertices, so their destructors have nothing to free and don't need to be registered
+        Polygon* newFace = new (&result[i]) Polygon(&faceVertices[i * verticesPerFace], verticesPerFace);
+
+        // Copy the existing polygon's essential drawing attributes:
+        newFace->isAmbientLit = isAmbientLit;
+
+        newFace->theShadingModel = theShadingModel;
+        newFace->specularCoefficient = specularCoefficient;
+        newFace->specularPower = specularPower;
+        newFace->reflectivity = reflectivity;
+
+        newFace->faceNormal = faceNormal;
+
+        // Add the vertices: Fan out from the common first vertex
+        if (currentVertices < 4){
+            for (unsigned int j = 0; j < currentVertices; j++)
+                newFace->addVertex(vertices[j]);
+        }
+        else{
+            newFace->addVertex(vertices[0]);
+            newFace->addVertex(vertices[i + 1]);
+            newFace->addVertex(vertices[i + 2]);
+        }
     }
 
     return result;
@@ -505,12 +617,17 @@ void Polygon::setSpecularCoefficient(double newSpecCoefficient){
 
 // Get this polygon's specular exponent
 double Polygon::getSpecularExponent(){
-    return specularExponent;
+    return specularPower.getExponent();
 }
 
 // Set this polygon's specular exponent
 void Polygon::setSpecularExponent(double newSpecExponent){
-    specularExponent = newSpecExponent;
+    specularPower = SpecularPower(newSpecExponent);
+}
+
+// Get this polygon's specular exponent, prepared for fast evaluation
+SpecularPower Polygon::getSpecularPower(){
+    return specularPower;
 }
 
 // Get this polygon's reflectivity
@@ -541,15 +658,24 @@ Vertex Polygon::getFaceCenter(){
 // Pre-condition: The polygon is a triangle (ie. vertex_i != vertex_j)
 NormalVector Polygon::getFaceNormal(){
 
-    // Calculate vectors originating at vertex 0, and pointing towards vertices 1 & 2
-    NormalVector lhs(vertices[1].x - vertices[0].x, vertices[1].y - vertices[0].y, vertices[1].z - vertices[0].z);  // 0 to 1
-    NormalVector rhs(vertices[2].x - vertices[0].x, vertices[2].y - vertices[0].y, vertices[2].z - vertices[0].z);  // 0 to 2
+    // Use the first pair of vectors from vertex 0 that aren't degenerate. Eg. Quads at the poles of a sphere repeat a vertex, so their first edge has no length
+    NormalVector result;
+    for (unsigned int i = 1; i + 1 < currentVertices; i++){
+
+        // Calculate vectors originating at vertex 0, and pointing towards vertices i & i + 1
+        NormalVector lhs(vertices[i].x - vertices[0].x, vertices[i].y - vertices[0].y, vertices[i].z - vertices[0].z);
+        NormalVector rhs(vertices[i + 1].x - vertices[0].x, vertices[i + 1].y - vertices[0].y, vertices[i + 1].z - vertices[0].z);
 
-    // Perform a cross product, and normalize the result:
-    lhs = lhs.crossProduct(rhs);
-    lhs.normalize();
+        // Perform a cross product:
+        result = lhs.crossProduct(rhs);
+        if (result.length() > 0)
+            break;
+    }
 
-    return lhs;
+    // Normalize the result:
+    result.normalize();
+
+    return result;
 }
 
 // Get the average of the normals of this polygon
@@ -8,6 +8,8 @@
 #include "transformationmatrix.h"
 #include <vector>
 #include "normalvector.h"
+#include "framearena.h"
+#include "specularpower.h"
 
 using std::vector;
 
@@ -27,18 +29,30 @@ public:
     // Triangle Constructor
     Polygon(Vertex p0, Vertex p1, Vertex p2);
 
+    // External storage constructor: Uses a caller owned array of vertexStorageSize vertices (eg. from a FrameArena), which this polygon will not free
+    Polygon(Vertex* vertexStorage, unsigned int vertexStorageSize);
+
     // Copy constructor
     Polygon(const Polygon &existingPolygon);
 
+    // Move constructor: Takes ownership of the existing polygon's vertex array
+    Polygon(Polygon&& existingPolygon) noexcept;
+
     // Overloaded assignment operator
     Polygon& operator=(const Polygon& rhs);
 
+    // Overloaded move assignment operator
+    Polygon& operator=(Polygon&& rhs) noexcept;
+
     // Destructor;
     ~Polygon();
 
     // Remove all vertices from this polygon's vertice array
     void clearVertices();
 
+    // Copy another polygon's drawing attributes (its material and face normal), but not its vertices
+    void copyAttributes(const Polygon& source);
+
     // Add a vertex to the polygon.
     // PreCondition: Vertices are always added in a Counter Clockwise order (vertices[i+1] = CCW, vertices[i-1] = CW
     void addVertex(Vertex newPoint);
@@ -74,9 +88,6 @@ public:
     // Determine if this Polygon is a line (ie. has exactly 2 vertices)
     bool isLine();
 
-    // Polygon frustum culling: Check if this polygon is in bounds of the view frustum
-    bool isInFrustum(double xLow, double xHigh, double yLow, double yHigh);
-
     // Clip a polygon to the edges of the view plane
     // Note: Algorithm sourced from "Computer Graphics: Principals and Practice" Volume 3
     void clipToScreen(double xLow, double xHigh, double yLow, double yHigh);
@@ -84,15 +95,17 @@ public:
     // Clip this polygon to the near/far planes
     void clipHitherYon(double hither, double yon);
 
-    // Determine if this polygon is currently between hither and yon
-    bool isInDepth(double hither, double yon);
-
     // Triangulate this polygon
     // Pre-condition: The polygon has >=4 vertices
     // Return: A mesh containing triangular faces only. Every triangle will contain the first vertex
     vector<Polygon>* getTriangulatedFaces();
 
-    // Check Vertex Winding: Determine if we're looking at the front or the back of the polygon
+    // Triangulate this polygon into a frame arena. The faces (and their vertices) are freed when the arena is rewound
+    // Return: An array of triangular faces, and its length in numFaces. Every triangle will contain the first vertex
+    Polygon* getTriangulatedFaces(FrameArena* arena, unsigned int* numFaces);
+
+    // Check Vertex Winding: Determine if we'll be looking at the front or the back of the polygon once the perspective transformation is applied
+    // Pre-condition: The polygon is in camera space, and has been clipped to hither/yon
     bool isFacingCamera();
 
     // Transform this polygon by a transformation matrix
@@ -131,6 +144,9 @@ public:
     // Set this polygon's specular exponent
     void setSpecularExponent(double newSpecExponent);
 
+    // Get this polygon's specular exponent, prepared for fast evaluation
+    SpecularPower getSpecularPower();
+
     // Get this polygon's reflectivity
     double getReflectivity();
 
@@ -161,12 +177,13 @@ public:
 private:
     unsigned int vertexArraySize; // Size of the vertex array in this polygon
     unsigned int currentVertices; // The number of vertices actually added to this polygon
+    bool ownsVertices;            // Whether the vertex array was allocated (and must be freed) by this polygon
 
     bool isAmbientLit; // Ambient lighting
 
     ShadingModel theShadingModel; // The shading model to be used for this polygon
     double specularCoefficient = 0.3;
-    double specularExponent = 8;
+    SpecularPower specularPower = SpecularPower(8);
     double reflectivity = 0.5;
 
 
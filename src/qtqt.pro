@@ -4,12 +4,14 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui network
 
 CONFIG+=c++11
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+win32: LIBS += -lpsapi
+
 TARGET = qtqt
 TEMPLATE = app
 
@@ -28,7 +30,20 @@ SOURCES += main.cpp\
     renderutilities.cpp \
     normalvector.cpp \
     light.cpp \
-    scene.cpp
+    scene.cpp \
+    framearena.cpp \
+    depthbuffer.cpp \
+    framebuffer.cpp \
+    benchmark.cpp \
+    lightingkernel.cpp \
+    scenesnapshot.cpp \
+    offscreendrawable.cpp \
+    renderservice.cpp \
+    renderserver.cpp \
+    batchrenderer.cpp \
+    meshsimplifier.cpp \
+    spankernel.cpp \
+    workerpool.cpp
 
 HEADERS  += \
     drawable.h \
@@ -46,5 +61,20 @@ HEADERS  += \
     renderutilities.h \
     normalvector.h \
     light.h \
-    scene.h
+    scene.h \
+    framearena.h \
+    depthbuffer.h \
+    framebuffer.h \
+    color.h \
+    benchmark.h \
+    lightingkernel.h \
+    specularpower.h \
+    scenesnapshot.h \
+    offscreendrawable.h \
+    renderservice.h \
+    renderserver.h \
+    batchrenderer.h \
+    meshsimplifier.h \
+    spankernel.h \
+    workerpool.h
 
@@ -5,9 +5,10 @@
 #include <QPaintEvent>
 #include <QSizePolicy>
 #include "drawable.h"
+#include <cstring>
 
 RenderArea361::RenderArea361(QWidget *parent) : QWidget(parent), Drawable(){
-    image = QImage(1000, 1000, QImage::Format_RGB888);
+    image = QImage(1000, 1000, QImage::Format_RGB32); // Matches the renderer's packed ARGB pixels, so rows can be copied directly
     image.fill(0x00ff0000);
     this->setSizePolicy(QSizePolicy());
     this->update();
@@ -21,6 +22,14 @@ uint RenderArea361::getPixel(int x, int y){
     return (uint)(image.pixel(x, y));
 }
 
+// Copy a rectangle of packed ARGB pixels directly into the image, a row at a time
+void RenderArea361::setPixels(int x, int y, int width, int height, const uint* pixels, int rowStride){
+    for (int row = 0; row < height; row++){
+        uint* destination = reinterpret_cast<uint*>(image.scanLine(y + row)) + x;
+        std::memcpy(destination, pixels + row * rowStride, width * sizeof(uint));
+    }
+}
+
 void RenderArea361::updateScreen(){
     this->update();
 }
@@ -13,6 +13,7 @@ public:
     void setPixel(int x, int y, uint color);
     uint getPixel(int x, int y);
     void updateScreen();
+    void setPixels(int x, int y, int width, int height, const uint* pixels, int rowStride);
 
 protected:
     void paintEvent(QPaintEvent *event);
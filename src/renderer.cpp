@@ -5,30 +5,38 @@
 #include "renderutilities.h"
 
 // STL includes:
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <thread>
+#include <utility>
 #include "math.h"               // The STL math library
 
 using std::round;
 using std::cout;
 
+// Adaptive antialiasing parameters:
+const float ANTIALIASING_CONTRAST_THRESHOLD = 0.1f;     // Neighbouring pixels whose channels differ by more than this are refined
+const float ANTIALIASING_DEPTH_THRESHOLD = 0.01f;       // Neighbouring pixels whose normalized depths differ by more than this are refined
+const int ANTIALIASING_SAMPLE_COUNT = 4;                // Extra samples per refined pixel. They're averaged with the pixel's original sample
+
+// Rotated grid subpixel sample offsets, in pixels: No 2 samples share a row or a column, so near-horizontal and near-vertical edges both get 4 distinct coverage levels
+const double ANTIALIASING_SAMPLE_OFFSETS[ANTIALIASING_SAMPLE_COUNT][2] = { {0.125, 0.375}, {0.375, -0.125}, {-0.125, -0.375}, {-0.375, 0.125} };
+
+// The calling thread's shading state. Set by renderScene(), and by each ray casting worker thread
+thread_local Renderer::ShadingState* Renderer::shading = nullptr;
+
 // Constructor
-Renderer::Renderer(Drawable* newDrawable, int newXRes, int newYRes, int borderWidth){
+Renderer::Renderer(Drawable* newDrawable, int newXRes, int newYRes, int borderWidth) : frameBuffer(newXRes, newYRes), depthBuffer(newXRes, newYRes) {
     this->drawable = newDrawable;
 
     border = borderWidth;
     xRes = newXRes;
     yRes = newYRes;
 
-    // Initialize the ZBuffer:
-    ZBuffer = new int*[yRes];
-    for (int row = 0; row < yRes; row++){
-        ZBuffer[row] = new int[xRes];
-        for (int col = 0; col < xRes; col++){
-            ZBuffer[row][col] = maxZVal;
-        }
-    }
-
     // Create a perspective transformation matrix:
     cameraToPerspective.arrayVal(3, 3) = 0; // Removes w component
     cameraToPerspective.arrayVal(3, 2) = 1; // Replaces w component with a copy of the z component
@@ -36,31 +44,23 @@ Renderer::Renderer(Drawable* newDrawable, int newXRes, int newYRes, int borderWi
 
 // Destructor
 Renderer::~Renderer(){
-    // Deallocate the Z-Buffer:
-    for (int x = 0; x < xRes; x++){
-        for (int y = 0; y < yRes; y++){
-            delete ZBuffer[x];
-        }
-    }
-    delete ZBuffer;
+    // The frame and depth buffers deallocate themselves
 }
 
 // Draw a rectangle. Used for setting panel background colors only. Ignores z-buffer.
 // Pre-condition: topLeft_ and botRight_ coords are valid, and in UI window space (ie. (0,0) is in the top left of the screen!)
 void Renderer::drawRectangle(int topLeftX, int topLeftY, int botRightX, int botRightY, unsigned int color){
     // Draw the rectangle
-    for (int x = topLeftX; x <= botRightX; x++){
-        for (int y = topLeftY; y <= botRightY; y++){
-            drawable->setPixel(x, y, color);
-        }
-    }
+    frameBuffer.fillRectangle(topLeftX, topLeftY, botRightX, botRightY, color);
+
     // Update the screen:
-    drawable->updateScreen();
+    presentIfDue();
 }
 
 // Draw a line
 // If theLine's p1.color != p2.color, the line color will be LERP'd. Updates the Z-Buffer.
 void Renderer::drawLine(Line theLine, ShadingModel theShadingModel, bool doAmbient, double specularCoefficient, double specularExponent){
+    isDrawingLine = true;
 
     // Handle vertical lines:
     if (theLine.p1.x == theLine.p2.x){
@@ -103,19 +103,19 @@ void Renderer::drawLine(Line theLine, ShadingModel theShadingModel, bool doAmbie
                     currentPosition.normal.zn = getPerspCorrectLerpValue(theLine.p1.normal.zn, theLine.p1.z, theLine.p2.normal.zn, theLine.p2.z, ratio);
                     currentPosition.normal.normalize(); // Normalize
 
-                    currentPosition.color = getPerspCorrectLerpColor(&theLine.p1, &theLine.p2, ratio); // Get the (perspective correct) base color
+                    currentPosition.color = getPerspCorrectLerpColor(&theLine.p1, &theLine.p2, ratio).toARGB(); // Get the (perspective correct) base color
 
                     // Create a view vector: Points from the face towards the camera
                     NormalVector viewVector(-currentPosition.x, -currentPosition.y, -currentPosition.z);
                     viewVector.normalize();
 
                     // Calculate the lit pixel value, apply distance fog then attempt to set it:
-                    currentPosition.color = lightPointInCameraSpace(&currentPosition, &viewVector, doAmbient, specularExponent, specularCoefficient);
+                    Color litColor = lightPointInCameraSpace(&currentPosition, &viewVector, doAmbient, specularExponent, specularCoefficient);
 
                     if (currentScene->isDepthFogged)
-                        setPixel((int)theLine.p1.x, y, correctZ, getDistanceFoggedColor( currentPosition.color, correctZ ) );
+                        setPixel((int)theLine.p1.x, y, correctZ, getDistanceFoggedColor( litColor, correctZ ) );
                     else
-                        setPixel((int)theLine.p1.x, y, correctZ, currentPosition.color );
+                        setPixel((int)theLine.p1.x, y, correctZ, litColor );
                 }
                 else{
                     if (currentScene->isDepthFogged)
@@ -198,18 +198,18 @@ void Renderer::drawLine(Line theLine, ShadingModel theShadingModel, bool doAmbie
                         currentPosition.normal.zn = getPerspCorrectLerpValue(lowest.normal.zn, lowest.z, highest.normal.zn, highest.z, ratio);
                         currentPosition.normal.normalize(); // Normalize
 
-                        currentPosition.color = getPerspCorrectLerpColor(&theLine.p1, &theLine.p2, ratio); // Get the (perspective correct) base color
+                        currentPosition.color = getPerspCorrectLerpColor(&theLine.p1, &theLine.p2, ratio).toARGB(); // Get the (perspective correct) base color
 
                         // Create a view vector: Points from the face towards the camera
                         NormalVector viewVector(-currentPosition.x, -currentPosition.y, -currentPosition.z);
                         viewVector.normalize();
 
-                        currentPosition.color = lightPointInCameraSpace(&currentPosition, &viewVector, doAmbient, specularExponent, specularCoefficient);
+                        Color litColor = lightPointInCameraSpace(&currentPosition, &viewVector, doAmbient, specularExponent, specularCoefficient);
 
                         if (currentScene->isDepthFogged) // Calculate the lit pixel value, apply distance fog then attempt to set it:
-                            setPixel(round_x, y, correctZ, getDistanceFoggedColor( currentPosition.color, correctZ ) );
+                            setPixel(round_x, y, correctZ, getDistanceFoggedColor( litColor, correctZ ) );
                         else
-                            setPixel(round_x, y, correctZ, currentPosition.color );
+                            setPixel(round_x, y, correctZ, litColor );
                     }
                     else{
                         if (currentScene->isDepthFogged)
@@ -257,19 +257,19 @@ void Renderer::drawLine(Line theLine, ShadingModel theShadingModel, bool doAmbie
                         currentPosition.normal.zn = getPerspCorrectLerpValue(theLine.p1.normal.zn, theLine.p1.z, theLine.p2.normal.zn, theLine.p2.z, ratio);
                         currentPosition.normal.normalize(); // Normalize
 
-                        currentPosition.color = getPerspCorrectLerpColor(&theLine.p1, &theLine.p2, ratio); // Get the (perspective correct) base color
+                        currentPosition.color = getPerspCorrectLerpColor(&theLine.p1, &theLine.p2, ratio).toARGB(); // Get the (perspective correct) base color
 
                         // Create a view vector: Points from the face towards the camera
                         NormalVector viewVector(-currentPosition.x, -currentPosition.y, -currentPosition.z);
                         viewVector.normalize();
 
                         // Calculate the lit pixel value, apply distance fog then attempt to set it:
-                        currentPosition.color = lightPointInCameraSpace(&currentPosition, &viewVector, doAmbient, specularExponent, specularCoefficient);
+                        Color litColor = lightPointInCameraSpace(&currentPosition, &viewVector, doAmbient, specularExponent, specularCoefficient);
 
                         if (currentScene->isDepthFogged)
-                            setPixel(x, round_y, correctZ, getDistanceFoggedColor( currentPosition.color, correctZ ) );
+                            setPixel(x, round_y, correctZ, getDistanceFoggedColor( litColor, correctZ ) );
                         else
-                            setPixel(x, round_y, correctZ, currentPosition.color );
+                            setPixel(x, round_y, correctZ, litColor );
                     }
                     else{
                         if (currentScene->isDepthFogged)
@@ -285,8 +285,10 @@ void Renderer::drawLine(Line theLine, ShadingModel theShadingModel, bool doAmbie
         }
     } // End non-vertical line else
 
+    isDrawingLine = false;
+
     // Update the screen:
-    drawable->updateScreen();
+    presentIfDue();
 }
 
 // Draw a polygon. Calls the rasterize Polygon helper function
@@ -294,24 +296,52 @@ void Renderer::drawLine(Line theLine, ShadingModel theShadingModel, bool doAmbie
 // Pre-condition: All polygons are in camera space
 void Renderer::drawPolygon(Polygon thePolygon, bool isWireframe){
 
-    // Cull polygons outside of hither/yon
-    if (!thePolygon.isInDepth(currentScene->camHither, currentScene->camYon)){
+    // Find which planes of the view volume the polygon's vertices are outside of:
+    unsigned int anyOutside, allOutside;
+    getClipCodes(thePolygon.vertices, thePolygon.getVertexCount(), &anyOutside, &allOutside);
+    polygonsClipTested++;
+
+    // Cull polygons entirely outside of hither/yon, or the view window
+    if (allOutside & (clipDepth | clipWindow)){
         return;
     }
 
-    // Clip polygon to intersection with hither/yon
-    thePolygon.clipHitherYon(currentScene->camHither, currentScene->camYon);
+    // Clip polygon to intersection with hither/yon, only if it crosses them. The clipped polygon has new vertices, which need new clip codes
+    if (anyOutside & clipDepth){
+        thePolygon.clipHitherYon(currentScene->camHither, currentScene->camYon);
+        polygonsDepthClipped++;
+
+        getClipCodes(thePolygon.vertices, thePolygon.getVertexCount(), &anyOutside, &allOutside);
+        if (allOutside & clipWindow)
+            return;
+    }
 
     // Handle polygons that have been rendered invalid by clipping
     if(!thePolygon.isValid())
         return;
 
+    // Occlusion cull: Don't light or rasterize polygons hidden behind what has already been drawn
+    if (!isWireframe && !thePolygon.isLine()){
+        polygonsTested++;
+        if (isOccluded(thePolygon.vertices, thePolygon.getVertexCount())){
+            polygonsOccluded++;
+            return;
+        }
+    }
+
+    // Backface cull: Don't light or render polygons not facing the camera
+    if (!isWireframe && !thePolygon.isLine() && !thePolygon.isFacingCamera()){ // Don't backface cull wireframe polygons or lines, as we still want to see them
+        return;
+    }
+
     // Apply ambient lighting to Lines, if neccessary:
     if (thePolygon.isLine() && thePolygon.isAffectedByAmbientLight() ){
         thePolygon.lightAmbiently( currentScene->ambientRedIntensity, currentScene->ambientGreenIntensity, currentScene->ambientBlueIntensity);
     }
 
     // Calculate flat/gouraud lighting (while we're still in camera space)
+    // Polygons crossing the view window are lit before they're clipped to it, on purpose: Flat shading lights the face center, and gouraud shading interpolates
+    // across the whole face, so lighting the clipped polygon would change its colors wherever the window edge happened to cut it
     // Handle flat shading:
     else if (thePolygon.getShadingModel() == flat && !isWireframe && !thePolygon.isLine() ){ // Only light the polygon if it's not wireframe or a line
         flatShadePolygon( &thePolygon );
@@ -324,22 +354,32 @@ void Renderer::drawPolygon(Polygon thePolygon, bool isWireframe){
     // Apply perspective xform:
     thePolygon.transform( &cameraToPerspective );
 
-    // Backface cull: Don't attempt to render polygons not facing the camera
-    if (!thePolygon.isFacingCamera() && !isWireframe && !thePolygon.isLine()){ // Don't backface cull wireframe polygons or lines, as we still want to see them
-      return;
-    }
+    // Frustum clipping: Clip polygon to 4 sides of view window, only if it crosses them. Filled polygons inside the guard band are scissored as they're rasterized instead
+    // Lines are never clipped to the view window: drawLine() handles them
+    if ((anyOutside & clipWindow) && !thePolygon.isLine()){
+        if (!isWireframe && !(anyOutside & clipGuardBand)){
+            polygonsGuardBandAccepted++;
+        }
+        else{
+            thePolygon.clipToScreen(currentScene->xLow, currentScene->xHigh, currentScene->yLow, currentScene->yHigh);
+            polygonsScreenClipped++;
 
-    // Polygon frustum culling: Cull polygons outside of xLow/xHigh/yLow/yHigh
-    if (!thePolygon.isInFrustum(currentScene->xLow, currentScene->xHigh, currentScene->yLow, currentScene->yHigh)){
-        return;
+            // Handle polygons that have been rendered invalid by clipping
+            if(!thePolygon.isValid())
+                return;
+        }
     }
 
-    // Frustum clipping: Clip polygon to 4 sides of view window:
-    thePolygon.clipToScreen(currentScene->xLow, currentScene->xHigh, currentScene->yLow, currentScene->yHigh);
+    // Fill polygons with the edge function rasterizer, if it's selected. It snaps the vertices to subpixels itself, so they aren't transformed to screen space here
+    if (rasterizer == edgeFunctionRasterizer && !isWireframe && !thePolygon.isLine()){
+        ArenaScope triangulationScope(&shading->frameArena);
+        unsigned int numFaces;
+        Polygon* theFaces = thePolygon.getTriangulatedFaces(&shading->frameArena, &numFaces);
 
-    // Handle polygons that have been rendered invalid by clipping
-    if(!thePolygon.isValid())
+        for (unsigned int i = 0; i < numFaces; i++)
+            rasterizeTriangle( &theFaces[i] );
         return;
+    }
 
     // Tranform perspective to screen space
     thePolygon.transform(&perspectiveToScreen, true);
@@ -350,29 +390,32 @@ void Renderer::drawPolygon(Polygon thePolygon, bool isWireframe){
         return;
     }
 
-    // Trianglulate:
-    vector<Polygon>* theFaces = thePolygon.getTriangulatedFaces();  
+    // Trianglulate into the frame arena. The faces are released when this scope ends
+    ArenaScope triangulationScope(&shading->frameArena);
+    unsigned int numFaces;
+    Polygon* theFaces = thePolygon.getTriangulatedFaces(&shading->frameArena, &numFaces);
 
     // Render each resulting triangle:
-    for (unsigned int i = 0; i < theFaces->size(); i++){
+    for (unsigned int i = 0; i < numFaces; i++){
 
         // Draw regular polygons:
         if (!isWireframe) {
-            rasterizePolygon( &theFaces->at(i) );
+            rasterizePolygon( &theFaces[i] );
         }
         else{ // Draw wireframe polygons
-            drawPolygonWireframe( &theFaces->at(i) );
+            drawPolygonWireframe( &theFaces[i] );
         }
     }
-
-    // Cleanup:
-    delete theFaces;
 }
 
 // Rasterize a polygon
 // Pre-condition: Received polygon is a triange, is in screen space, and all 3 vertices have been rounded to integer coordinates
 void Renderer::rasterizePolygon(Polygon* thePolygon){
 
+    // Set up the triangle's interpolation planes: The scanlines evaluate them directly, so only x is stepped along the edges
+    AttributePlanes planes;
+    setupAttributePlanes(thePolygon, &planes);
+
     // Get the vertices from the polygon:
     Vertex* topLeftVertex = thePolygon->getHighest();
     Vertex* topRightVertex = topLeftVertex; // Start edge traversal at the same point
@@ -405,60 +448,22 @@ void Renderer::rasterizePolygon(Polygon* thePolygon){
     // Calculate slopes of the polygon edges:
     double DYLeft = topLeftVertex->y - botLeftVertex->y;
     double DYRight = topRightVertex->y - botRightVertex->y;
-    double zLeft = topLeftVertex->z;
-    double zRight = topRightVertex->z;
 
     // Edge slopes:
-    double xLeftSlope, xRightSlope, zLeftSlope, zRightSlope, leftRatioDiff, rightRatioDiff;
-    if (DYLeft == 0){
-        xLeftSlope = 0;
-        zLeftSlope = 0;
-        leftRatioDiff = 0;
-    }
-    else{
-        xLeftSlope = (topLeftVertex->x - botLeftVertex->x)/(double)DYLeft;
-        zLeftSlope = (topLeftVertex->z - botLeftVertex->z)/(double)DYLeft;
-        leftRatioDiff = 1.0 /(double) DYLeft;
-    }
-    if (DYRight == 0){
-        xRightSlope = 0;
-        zRightSlope = 0;
-        rightRatioDiff = 0;
-    }
-    else {
-        xRightSlope = (topRightVertex->x - botRightVertex->x)/(double)DYRight;
-        zRightSlope = (topRightVertex->z - botRightVertex->z)/(double)DYRight;
-        rightRatioDiff = 1.0 /(double) DYRight;
-    }
-
-    // Left/Right edge starting ratio (for perspective correct Z calculations)
-    double leftRatio = 0;
-    double rightRatio = 0;
+    double xLeftSlope = (DYLeft == 0) ? 0 : (topLeftVertex->x - botLeftVertex->x)/(double)DYLeft;
+    double xRightSlope = (DYRight == 0) ? 0 : (topRightVertex->x - botRightVertex->x)/(double)DYRight;
 
     // Main drawing loop:
     while (y >= yMin){
 
-        // Assemble 2 points, and draw a scanline between them.
-        double leftCorrectZ = getPerspCorrectLerpValue(topLeftVertex->z, topLeftVertex->z, botLeftVertex->z, botLeftVertex->z, leftRatio );
-        double rightCorrectZ = getPerspCorrectLerpValue(topRightVertex->z, topRightVertex->z, botRightVertex->z, botRightVertex->z, rightRatio );
-
-        double xLeft_rounded = round(xLeft); // Pre-round our coordinates for the scanline functions
-        double xRight_rounded = round(xRight);
-
-        if (thePolygon->getShadingModel() == phong){
+        // Draw a scanline between the edges. Scanlines outside of the view window are skipped, but the edges still step past them
+        if (y >= scissorYMin && y <= scissorYMax){
 
-            Vertex lhs(xLeft_rounded, (double)y, leftCorrectZ, getPerspCorrectLerpColor(topLeftVertex, botLeftVertex, leftRatio));
-            lhs.normal = NormalVector(topLeftVertex->normal, topLeftVertex->z, botLeftVertex->normal, botLeftVertex->z, y, topLeftVertex->y, botLeftVertex->y);
-
-            Vertex rhs(xRight_rounded, (double)y, rightCorrectZ, getPerspCorrectLerpColor(topRightVertex, botRightVertex, rightRatio));
-            rhs.normal = NormalVector(topRightVertex->normal, topRightVertex->z, botRightVertex->normal, botRightVertex->z, y, topRightVertex->y, botRightVertex->y);
-
-            drawPerPxLitScanlineIfVisible( &lhs, &rhs, thePolygon->isAffectedByAmbientLight(), thePolygon->getSpecularCoefficient(), thePolygon->getSpecularExponent());
+            if (thePolygon->getShadingModel() == phong)
+                drawPerPxLitScanlineIfVisible(xLeft, xRight, y, &planes, thePolygon->isAffectedByAmbientLight(), thePolygon->getSpecularCoefficient(), thePolygon->getSpecularPower());
+            else
+                drawScanlineIfVisible(xLeft, xRight, y, &planes);
         }
-        else
-            drawScanlineIfVisible( &Vertex(xLeft_rounded, (double)y, leftCorrectZ, getPerspCorrectLerpColor(topLeftVertex, botLeftVertex, leftRatio)),
-                                   &Vertex(xRight_rounded, (double)y, rightCorrectZ, getPerspCorrectLerpColor(topRightVertex, botRightVertex, rightRatio))
-                                   );
 
         y--; // Move to the next line, and handle transitions between vertices if neccessary:
 
@@ -467,94 +472,664 @@ void Renderer::rasterizePolygon(Polygon* thePolygon){
             topLeftVertex = botLeftVertex;
             botLeftVertex = thePolygon->getNext(botLeftVertex->vertexNumber);
             DYLeft = topLeftVertex->y - botLeftVertex->y;
+            xLeftSlope = (DYLeft == 0) ? 0 : (topLeftVertex->x - botLeftVertex->x) / DYLeft;
 
-            if (DYLeft == 0){
-                xLeftSlope = 0;
-                zLeftSlope = 0;
-                leftRatioDiff = 0;
-            }
-            else{
-                xLeftSlope = (topLeftVertex->x - botLeftVertex->x) / DYLeft;
-                zLeftSlope = (topLeftVertex->z - botLeftVertex->z) / DYLeft;
-                leftRatioDiff = 1.0 /(double) DYLeft;
-            }
-
-            zLeft = (double)topLeftVertex->z - zLeftSlope;   // Subtract the diffs, as the first scanline of the new poly segment has already been drawn
-            xLeft = topLeftVertex->x - xLeftSlope;
-            leftRatio = leftRatioDiff;                      // 0 + an increment of the diff
+            xLeft = topLeftVertex->x - xLeftSlope; // Subtract the diff, as the first scanline of the new poly segment has already been drawn
         }
-        else { // Otherwise, increment the current positions
+        else // Otherwise, increment the current position
             xLeft -= xLeftSlope;
-            zLeft -= zLeftSlope;
-            leftRatio += leftRatioDiff;
-        }
 
         // Handle right edge
         if (y < botRightVertex->y){
             topRightVertex = botRightVertex;
             botRightVertex = thePolygon->getPrev(botRightVertex->vertexNumber);
             DYRight = topRightVertex->y - botRightVertex->y;
+            xRightSlope = (DYRight == 0) ? 0 : (topRightVertex->x - botRightVertex->x) / DYRight;
+
+            xRight = topRightVertex->x - xRightSlope; // Subtract the diff, as the first scanline of the new poly segment has already been drawn
+        }
+        else // Otherwise, increment the current position
+            xRight -= xRightSlope;
+
+    } // End main drawing loop
 
-            if (DYRight == 0){
-                xRightSlope = 0;
-                zRightSlope = 0;
-                rightRatioDiff = 0;
+    // Update the screen:
+    presentIfDue();
+}
+
+// Set up the perspective correct interpolation planes of a triangle
+// Each attribute's gradient is a weighted sum of its vertex values: The weights are the gradients of the triangle's screen space barycentric coordinates
+void Renderer::setupAttributePlanes(Polygon* thePolygon, AttributePlanes* planes){
+    Vertex* vertices = thePolygon->vertices;
+
+    planes->originX = vertices[0].x;
+    planes->originY = vertices[0].y;
+
+    double edge1X = vertices[1].x - vertices[0].x;
+    double edge1Y = vertices[1].y - vertices[0].y;
+    double edge2X = vertices[2].x - vertices[0].x;
+    double edge2Y = vertices[2].y - vertices[0].y;
+    double determinant = edge1X * edge2Y - edge2X * edge1Y;
+    double inverseDeterminant = (determinant == 0) ? 0 : 1.0 / determinant; // Degenerate triangles have flat planes
+
+    // Barycentric gradients:
+    double weightDx[3], weightDy[3];
+    weightDx[1] = edge2Y * inverseDeterminant;
+    weightDx[2] = -edge1Y * inverseDeterminant;
+    weightDx[0] = -(weightDx[1] + weightDx[2]);
+    weightDy[1] = -edge2X * inverseDeterminant;
+    weightDy[2] = edge1X * inverseDeterminant;
+    weightDy[0] = -(weightDy[1] + weightDy[2]);
+
+    // 1/z:
+    double inverseZ[3] = {1.0 / vertices[0].z, 1.0 / vertices[1].z, 1.0 / vertices[2].z};
+    planes->inverseZ = inverseZ[0];
+    planes->inverseZDx = weightDx[0] * inverseZ[0] + weightDx[1] * inverseZ[1] + weightDx[2] * inverseZ[2];
+    planes->inverseZDy = weightDy[0] * inverseZ[0] + weightDy[1] * inverseZ[1] + weightDy[2] * inverseZ[2];
+
+    // Color/z:
+    planes->isSolidColor = vertices[0].color == vertices[1].color && vertices[0].color == vertices[2].color;
+    planes->solidColor = Color::fromARGB(vertices[0].color);
+    if (!planes->isSolidColor){
+        Color colors[3] = {Color::fromARGB(vertices[0].color), Color::fromARGB(vertices[1].color), Color::fromARGB(vertices[2].color)};
+
+        planes->colorOverZ = colors[0] * (float)inverseZ[0];
+        planes->colorOverZDx = colors[0] * (float)(weightDx[0] * inverseZ[0]) + colors[1] * (float)(weightDx[1] * inverseZ[1]) + colors[2] * (float)(weightDx[2] * inverseZ[2]);
+        planes->colorOverZDy = colors[0] * (float)(weightDy[0] * inverseZ[0]) + colors[1] * (float)(weightDy[1] * inverseZ[1]) + colors[2] * (float)(weightDy[2] * inverseZ[2]);
+    }
+
+    // Normal/z:
+    if (thePolygon->getShadingModel() == phong){
+        double normals[3][3] = {{vertices[0].normal.xn, vertices[1].normal.xn, vertices[2].normal.xn},  // [component][vertex]
+                                {vertices[0].normal.yn, vertices[1].normal.yn, vertices[2].normal.yn},
+                                {vertices[0].normal.zn, vertices[1].normal.zn, vertices[2].normal.zn}};
+
+        for (int i = 0; i < 3; i++){
+            planes->normalOverZ[i] = normals[i][0] * inverseZ[0];
+            planes->normalOverZDx[i] = weightDx[0] * normals[i][0] * inverseZ[0] + weightDx[1] * normals[i][1] * inverseZ[1] + weightDx[2] * normals[i][2] * inverseZ[2];
+            planes->normalOverZDy[i] = weightDy[0] * normals[i][0] * inverseZ[0] + weightDy[1] * normals[i][1] * inverseZ[1] + weightDy[2] * normals[i][2] * inverseZ[2];
+        }
+    }
+}
+
+// Draw a triangle using edge functions, testing its pixels in blocks
+// Note: Screen space y points up, so front facing triangles are counter-clockwise. Pixel centers lie on whole pixel coordinates, as in rasterizePolygon()
+void Renderer::rasterizeTriangle(Polygon* thePolygon){
+
+    // Project the vertices to screen space (as in drawPolygon(), without rounding), and snap them to fixed point subpixels:
+    int64_t fixedX[3], fixedY[3];
+    for (int i = 0; i < 3; i++){
+        Vertex* currentVertex = &thePolygon->vertices[i];
+        double screenX = perspectiveToScreen.arrayVal(0, 0) * currentVertex->x + perspectiveToScreen.arrayVal(0, 1) * currentVertex->y + perspectiveToScreen.arrayVal(0, 2) * currentVertex->z + perspectiveToScreen.arrayVal(0, 3);
+        double screenY = perspectiveToScreen.arrayVal(1, 0) * currentVertex->x + perspectiveToScreen.arrayVal(1, 1) * currentVertex->y + perspectiveToScreen.arrayVal(1, 2) * currentVertex->z + perspectiveToScreen.arrayVal(1, 3);
+
+        fixedX[i] = (int64_t)std::llround(screenX * RASTER_SUBPIXEL_SCALE);
+        fixedY[i] = (int64_t)std::llround(screenY * RASTER_SUBPIXEL_SCALE);
+    }
+
+    // Find twice the triangle's area. Walk clockwise triangles in the opposite order, so every triangle is counter-clockwise
+    int order[3] = {0, 1, 2};
+    int64_t area = (fixedX[1] - fixedX[0]) * (fixedY[2] - fixedY[0]) - (fixedY[1] - fixedY[0]) * (fixedX[2] - fixedX[0]);
+    if (area == 0) // Triangles that snap to a line cover no pixels
+        return;
+    if (area < 0){
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+
+    // Find the pixels the triangle's bounding box covers, within the scissor rectangle:
+    int64_t minX = std::min(std::min(fixedX[0], fixedX[1]), fixedX[2]);
+    int64_t maxX = std::max(std::max(fixedX[0], fixedX[1]), fixedX[2]);
+    int64_t minY = std::min(std::min(fixedY[0], fixedY[1]), fixedY[2]);
+    int64_t maxY = std::max(std::max(fixedY[0], fixedY[1]), fixedY[2]);
+
+    int xMin = std::max((int)std::ceil(minX / (double)RASTER_SUBPIXEL_SCALE), scissorXMin);
+    int xMax = std::min((int)std::floor(maxX / (double)RASTER_SUBPIXEL_SCALE), scissorXMax);
+    int yMin = std::max((int)std::ceil(minY / (double)RASTER_SUBPIXEL_SCALE), scissorYMin);
+    int yMax = std::min((int)std::floor(maxY / (double)RASTER_SUBPIXEL_SCALE), scissorYMax);
+    if (xMin > xMax || yMin > yMax)
+        return;
+
+    trianglesRasterized++;
+
+    // Set up the edge functions: Edge i runs from vertex order[i] to vertex order[i + 1], and is positive inside the triangle
+    // At a pixel, each edge function is the barycentric weight of the vertex opposite it, scaled by twice the triangle's area
+    // Top-left fill rule: Pixels exactly on an edge belong to the triangle only if it's a left edge (running down) or a top edge (horizontal, running left). Other edges are biased by -1, so 0 fails
+    int64_t stepX[3], stepY[3], bias[3], blockOrigin[3];
+    for (int i = 0; i < 3; i++){
+        int start = order[i];
+        int end = order[(i + 1) % 3];
+        int64_t deltaX = fixedX[end] - fixedX[start];
+        int64_t deltaY = fixedY[end] - fixedY[start];
+
+        stepX[i] = -deltaY * RASTER_SUBPIXEL_SCALE;  // Change in the edge function per pixel
+        stepY[i] = deltaX * RASTER_SUBPIXEL_SCALE;
+
+        bool isTopLeft = deltaY < 0 || (deltaY == 0 && deltaX < 0);
+        bias[i] = isTopLeft ? 0 : -1;
+
+        // The edge function at the first pixel:
+        blockOrigin[i] = deltaX * ((int64_t)yMin * RASTER_SUBPIXEL_SCALE - fixedY[start]) - deltaY * ((int64_t)xMin * RASTER_SUBPIXEL_SCALE - fixedX[start]) + bias[i];
+    }
+
+    // The covered pixels of each block are gathered here, then shaded together. Released from the frame arena when this scope ends
+    ArenaScope blockScope(&shading->frameArena);
+    const int blockPixels = RASTER_BLOCK_SIZE * RASTER_BLOCK_SIZE;
+    int* pixelX = shading->frameArena.allocateArray<int>(blockPixels);
+    int* pixelY = shading->frameArena.allocateArray<int>(blockPixels);
+    double* weights = shading->frameArena.allocateArray<double>(3 * blockPixels);
+    bool* isEndPoint = shading->frameArena.allocateArray<bool>(blockPixels);
+
+    double inverseArea = 1.0 / (double)area;
+
+    for (int blockY = yMin; blockY <= yMax; blockY += RASTER_BLOCK_SIZE){
+        int blockYMax = std::min(blockY + RASTER_BLOCK_SIZE - 1, yMax);
+
+        for (int blockX = xMin; blockX <= xMax; blockX += RASTER_BLOCK_SIZE){
+            int blockXMax = std::min(blockX + RASTER_BLOCK_SIZE - 1, xMax);
+
+            // Evaluate each edge function at the block's first pixel. Being linear, its extremes over the block lie at the block's corners
+            int64_t rowValues[3];
+            bool isAccepted = true, isRejected = false;
+            for (int i = 0; i < 3; i++){
+                rowValues[i] = blockOrigin[i] + stepX[i] * (blockX - xMin) + stepY[i] * (blockY - yMin);
+
+                int64_t spanX = stepX[i] * (blockXMax - blockX);
+                int64_t spanY = stepY[i] * (blockYMax - blockY);
+                int64_t minValue = rowValues[i] + std::min(spanX, (int64_t)0) + std::min(spanY, (int64_t)0);
+                int64_t maxValue = rowValues[i] + std::max(spanX, (int64_t)0) + std::max(spanY, (int64_t)0);
+
+                if (maxValue < 0)
+                    isRejected = true;  // Every pixel is outside of this edge
+                if (minValue < 0)
+                    isAccepted = false; // Some pixels may be outside of this edge
             }
-            else {
-                xRightSlope = (topRightVertex->x - botRightVertex->x) / DYRight;
-                zRightSlope = (topRightVertex->z - botRightVertex->z) / DYRight;
-                rightRatioDiff = 1.0 /(double) DYRight;
+
+            // Skip blocks entirely outside of the triangle:
+            if (isRejected){
+                blocksRejected++;
+                continue;
             }
+            if (isAccepted)
+                blocksAccepted++;
+            else
+                blocksPartial++;
+
+            // Gather the covered pixels, stepping the edge functions incrementally. Blocks entirely inside the triangle skip the coverage tests
+            int numPixels = 0;
+            for (int y = blockY; y <= blockYMax; y++){
+                int64_t values[3] = {rowValues[0], rowValues[1], rowValues[2]};
+
+                for (int x = blockX; x <= blockXMax; x++){
+                    if (isAccepted || (values[0] >= 0 && values[1] >= 0 && values[2] >= 0)){
+                        pixelX[numPixels] = x;
+                        pixelY[numPixels] = y;
 
-            zRight = (double)topRightVertex->z - zRightSlope;    // Subtract the diffs, as the first scanline of the new poly segment has already been drawn
-            xRight = topRightVertex->x - xRightSlope;
-            rightRatio = rightRatioDiff;                        // 0 + an increment of the diff
+                        // Edge i's function (without its bias) weights the vertex opposite it:
+                        for (int i = 0; i < 3; i++)
+                            weights[3 * numPixels + order[(i + 2) % 3]] = (values[i] - bias[i]) * inverseArea;
+
+                        // Pixels whose left or right neighbour isn't covered lie on the triangle's edge:
+                        isEndPoint[numPixels] = false;
+                        for (int i = 0; i < 3; i++)
+                            isEndPoint[numPixels] = isEndPoint[numPixels] || values[i] - stepX[i] < 0 || values[i] + stepX[i] < 0;
+
+                        numPixels++;
+                    }
+
+                    for (int i = 0; i < 3; i++)
+                        values[i] += stepX[i];
+                }
+
+                for (int i = 0; i < 3; i++)
+                    rowValues[i] += stepY[i];
+            }
+
+            if (numPixels > 0)
+                shadeTrianglePixels(thePolygon, pixelX, pixelY, weights, isEndPoint, numPixels);
         }
-        else { // Otherwise, increment the current positions
-            xRight -= xRightSlope;
-            zRight -= zRightSlope;
-            rightRatio += rightRatioDiff;
+    }
+
+    // Update the screen:
+    presentIfDue();
+}
+
+// Shade and set a set of covered pixels of a triangle, if they pass the depth test
+// Note: Attributes are interpolated perspective correctly: Each vertex's screen space weight is divided by its depth, and the weights renormalized
+void Renderer::shadeTrianglePixels(Polygon* thePolygon, int* pixelX, int* pixelY, double* weights, bool* isEndPoint, int numPixels){
+    Vertex* vertices = thePolygon->vertices;
+    double inverseZ[3] = {1.0 / vertices[0].z, 1.0 / vertices[1].z, 1.0 / vertices[2].z};
+
+    Color colors[3] = {Color::fromARGB(vertices[0].color), Color::fromARGB(vertices[1].color), Color::fromARGB(vertices[2].color)};
+    bool isSolidColor = vertices[0].color == vertices[1].color && vertices[0].color == vertices[2].color;
+    bool isPhong = thePolygon->getShadingModel() == phong;
+
+    // Released from the frame arena when this scope ends
+    ArenaScope shadingScope(&shading->frameArena);
+    Vertex* pixelPositions = nullptr;
+    NormalVector* viewVectors = nullptr;
+    SurfacePoint* surfacePoints = nullptr;
+    bool* isVisibleEndPoint = nullptr;
+    int* visiblePixels = nullptr;
+    double* visibleZ = nullptr;
+    Color* litColors = nullptr;
+    if (isPhong){
+        pixelPositions = shading->frameArena.allocateArray<Vertex>(numPixels);
+        viewVectors = shading->frameArena.allocateArray<NormalVector>(numPixels);
+        surfacePoints = shading->frameArena.allocateArray<SurfacePoint>(numPixels);
+        isVisibleEndPoint = shading->frameArena.allocateArray<bool>(numPixels);
+        visiblePixels = shading->frameArena.allocateArray<int>(numPixels);
+        visibleZ = shading->frameArena.allocateArray<double>(numPixels);
+        litColors = shading->frameArena.allocateArray<Color>(numPixels);
+    }
+    int numVisible = 0;
+
+    for (int i = 0; i < numPixels; i++){
+        double* pixelWeights = &weights[3 * i];
+
+        // Find the perspective correct depth and vertex weights:
+        double correctZ = 1.0 / (pixelWeights[0] * inverseZ[0] + pixelWeights[1] * inverseZ[1] + pixelWeights[2] * inverseZ[2]);
+        double correctWeights[3];
+        for (int j = 0; j < 3; j++)
+            correctWeights[j] = pixelWeights[j] * inverseZ[j] * correctZ;
+
+        if (!isVisible(pixelX[i], pixelY[i], correctZ))
+            continue;
+
+        Color baseColor = isSolidColor ? colors[0] : colors[0] * (float)correctWeights[0] + colors[1] * (float)correctWeights[1] + colors[2] * (float)correctWeights[2];
+
+        // Flat and gouraud shaded pixels are finished:
+        if (!isPhong){
+            if (currentScene->isDepthFogged)
+                setPixel(pixelX[i], pixelY[i], correctZ, getDistanceFoggedColor(baseColor, correctZ));
+            else
+                setPixel(pixelX[i], pixelY[i], correctZ, baseColor);
+            continue;
         }
 
-    } // End main drawing loop
+        // Phong shaded pixels are lit together: Calculate the pixel position, as a vertex in camera space
+        Vertex* currentPosition = &pixelPositions[numVisible];
+        *currentPosition = Vertex(pixelX[i], pixelY[i], correctZ);
+        currentPosition->transform(&screenToPerspective); // Transform back to perspective space
 
-    // Update the screen:
-    drawable->updateScreen();
+        // Correct the perspective transformation: Transform the point back to camera space
+        currentPosition->x *= correctZ;
+        currentPosition->y *= correctZ;
+
+        // Set the perspective correct normal:
+        currentPosition->normal.xn = correctWeights[0] * vertices[0].normal.xn + correctWeights[1] * vertices[1].normal.xn + correctWeights[2] * vertices[2].normal.xn;
+        currentPosition->normal.yn = correctWeights[0] * vertices[0].normal.yn + correctWeights[1] * vertices[1].normal.yn + correctWeights[2] * vertices[2].normal.yn;
+        currentPosition->normal.zn = correctWeights[0] * vertices[0].normal.zn + correctWeights[1] * vertices[1].normal.zn + correctWeights[2] * vertices[2].normal.zn;
+        currentPosition->normal.normalize();
+
+        currentPosition->color = baseColor.toARGB();
+
+        // Create a view vector: Points from the face towards the camera
+        viewVectors[numVisible] = NormalVector(-currentPosition->x, -currentPosition->y, -currentPosition->z);
+        viewVectors[numVisible].normalize();
+
+        surfacePoints[numVisible].position = currentPosition;
+        surfacePoints[numVisible].viewVector = &viewVectors[numVisible];
+        surfacePoints[numVisible].doAmbient = thePolygon->isAffectedByAmbientLight();
+        surfacePoints[numVisible].specularPower = thePolygon->getSpecularPower();
+        surfacePoints[numVisible].specularCoefficient = thePolygon->getSpecularCoefficient();
+
+        isVisibleEndPoint[numVisible] = isEndPoint[i];
+        visiblePixels[numVisible] = i;
+        visibleZ[numVisible] = correctZ;
+        numVisible++;
+    }
+
+    if (numVisible == 0)
+        return;
+
+    // Light the visible pixels together, then set them:
+    recursivelyLightPoints(surfacePoints, numVisible, currentScene->numRayBounces, isVisibleEndPoint, litColors);
+
+    for (int i = 0; i < numVisible; i++)
+        setPixel(pixelX[visiblePixels[i]], pixelY[visiblePixels[i]], visibleZ[i], litColors[i]);
 }
 
-// Light a Polygon using flat shading
-// Pre-condition: All vertices have a valid normal
-void Renderer::flatShadePolygon(Polygon* thePolygon){
+// Enable or disable adaptive antialiasing
+void Renderer::setAntialiasing(bool isEnabled){
+    isAntialiased = isEnabled;
+}
 
-    unsigned int* ambientValues = new unsigned int[ thePolygon->getVertexCount() ];
+// Select the rasterizer used to fill polygons
+void Renderer::setRasterizer(RasterizerMode newRasterizer){
+    rasterizer = newRasterizer;
+}
 
-    double* redDiffuseTotals = new double[ thePolygon->getVertexCount() ];
-    double* greenDiffuseTotals = new double[ thePolygon->getVertexCount() ];
-    double* blueDiffuseTotals = new double[ thePolygon->getVertexCount() ];
+// Set the number of threads the ray cast rasterizer shares primary rays between, including the calling thread
+void Renderer::setRayCastThreads(int numThreads){
+    rayCastThreadBudget = (unsigned int)std::max(numThreads, 0);
+}
 
-    double* redSpecTotals = new double[ thePolygon->getVertexCount() ];
-    double* greenSpecTotals = new double[ thePolygon->getVertexCount() ];
-    double* blueSpecTotals = new double[ thePolygon->getVertexCount() ];
+// Set the minimum time between presentations of a partially rendered frame. 0 disables partial presentation: Frames are only presented once complete
+void Renderer::setPresentInterval(int milliseconds){
+    presentInterval = std::chrono::milliseconds(milliseconds);
+}
 
-    // Calculate ambient lighting:
-    for (int i = 0; i < thePolygon->getVertexCount(); i++){
-        // Initialize the array values to zero:
-        ambientValues[i] = 0;
+// Present the frame buffer to the drawable, if the present interval has elapsed since the last presentation
+void Renderer::presentIfDue(){
+    if (presentInterval.count() <= 0)
+        return;
 
-        redDiffuseTotals[i] = 0;
-        greenDiffuseTotals[i] = 0;
-        blueDiffuseTotals[i] = 0;
+    if (std::chrono::steady_clock::now() - lastPresentTime >= presentInterval)
+        presentFrame();
+}
 
-        redSpecTotals[i] = 0;
-        greenSpecTotals[i] = 0;
-        blueSpecTotals[i] = 0;
+// Quantize the frame buffer, and present it to the drawable
+void Renderer::presentFrame(){
+    frameBuffer.present(drawable);
 
-        // Calculate the ambient component:
-        if (thePolygon->isAffectedByAmbientLight() ){
-            ambientValues[i] = multiplyColorChannels(thePolygon->vertices[i].color, 1.0, currentScene->ambientRedIntensity, currentScene->ambientGreenIntensity, currentScene->ambientBlueIntensity );
+    lastPresentTime = std::chrono::steady_clock::now();
+}
+
+// Print statistics about the most recently rendered frame to cout
+void Renderer::printFrameStatistics() const{
+    cout << "Geometry:\t" << (wasGeometryRefreshed ? "world space meshes refreshed" : "world space meshes reused") << "\n";
+
+    cout << "Frame arena:\t" << mainShadingState.frameArena.getPeakBytes() / 1024 << "KB peak, " << mainShadingState.frameArena.getAllocationCount() << " allocations, " << mainShadingState.frameArena.getBlockCount() << " block(s) (" << mainShadingState.frameArena.getReservedBytes() / 1024 << "KB reserved)\n";
+
+    cout << "Hi-Z culling:\t" << meshesOccluded << "/" << meshesTested << " meshes, " << polygonsOccluded << "/" << polygonsTested << " polygons";
+    if (polygonsTested > 0)
+        cout << " (" << (100.0 * polygonsOccluded) / polygonsTested << "% of tested polygons)";
+    cout << "\n";
+
+    cout << "Level of detail:\t" << meshesReduced << "/" << worldSpaceMeshes.size() << " meshes reduced, " << activeFaces << "/" << fullDetailFaces << " faces";
+    if (fullDetailFaces > 0)
+        cout << " (" << (100.0 * activeFaces) / fullDetailFaces << "% of full detail)";
+    cout << "\n";
+
+    cout << "Proxy rays:\t" << mainShadingState.proxyMeshTests << "/" << mainShadingState.rayMeshTests << " mesh tests used proxies, " << mainShadingState.rayFaceTests << "/" << mainShadingState.drawnDetailFaceTests << " face tests";
+    if (mainShadingState.drawnDetailFaceTests > 0)
+        cout << " (" << (100.0 * mainShadingState.rayFaceTests) / mainShadingState.drawnDetailFaceTests << "% of drawn detail)";
+    cout << "\n";
+
+    unsigned long long fullDepthBounceRays = mainShadingState.bounceRaysTraced + mainShadingState.bounceRaysSkipped;
+    cout << "Bounce rays:\t" << mainShadingState.bounceRaysTraced << " traced, " << mainShadingState.bounceRaysSkipped << " skipped by the bounce cutoff";
+    if (fullDepthBounceRays > 0)
+        cout << " (" << (100.0 * mainShadingState.bounceRaysSkipped) / fullDepthBounceRays << "% of the rays cast before their paths were cut short)";
+    cout << "\n";
+
+    unsigned long long lightsConsidered = mainShadingState.lightsEvaluated + mainShadingState.lightsCulled;
+    cout << "Light culling:\t" << lightTiles.getTileCount() << " tiles listing " << lightTiles.getListedLightCount() << "/" << (unsigned long long)lightTiles.getTileCount() * cameraSpaceLightList.size() << " lights, " << mainShadingState.lightsCulled << "/" << lightsConsidered << " lights culled at lit points";
+    if (lightsConsidered > 0)
+        cout << " (" << (100.0 * mainShadingState.lightsCulled) / lightsConsidered << "%)";
+    cout << "\n";
+
+    cout << "Clipping:\t" << polygonsDepthClipped << "/" << polygonsClipTested << " polygons clipped to hither/yon, " << polygonsScreenClipped << " clipped to the view window, " << polygonsGuardBandAccepted << " inside the guard band (scissored)\n";
+
+    if (rasterizer == edgeFunctionRasterizer){
+        unsigned int blocksTested = blocksAccepted + blocksRejected + blocksPartial;
+        cout << "Edge rasterizer:\t" << trianglesRasterized << " triangles, " << blocksTested << " blocks: " << blocksAccepted << " accepted, " << blocksRejected << " rejected, " << blocksPartial << " tested per pixel\n";
+    }
+
+    if (rasterizer == rayCastRasterizer)
+        cout << "Ray casting:\t" << primaryRayHits << "/" << primaryRaysCast << " primary rays hit a polygon, shared between " << rayCastThreads << " thread(s)\n";
+
+    cout << "Span kernel:\t" << getSpanKernelLevelName(getSpanKernelLevel()) << ", " << spanGroupsTested << " groups, " << spanPixelsVisible << "/" << spanPixelsTested << " scanline pixels passed the depth test\n";
+
+    cout << "Cluster culling:\t" << meshesOutsideFrustum << "/" << worldSpaceMeshes.size() << " meshes outside the frustum, " << clustersOutsideFrustum << "/" << clustersTested << " clusters outside the frustum, " << clustersBackfacing << "/" << clustersTested << " clusters backfacing\n";
+
+    if (isAntialiased){
+        cout << "Antialiasing:\t" << pixelsRefined << "/" << pixelsConsidered << " pixels refined";
+        if (pixelsConsidered > 0)
+            cout << " (" << (100.0 * pixelsRefined) / pixelsConsidered << "%), " << extraSamples << " extra samples (" << (double)extraSamples / pixelsConsidered << " per pixel)";
+        cout << "\n";
+    }
+}
+
+// Get the frame arena
+const FrameArena& Renderer::getFrameArena() const{
+    return mainShadingState.frameArena;
+}
+
+// Find the screen space bounds of a set of camera space points, and their nearest depth
+// Return: True if the bounds were found, false if there are no points or any of them lie in front of the hither plane (and can't be projected)
+bool Renderer::getProjectedBounds(Vertex* cameraSpacePoints, int numPoints, double* xMin, double* yMin, double* xMax, double* yMax, double* zMin){
+    if (numPoints <= 0)
+        return false;
+
+    *xMin = std::numeric_limits<double>::max();
+    *yMin = *xMin;
+    *zMin = *xMin;
+    *xMax = -*xMin;
+    *yMax = -*xMin;
+
+    for (int i = 0; i < numPoints; i++){
+        double z = cameraSpacePoints[i].z;
+
+        if (z < currentScene->camHither)
+            return false;
+
+        // Apply perspective, then project to screen space (as in drawPolygon(), without rounding):
+        double perspX = cameraSpacePoints[i].x / z;
+        double perspY = cameraSpacePoints[i].y / z;
+
+        double screenX = perspectiveToScreen.arrayVal(0, 0) * perspX + perspectiveToScreen.arrayVal(0, 1) * perspY + perspectiveToScreen.arrayVal(0, 2) * z + perspectiveToScreen.arrayVal(0, 3);
+        double screenY = perspectiveToScreen.arrayVal(1, 0) * perspX + perspectiveToScreen.arrayVal(1, 1) * perspY + perspectiveToScreen.arrayVal(1, 2) * z + perspectiveToScreen.arrayVal(1, 3);
+
+        if (screenX < *xMin)
+            *xMin = screenX;
+        if (screenX > *xMax)
+            *xMax = screenX;
+        if (screenY < *yMin)
+            *yMin = screenY;
+        if (screenY > *yMax)
+            *yMax = screenY;
+        if (z < *zMin)
+            *zMin = z;
+    }
+
+    return true;
+}
+
+// Check whether a set of camera space points is hidden behind what has already been drawn, using the depth buffer's hierarchical depth pyramid
+// Return: True if the screen space bounds of the points are entirely behind the depth buffer, false if they might be visible (or lie in front of the hither plane)
+bool Renderer::isOccluded(Vertex* cameraSpacePoints, int numPoints){
+
+    // We can't project points in front of the hither plane: Assume they're visible
+    double xMin, yMin, xMax, yMax, zMin;
+    if (!getProjectedBounds(cameraSpacePoints, numPoints, &xMin, &yMin, &xMax, &yMax, &zMin))
+        return false;
+
+    // Expand the bounds to cover rounding in the rasterizer, and flip them into the depth buffer's y-down space:
+    int bufferXMin = (int)std::floor(xMin) - 1;
+    int bufferXMax = (int)std::ceil(xMax) + 1;
+    int bufferYMin = yRes - ((int)std::ceil(yMax) + 1);
+    int bufferYMax = yRes - ((int)std::floor(yMin) - 1);
+
+    // Pull the nearest depth forward slightly, so interpolation error can never make a hidden pixel visible
+    float nearestDepth = getScaledZVal(zMin) - 1e-6f;
+
+    return depthBuffer.isRectOccluded(bufferXMin, bufferYMin, bufferXMax, bufferYMax, nearestDepth);
+}
+
+// Get the nearest camera space depth of a mesh's bounding box. Used to sort meshes front to back
+double Renderer::getNearestBoundingBoxDepth(Mesh* theMesh){
+    double nearestDepth = std::numeric_limits<double>::max();
+
+    for (unsigned int i = 0; i < theMesh->boundingBoxFaces.size(); i++){
+        for (int j = 0; j < theMesh->boundingBoxFaces[i].getVertexCount(); j++){
+            Vertex corner = theMesh->boundingBoxFaces[i].vertices[j];
+            corner.transform(&worldToCamera);
+
+            if (corner.z < nearestDepth)
+                nearestDepth = corner.z;
+        }
+    }
+
+    return nearestDepth;
+}
+
+// Check whether a world space mesh's bounding box is hidden behind what has already been drawn
+// Return: True if every face of the bounding box is occluded
+bool Renderer::isBoundingBoxOccluded(Mesh* theMesh){
+    for (unsigned int i = 0; i < theMesh->boundingBoxFaces.size(); i++){
+        Polygon* currentFace = &theMesh->boundingBoxFaces[i];
+
+        // Transform the face's corners into camera space. Released from the frame arena when this scope ends
+        ArenaScope cornerScope(&shading->frameArena);
+        Vertex* cameraSpaceCorners = shading->frameArena.allocateArray<Vertex>(currentFace->getVertexCount());
+        for (int j = 0; j < currentFace->getVertexCount(); j++){
+            cameraSpaceCorners[j] = currentFace->vertices[j];
+            cameraSpaceCorners[j].transform(&worldToCamera);
+        }
+
+        if (!isOccluded(cameraSpaceCorners, currentFace->getVertexCount()))
+            return false;
+    }
+
+    return true;
+}
+
+// Get the clip codes of a set of camera space points
+// Note: The view window and guard band planes pass through the camera, and are tested in homogeneous clip space (eg. x <= xLow * w, where w = z). Each plane bounds a half space, so the tests hold even for points behind the camera
+void Renderer::getClipCodes(Vertex* cameraSpacePoints, int numPoints, unsigned int* anyOutside, unsigned int* allOutside){
+    *anyOutside = 0;
+    *allOutside = numPoints > 0 ? ~0u : 0;
+
+    for (int i = 0; i < numPoints; i++){
+        double x = cameraSpacePoints[i].x;
+        double y = cameraSpacePoints[i].y;
+        double w = cameraSpacePoints[i].z;
+
+        unsigned int codes = 0;
+        if (w < currentScene->camHither)
+            codes |= clipHither;
+        if (w > currentScene->camYon)
+            codes |= clipYon;
+        if (x <= currentScene->xLow * w)
+            codes |= clipLeft;
+        if (x >= currentScene->xHigh * w)
+            codes |= clipRight;
+        if (y <= currentScene->yLow * w)
+            codes |= clipBottom;
+        if (y >= currentScene->yHigh * w)
+            codes |= clipTop;
+        if ((codes & clipWindow) && (x < guardBandXLow * w || x > guardBandXHigh * w || y < guardBandYLow * w || y > guardBandYHigh * w))
+            codes |= clipGuardBand;
+
+        *anyOutside |= codes;
+        *allOutside &= codes;
+    }
+}
+
+// Check whether a set of camera space points lies entirely outside the view frustum
+bool Renderer::isOutsideFrustum(Vertex* cameraSpacePoints, int numPoints){
+    unsigned int anyOutside, allOutside;
+    getClipCodes(cameraSpacePoints, numPoints, &anyOutside, &allOutside);
+
+    return (allOutside & (clipDepth | clipWindow)) != 0;
+}
+
+// Check whether a world space mesh's bounding box lies entirely outside the view frustum
+bool Renderer::isBoundingBoxOutsideFrustum(Mesh* theMesh){
+
+    // Transform the bounding box corners into camera space. Released from the frame arena when this scope ends
+    ArenaScope cornerScope(&shading->frameArena);
+    int numCorners = 0;
+    for (auto &currentFace : theMesh->boundingBoxFaces)
+        numCorners += currentFace.getVertexCount();
+
+    Vertex* cameraSpaceCorners = shading->frameArena.allocateArray<Vertex>(numCorners);
+    int cornerIndex = 0;
+    for (auto &currentFace : theMesh->boundingBoxFaces){
+        for (int i = 0; i < currentFace.getVertexCount(); i++){
+            cameraSpaceCorners[cornerIndex] = currentFace.vertices[i];
+            cameraSpaceCorners[cornerIndex].transform(&worldToCamera);
+            cornerIndex++;
+        }
+    }
+
+    return isOutsideFrustum(cameraSpaceCorners, numCorners);
+}
+
+// Check whether every face of a world space cluster can be culled
+bool Renderer::isClusterCulled(MeshCluster* theCluster, bool isWireframe){
+    clustersTested++;
+
+    // Move the bounding sphere into camera space. Its radius is unchanged, as the camera transformation is rigid
+    Vertex center = theCluster->center;
+    center.transform(&worldToCamera);
+    double radius = theCluster->radius;
+
+    // Frustum cull: The sphere is outside if it's entirely behind any of the frustum's planes. The view window planes pass through the camera, with normals scaled to unit length
+    if (center.z < currentScene->camHither - radius || center.z > currentScene->camYon + radius
+        || (center.x - currentScene->xLow * center.z) < -radius * std::sqrt(1 + currentScene->xLow * currentScene->xLow)
+        || (currentScene->xHigh * center.z - center.x) < -radius * std::sqrt(1 + currentScene->xHigh * currentScene->xHigh)
+        || (center.y - currentScene->yLow * center.z) < -radius * std::sqrt(1 + currentScene->yLow * currentScene->yLow)
+        || (currentScene->yHigh * center.z - center.y) < -radius * std::sqrt(1 + currentScene->yHigh * currentScene->yHigh) ){
+        clustersOutsideFrustum++;
+        return true;
+    }
+
+    // Backface cull: Every face points away from the camera (at the origin) if the direction to any point in the sphere is within 90 degrees of every normal in the cone
+    if (!isWireframe && theCluster->coneCutoff < 1){
+        NormalVector coneAxis = theCluster->coneAxis;
+        coneAxis.transform(&worldToCamera);
+
+        double centerDistance = std::sqrt(center.x * center.x + center.y * center.y + center.z * center.z);
+        if (center.x * coneAxis.xn + center.y * coneAxis.yn + center.z * coneAxis.zn >= theCluster->coneCutoff * centerDistance + radius){
+            clustersBackfacing++;
+            return true;
         }
     }
 
+    return false;
+}
+
+// Choose the level of detail a world space mesh is drawn at, from the projected size of its bounding box
+void Renderer::selectLevelOfDetail(Mesh* theMesh){
+    int numLevels = theMesh->getLodCount();
+    if (numLevels == 1 || theMesh->boundingBoxFaces.empty()){
+        theMesh->activeLod = 0;
+        return;
+    }
+
+    // Transform the bounding box corners into camera space. Released from the frame arena when this scope ends
+    ArenaScope cornerScope(&shading->frameArena);
+    int numCorners = 0;
+    for (auto &currentFace : theMesh->boundingBoxFaces)
+        numCorners += currentFace.getVertexCount();
+
+    Vertex* cameraSpaceCorners = shading->frameArena.allocateArray<Vertex>(numCorners);
+    int cornerIndex = 0;
+    for (auto &currentFace : theMesh->boundingBoxFaces){
+        for (int i = 0; i < currentFace.getVertexCount(); i++){
+            cameraSpaceCorners[cornerIndex] = currentFace.vertices[i];
+            cameraSpaceCorners[cornerIndex].transform(&worldToCamera);
+            cornerIndex++;
+        }
+    }
+
+    // Meshes reaching in front of the hither plane are right in front of the camera: Draw them at full detail
+    double xMin, yMin, xMax, yMax, zMin;
+    if (!getProjectedBounds(cameraSpaceCorners, numCorners, &xMin, &yMin, &xMax, &yMax, &zMin)){
+        theMesh->activeLod = 0;
+        return;
+    }
+    double projectedSize = std::max(xMax - xMin, yMax - yMin);
+
+    // Level n is used below lodThreshold / 2^(n - 1) pixels. Only step to another level once the size is past the threshold by the hysteresis margin
+    int level = std::min(theMesh->activeLod, numLevels - 1);
+    while (level + 1 < numLevels && projectedSize < std::ldexp(currentScene->lodThreshold, -level) * (1 - currentScene->lodHysteresis))
+        level++;
+    while (level > 0 && projectedSize > std::ldexp(currentScene->lodThreshold, -(level - 1)) * (1 + currentScene->lodHysteresis))
+        level--;
+
+    theMesh->activeLod = level;
+}
+
+// Light a Polygon using flat shading
+// Pre-condition: All vertices have a valid normal
+void Renderer::flatShadePolygon(Polygon* thePolygon){
+
+    // Running light totals: Every vertex recieves the same diffuse and specular light
+    Color diffuseTotal, specularTotal;
+
     // Get the center of the polygon face, as a point:
     Vertex faceCenter = thePolygon->getFaceCenter();
 
@@ -562,10 +1137,15 @@ void Renderer::flatShadePolygon(Polygon* thePolygon){
     NormalVector faceNormal = thePolygon->getNormalAverage();
 
     // Loop through each light:
-    for (unsigned int i = 0; i < currentScene->theLights.size(); i++){
+    for (unsigned int i = 0; i < cameraSpaceLights.size(); i++){
 
         // Get the (normalized) light direction vector: Points from the face towards the light
-        NormalVector lightDirection(currentScene->theLights[i].position.x - faceCenter.x, currentScene->theLights[i].position.y - faceCenter.y, currentScene->theLights[i].position.z - faceCenter.z);
+        NormalVector lightDirection(cameraSpaceLights[i].position.x - faceCenter.x, cameraSpaceLights[i].position.y - faceCenter.y, cameraSpaceLights[i].position.z - faceCenter.z);
+
+        // Skip lights too far from the face to visibly affect it:
+        if (lightDirection.length() >= cameraSpaceLightList.influenceRadius[i])
+            continue;
+
         lightDirection.normalize();
 
         // Get the cosine of the angle between the face normal and the light direction
@@ -574,12 +1154,12 @@ void Renderer::flatShadePolygon(Polygon* thePolygon){
         if (faceNormalDotLightDirection > 0){ // Only proceed if the angle < 90 degrees
 
             // Get the attenuation factor of the current light:
-            double attenuationFactor = currentScene->theLights[i].getAttenuationFactor(faceCenter);
+            double attenuationFactor = cameraSpaceLights[i].getAttenuationFactor(faceCenter);
 
             // Mutliply the light intensities by the attenuation:
-            double redDiffuseIntensity = currentScene->theLights[i].redIntensity * attenuationFactor;
-            double greenDiffuseIntensity = currentScene->theLights[i].greenIntensity * attenuationFactor;
-            double blueDiffuseIntensity = currentScene->theLights[i].blueIntensity * attenuationFactor;
+            double redDiffuseIntensity = cameraSpaceLights[i].redIntensity * attenuationFactor;
+            double greenDiffuseIntensity = cameraSpaceLights[i].greenIntensity * attenuationFactor;
+            double blueDiffuseIntensity = cameraSpaceLights[i].blueIntensity * attenuationFactor;
 
             // Factor the cosine value into the light intensity values:
             redDiffuseIntensity *= faceNormalDotLightDirection;
@@ -603,62 +1183,67 @@ void Renderer::flatShadePolygon(Polygon* thePolygon){
             if (viewDotReflection < 0) // Clamp the value to be >=0
                 viewDotReflection = 0;
 
-            viewDotReflection = pow(viewDotReflection, thePolygon->getSpecularExponent() );
+            viewDotReflection = thePolygon->getSpecularPower().evaluate(viewDotReflection);
 
-            redSpecIntensity *= (currentScene->theLights[i].redIntensity * attenuationFactor * viewDotReflection);
-            greenSpecIntensity *= (currentScene->theLights[i].greenIntensity * attenuationFactor * viewDotReflection);
-            blueSpecIntensity *= (currentScene->theLights[i].blueIntensity * attenuationFactor * viewDotReflection);
+            redSpecIntensity *= (cameraSpaceLights[i].redIntensity * attenuationFactor * viewDotReflection);
+            greenSpecIntensity *= (cameraSpaceLights[i].greenIntensity * attenuationFactor * viewDotReflection);
+            blueSpecIntensity *= (cameraSpaceLights[i].blueIntensity * attenuationFactor * viewDotReflection);
 
-            // Loop through each vertex, adding the sum of the light values to the vertex's total light
-            for (int i = 0; i < thePolygon->getVertexCount(); i++){
-
-                redDiffuseTotals[i] += redDiffuseIntensity;
-                greenDiffuseTotals[i] += greenDiffuseIntensity;
-                blueDiffuseTotals[i] += blueDiffuseIntensity;
-
-                redSpecTotals[i] += redSpecIntensity;
-                greenSpecTotals[i] += greenSpecIntensity;
-                blueSpecTotals[i] += blueSpecIntensity;
-
-            } // End polygon vertices loop
+            // Add the light values to the running totals:
+            diffuseTotal += Color( (float)redDiffuseIntensity, (float)greenDiffuseIntensity, (float)blueDiffuseIntensity, 0.0f );
+            specularTotal += Color( (float)redSpecIntensity, (float)greenSpecIntensity, (float)blueSpecIntensity, 0.0f );
 
         } // end if
     } // End light loop
 
+    // Each lighting component saturates at full intensity:
+    Color ambientIntensity( (float)currentScene->ambientRedIntensity, (float)currentScene->ambientGreenIntensity, (float)currentScene->ambientBlueIntensity, 1.0f );
+    ambientIntensity = ambientIntensity.saturate();
+    Color diffuseIntensity = (diffuseTotal + Color(0.0f, 0.0f, 0.0f, 1.0f)).saturate();
+    Color specularColor = (specularTotal + Color(0.0f, 0.0f, 0.0f, 1.0f)).saturate();
+
     // Combine the color values, and assign their sum as the new vertex color:
     for (int i = 0; i < thePolygon->getVertexCount(); i++){
-        thePolygon->vertices[i].color = addColors( ambientValues[i],
-                                                  addColors(
-                                                       multiplyColorChannels(thePolygon->vertices[i].color, 1.0, redDiffuseTotals[i], greenDiffuseTotals[i], blueDiffuseTotals[i]),
-                                                       combineColorChannels( redSpecTotals[i], greenSpecTotals[i], blueSpecTotals[i] )
-                                                       )
-                                                  );
-    }
-
-    // Cleanup:
-    delete [] ambientValues;
+        Color baseColor = Color::fromARGB(thePolygon->vertices[i].color);
 
-    delete [] redDiffuseTotals;
-    delete [] greenDiffuseTotals;
-    delete [] blueDiffuseTotals;
+        Color litColor = (baseColor * diffuseIntensity) + specularColor;
+        if (thePolygon->isAffectedByAmbientLight() )
+            litColor += baseColor * ambientIntensity;
 
-    delete [] redSpecTotals;
-    delete [] greenSpecTotals;
-    delete [] blueSpecTotals;
+        thePolygon->vertices[i].color = litColor.saturate().toARGB();
+    }
 }
 
 // Light a Polygon using gouraud shading
 void Renderer::gouraudShadePolygon(Polygon* thePolygon){
 
-    // Loop through each vertex and calculate lighting for it
-    for (int i = 0; i < thePolygon->getVertexCount(); i++){
+    int numVertices = thePolygon->getVertexCount();
 
-        // Create a view vector: Points from the face towards the camera
-        NormalVector viewVector(-thePolygon->vertices[i].x, -thePolygon->vertices[i].y, -thePolygon->vertices[i].z);
-        viewVector.normalize();
+    // Released from the frame arena when this scope ends
+    ArenaScope shadingScope(&shading->frameArena);
+    NormalVector* viewVectors = shading->frameArena.allocateArray<NormalVector>(numVertices);
+    SurfacePoint* surfacePoints = shading->frameArena.allocateArray<SurfacePoint>(numVertices);
+    Color* litColors = shading->frameArena.allocateArray<Color>(numVertices);
+
+    // Gather the vertices:
+    for (int i = 0; i < numVertices; i++){
 
-        thePolygon->vertices[i].color = lightPointInCameraSpace(&thePolygon->vertices[i], &viewVector, thePolygon->isAffectedByAmbientLight(), thePolygon->getSpecularExponent(), thePolygon->getSpecularCoefficient());
+        // Create a view vector: Points from the face towards the camera
+        viewVectors[i] = NormalVector(-thePolygon->vertices[i].x, -thePolygon->vertices[i].y, -thePolygon->vertices[i].z);
+        viewVectors[i].normalize();
+
+        surfacePoints[i].position = &thePolygon->vertices[i];
+        surfacePoints[i].viewVector = &viewVectors[i];
+        surfacePoints[i].doAmbient = thePolygon->isAffectedByAmbientLight();
+        surfacePoints[i].specularPower = thePolygon->getSpecularPower();
+        surfacePoints[i].specularCoefficient = thePolygon->getSpecularCoefficient();
     }
+
+    // Light all of the vertices together:
+    lightPoints(surfacePoints, numVertices, litColors);
+
+    for (int i = 0; i < numVertices; i++)
+        thePolygon->vertices[i].color = litColors[i].toARGB();
 }
 
 // Draw a polygon in wireframe only
@@ -677,223 +1262,830 @@ void Renderer::drawPolygonWireframe(Polygon* thePolygon){
     }
 }
 
-// Draw a mesh object
+// Draw a mesh object, at its active level of detail. Whole clusters of faces are culled before any of their faces are transformed
 void Renderer::drawMesh(Mesh* theMesh){
-    for (unsigned int i = 0; i < theMesh->faces.size(); i++){
-        currentPolygon = &theMesh->faces[i];    // Track the current polygon, so we can identify it after we've made a copy to pass down the rendering pipeline
-        drawPolygon(theMesh->faces[i], theMesh->isWireframe);
+    vector<Polygon>& meshFaces = theMesh->getActiveFaces();
+    vector<MeshCluster>* meshClusters = theMesh->getActiveClusters();
+    vector<unsigned int>* faceClusters = theMesh->getActiveFaceClusters();
+
+    // Cull the clusters up front. Faces are then drawn in their original order, so culling never changes which of two equally deep faces wins a pixel
+    ArenaScope clusterScope(&shading->frameArena);
+    bool* isCulled = nullptr;
+    if (meshClusters != nullptr && faceClusters != nullptr){
+        isCulled = shading->frameArena.allocateArray<bool>(meshClusters->size());
+        for (unsigned int i = 0; i < meshClusters->size(); i++)
+            isCulled[i] = isClusterCulled(&(*meshClusters)[i], theMesh->isWireframe);
     }
 
-    // Remove the reference to the currentPolygon, for safety
-    currentPolygon = nullptr;
+    for (unsigned int i = 0; i < meshFaces.size(); i++){
+        if (isCulled != nullptr && isCulled[(*faceClusters)[i]])
+            continue;
+
+        shading->currentPolygon = &meshFaces[i];    // Track the current polygon, so we can identify it after we've made a copy to pass down the rendering pipeline
+
+        // Copy the face to camera space in the frame arena. drawPolygon() borrows the copy's vertices, which are released once the face is drawn
+        ArenaScope faceScope(&shading->frameArena);
+        drawPolygon(std::move(*getCameraSpaceCopy(&meshFaces[i])), theMesh->isWireframe);
+    }
+
+    // Remove the reference to the current polygon, for safety
+    shading->currentPolygon = nullptr;
 }
 
 // Render a scene
-void Renderer::renderScene(Scene theScene){
-    // Store a pointer to the current scene (for accessing various render settings)
-    currentScene = &theScene;
+void Renderer::renderScene(const Scene& theScene){
+    renderScene(theScene, theScene);
+}
+
+// Render a scene's meshes, with the lights, camera and other settings of another scene
+void Renderer::renderScene(const Scene& theScene, const Scene& theSettings){
+    // Store a pointer to the current scene settings (for accessing various render settings)
+    currentScene = &theSettings;
+
+    // Shade on the calling thread's state:
+    shading = &mainShadingState;
+
+    // Release last frame's temporaries, and reset the arena statistics:
+    shading->frameArena.reset();
+
+    if (isAntialiased)
+        isLinePixel.assign(xRes * yRes, 0);
 
     // Fill the canvas with the depth fog color:
     drawRectangle(0, 0, xRes - 1, yRes - 1, currentScene->fogColor);
 
     // Transform the render camera (also resets depth buffer):
-    transformCamera(theScene.cameraMovement);
+    transformCamera(theSettings.cameraMovement);
+
+    // Refresh the world space geometry only if the scene's meshes have changed since the last render. Camera and light changes don't touch it
+    wasGeometryRefreshed = theScene.getGeometryVersion() != worldSpaceGeometryVersion;
+    if (wasGeometryRefreshed){
+        worldSpaceMeshes = theScene.theMeshes; // Element-wise assignment reuses the existing storage when the topology hasn't changed
+        worldSpaceGeometryVersion = theScene.getGeometryVersion();
+
+        // Meshes loaded from scene files arrive with their clusters. Any that have since been transformed need them rebuilt
+        for (auto &renderMesh : worldSpaceMeshes){
+            if (renderMesh.clusters.empty())
+                renderMesh.generateClusters();
+        }
+
+        // Find the strongest specular highlight any face can have, which bounds how far the lights reach:
+        maxSpecularCoefficient = 0;
+        for (auto &renderMesh : worldSpaceMeshes){
+            for (auto &currentFace : renderMesh.faces)
+                maxSpecularCoefficient = std::max(maxSpecularCoefficient, currentFace.getSpecularCoefficient());
+            for (auto &currentLevel : renderMesh.lodLevels){
+                for (auto &currentFace : currentLevel)
+                    maxSpecularCoefficient = std::max(maxSpecularCoefficient, currentFace.getSpecularCoefficient());
+            }
+        }
+    }
 
     // Transform lights from world space to camera space:
-    for (auto &currentLight : theScene.theLights){
+    cameraSpaceLights = theSettings.theLights;
+    for (auto &currentLight : cameraSpaceLights){
         currentLight.position.transform(&worldToCamera);
 
     }
+    // A light adds at most its attenuated intensity to a point's diffuse light, and that times the specular coefficient to its specular light:
+    cameraSpaceLightList.build(cameraSpaceLights, theSettings.lightCutoff, 1 + maxSpecularCoefficient);
+    buildLightTiles();
+
+    // Reset the occlusion culling and antialiasing statistics:
+    meshesTested = meshesOccluded = 0;
+    polygonsTested = polygonsOccluded = 0;
+    pixelsConsidered = pixelsRefined = extraSamples = 0;
+    meshesReduced = fullDetailFaces = activeFaces = 0;
+    meshesOutsideFrustum = clustersTested = clustersOutsideFrustum = clustersBackfacing = 0;
+    polygonsClipTested = polygonsDepthClipped = polygonsScreenClipped = polygonsGuardBandAccepted = 0;
+    trianglesRasterized = blocksAccepted = blocksRejected = blocksPartial = 0;
+    spanGroupsTested = spanPixelsTested = spanPixelsVisible = 0;
+    primaryRaysCast = primaryRayHits = rayCastThreads = 0;
+    shading->rayMeshTests = shading->proxyMeshTests = 0;
+    shading->rayFaceTests = shading->drawnDetailFaceTests = 0;
+    shading->bounceRaysTraced = shading->bounceRaysSkipped = 0;
+    shading->lightsEvaluated = shading->lightsCulled = 0;
+
+    // Sort the meshes front to back by their nearest bounding box point, so the nearest occluders are drawn first:
+    meshDrawOrder.clear();
+    meshDepths.clear();
+    for (auto &renderMesh : worldSpaceMeshes){
+        meshDrawOrder.push_back(&renderMesh);
+        meshDepths.push_back(getNearestBoundingBoxDepth(&renderMesh));
+    }
+
+    // Choose each mesh's level of detail before anything is drawn, so rays cast while drawing see the same geometry as the raster:
+    for (auto &renderMesh : worldSpaceMeshes){
+        selectLevelOfDetail(&renderMesh);
 
-    // Transform meshes into camera space:
-    for(auto &processingMesh : theScene.theMeshes){
-        processingMesh.transform(&worldToCamera);
+        fullDetailFaces += (unsigned int)renderMesh.faces.size();
+        activeFaces += (unsigned int)renderMesh.getActiveFaces().size();
+        if (renderMesh.activeLod > 0)
+            meshesReduced++;
     }
+    Mesh* firstMesh = worldSpaceMeshes.data();
+    std::stable_sort(meshDrawOrder.begin(), meshDrawOrder.end(), [this, firstMesh](Mesh* lhs, Mesh* rhs){ return meshDepths[lhs - firstMesh] < meshDepths[rhs - firstMesh]; });
+
+    // Ray cast the filled meshes. Only the wireframe meshes are left to be rasterized, against the ray cast depths:
+    if (rasterizer == rayCastRasterizer)
+        castPrimaryRays();
 
     // Process and draw each mesh in the scene:
-    for (auto &renderMesh : theScene.theMeshes){
-        currentMesh = &renderMesh; // Update the currentMesh pointer to the current mesh being drawn
+    for (auto renderMeshPointer : meshDrawOrder){
+        Mesh& renderMesh = *renderMeshPointer;
+
+        if (rasterizer == rayCastRasterizer && !renderMesh.isWireframe)
+            continue;
+
+        // Frustum cull the entire mesh using its bounding box:
+        if (isBoundingBoxOutsideFrustum(&renderMesh)){
+            meshesOutsideFrustum++;
+            continue;
+        }
+
+        // Occlusion cull the entire mesh using its bounding box:
+        if (!renderMesh.isWireframe && !renderMesh.boundingBoxFaces.empty()){
+            meshesTested++;
+
+            if (isBoundingBoxOccluded(&renderMesh)){
+                meshesOccluded++;
+                continue;
+            }
+        }
+
+        shading->currentMesh = &renderMesh; // Update the current mesh pointer to the mesh being drawn
         drawMesh(&renderMesh);
 
 //        // UNCOMMENT TO VISIBLY DEBUG BOUNDING BOXES:
 //        for (int i = 0; i < renderMesh.boundingBoxFaces.size(); i++){
-//            drawPolygon(renderMesh.boundingBoxFaces[i], true);
+//            Polygon boundingBoxFace(renderMesh.boundingBoxFaces[i]);
+//            boundingBoxFace.transform(&worldToCamera);
+//            drawPolygon(boundingBoxFace, true);
 //        }
     }
 
+    // Refine the edges, now that everything has been drawn:
+    if (isAntialiased)
+        antialiasEdges();
+
+    // Quantize and display the finished frame:
+    presentFrame();
+
     // Remove the pointers to the current scene objects
     currentScene = nullptr;
-    currentMesh = nullptr;
+    shading->currentMesh = nullptr;
+}
+
+// Depth test the pixels of a scanline with the span kernels, storing the depths of the pixels that pass
+// Note: The kernels test whole groups of SPAN_KERNEL_WIDTH pixels, aligned to the depth buffer's tiles so each group's stored depths are contiguous
+int Renderer::depthTestScanline(int xFirst, int xLast, int y, double inverseZ, double inverseZStep, int* visibleX, double* visibleZ){
+    static_assert(SPAN_KERNEL_WIDTH == DepthBuffer::TILE_SIZE, "Span kernel groups must match the depth buffer's tile rows");
+
+    int bufferY = yRes - y; // Flip the Y coordinate
+
+    SpanGroup group;
+    group.inverseZ = inverseZ;
+    group.inverseZStep = inverseZStep;
+    group.depthHither = currentScene->camHither;
+    group.depthRange = (double)(currentScene->camYon - currentScene->camHither);
+
+    double correctZ[SPAN_KERNEL_WIDTH];
+    float scaledDepths[SPAN_KERNEL_WIDTH];
+    int lanes[SPAN_KERNEL_WIDTH];
+    int numVisible = 0;
+
+    for (int groupX = xFirst & ~DepthBuffer::TILE_MASK; groupX <= xLast; groupX += SPAN_KERNEL_WIDTH){
+        group.firstLaneOffset = groupX - xFirst;
+        group.laneMask = getSpanLaneMask(xFirst - groupX, xLast - groupX);
+        spanGroupsTested++;
+
+        float* storedDepths = depthBuffer.getTileRow(groupX, bufferY);
+        unsigned int visibleMask = depthTestSpanGroup(group, storedDepths, correctZ, scaledDepths);
+        if (visibleMask == 0)
+            continue;
+
+        // Store the visible pixels' depths, and compact them for shading:
+        writeSpanGroupDepths(visibleMask, scaledDepths, storedDepths);
+        depthBuffer.markTileWritten(groupX, bufferY);
+
+        int numLanes = compactSpanGroupMask(visibleMask, lanes);
+        for (int i = 0; i < numLanes; i++){
+            visibleX[numVisible + i] = groupX + lanes[i];
+            visibleZ[numVisible + i] = correctZ[ lanes[i] ];
+        }
+        numVisible += numLanes;
+    }
+
+    spanPixelsTested += xLast - xFirst + 1;
+    spanPixelsVisible += numVisible;
+
+    return numVisible;
 }
 
-// Draw a scanline, with consideration to the Z-Buffer
-// Pre-condition: start and end vertices are in left to right order, and have been pre-rounded to integer coordinates
-// Note: LERP's if start->color != end->color. Does NOT update the screen!
-void Renderer::drawScanlineIfVisible(Vertex* start, Vertex* end){
+// Draw a scanline of a triangle, with consideration to the Z-Buffer
+// Note: Each pixel's depth and color are evaluated from the triangle's interpolation planes. Does NOT update the screen!
+void Renderer::drawScanlineIfVisible(double xLeft, double xRight, int y, const AttributePlanes* planes){
+    int xStart = (int)round(xLeft);
+    int xEnd = (int)round(xRight);
 
-    double z = start->z;
-    double z_slope; // Make sure we're setting a valid z-slope value
-    if (end->x - start->x == 0)
-        z_slope = 0;
-    else
-        z_slope = (end->z - start->z)/(double)(end->x - start->x);
+    // Skip the pixels outside of the scissor rectangle:
+    int x_first = std::max(xStart, scissorXMin);
+    int x_last = std::min(xEnd, scissorXMax);
+    if (x_first > x_last)
+        return;
 
-    int x_start = (int)start->x;
-    int x_end = (int)end->x;
-    int y_rounded = (int)start->y;
+    // Stretch the rounded pixels over the exact edge to edge extent of the scanline, so no pixel extrapolates the planes past the triangle's edges
+    double xScale = (xEnd == xStart) ? 0 : (xRight - xLeft) / (double)(xEnd - xStart);
+
+    // Evaluate the planes at the first pixel. Every other pixel is a multiple of a step away
+    double dx = xLeft + (x_first - xStart) * xScale - planes->originX;
+    double dy = y - planes->originY;
+    double inverseZ = planes->inverseZ + planes->inverseZDx * dx + planes->inverseZDy * dy;
+    double inverseZStep = planes->inverseZDx * xScale;
+    Color colorOverZ = planes->colorOverZ + planes->colorOverZDx * (float)dx + planes->colorOverZDy * (float)dy;
+    Color colorOverZStep = planes->colorOverZDx * (float)xScale;
+
+    // Depth test the whole scanline, and gather the visible pixels. Released from the frame arena when this scope ends
+    ArenaScope scanlineScope(&shading->frameArena);
+    int maxPixels = x_last - x_first + 1;
+    int* pixelX = shading->frameArena.allocateArray<int>(maxPixels);
+    double* pixelZ = shading->frameArena.allocateArray<double>(maxPixels);
+    int numVisible = depthTestScanline(x_first, x_last, y, inverseZ, inverseZStep, pixelX, pixelZ);
+
+    // Shade the visible pixels. Their depths have already been stored
+    int bufferY = yRes - y;
+    for (int i = 0; i < numVisible; i++){
+        Color baseColor = planes->isSolidColor ? planes->solidColor : (colorOverZ + colorOverZStep * (float)(pixelX[i] - x_first)) * (float)pixelZ[i];
+
+        if (currentScene->isDepthFogged)
+            baseColor = getDistanceFoggedColor(baseColor, pixelZ[i]);
+
+        frameBuffer.setPixel(pixelX[i], bufferY, baseColor);
+        if (isAntialiased)
+            isLinePixel[bufferY * xRes + pixelX[i]] = isDrawingLine;
+    }
+}
 
-    double ratio = 0;
-    double ratioDiff;
-    if (x_end - x_start == 0)
-        ratioDiff = 0;
-    else
-        ratioDiff = 1/(double)(x_end - x_start);
+// Draw a scanline using per-pixel lighting (ie Phong shading)
+void Renderer::drawPerPxLitScanlineIfVisible(double xLeft, double xRight, int y, const AttributePlanes* planes, bool doAmbient, double specularCoefficient, SpecularPower specularPower){
+    int xStart = (int)round(xLeft);
+    int xEnd = (int)round(xRight);
+
+    // Skip the pixels outside of the scissor rectangle:
+    int x_first = std::max(xStart, scissorXMin);
+    int x_last = std::min(xEnd, scissorXMax);
+    if (x_first > x_last)
+        return;
 
-    // Draw:
-    for (int x = x_start; x <= x_end; x++){
+    // Stretch the rounded pixels over the exact edge to edge extent of the scanline, so no pixel extrapolates the planes past the triangle's edges
+    double xScale = (xEnd == xStart) ? 0 : (xRight - xLeft) / (double)(xEnd - xStart);
+
+    // Evaluate the planes at the first pixel. Every other pixel is a multiple of a step away
+    double dx = xLeft + (x_first - xStart) * xScale - planes->originX;
+    double dy = y - planes->originY;
+    double inverseZ = planes->inverseZ + planes->inverseZDx * dx + planes->inverseZDy * dy;
+    double inverseZStep = planes->inverseZDx * xScale;
+    Color colorOverZ = planes->colorOverZ + planes->colorOverZDx * (float)dx + planes->colorOverZDy * (float)dy;
+    Color colorOverZStep = planes->colorOverZDx * (float)xScale;
+    double normalOverZ[3], normalOverZStep[3];
+    for (int i = 0; i < 3; i++){
+        normalOverZ[i] = planes->normalOverZ[i] + planes->normalOverZDx[i] * dx + planes->normalOverZDy[i] * dy;
+        normalOverZStep[i] = planes->normalOverZDx[i] * xScale;
+    }
 
-        double correctZ = getPerspCorrectLerpValue(start->z, start->z, end->z, end->z, ratio);
+    // Released from the frame arena when this scope ends
+    ArenaScope scanlineScope(&shading->frameArena);
+    int maxPixels = x_last - x_first + 1;
+    Vertex* pixelPositions = shading->frameArena.allocateArray<Vertex>(maxPixels);
+    NormalVector* viewVectors = shading->frameArena.allocateArray<NormalVector>(maxPixels);
+    SurfacePoint* surfacePoints = shading->frameArena.allocateArray<SurfacePoint>(maxPixels);
+    bool* isEndPoint = shading->frameArena.allocateArray<bool>(maxPixels);
+    int* pixelX = shading->frameArena.allocateArray<int>(maxPixels);
+    double* pixelZ = shading->frameArena.allocateArray<double>(maxPixels);
+    Color* litColors = shading->frameArena.allocateArray<Color>(maxPixels);
 
-        if (isVisible(x, y_rounded, correctZ) ){
-            if (currentScene->isDepthFogged)
-                setPixel(x, y_rounded, correctZ, getFogPixelValue(start, end, ratio, correctZ) );
+    // Depth test the whole scanline, and gather the visible pixels. Only these are lit
+    int numVisible = depthTestScanline(x_first, x_last, y, inverseZ, inverseZStep, pixelX, pixelZ);
+
+    for (int i = 0; i < numVisible; i++){
+        int x = pixelX[i];
+        double correctZ = pixelZ[i];
+        double pixelOffset = x - x_first;
+
+        // Calculate the current pixel position, as a vertex in camera space:
+        Vertex* currentPosition = &pixelPositions[i];
+        *currentPosition = Vertex(x, y, correctZ);      // Create a vertex representing the current point on the scanline
+
+        currentPosition->transform(&screenToPerspective); // Transform back to perspective space
+
+        // Correct the perspective transformation: Transform the point back to camera space
+        currentPosition->x *= correctZ;
+        currentPosition->y *= correctZ;
+
+        // Set the perspective correct normal:
+        currentPosition->normal.xn = (normalOverZ[0] + normalOverZStep[0] * pixelOffset) * correctZ;
+        currentPosition->normal.yn = (normalOverZ[1] + normalOverZStep[1] * pixelOffset) * correctZ;
+        currentPosition->normal.zn = (normalOverZ[2] + normalOverZStep[2] * pixelOffset) * correctZ;
+        currentPosition->normal.normalize(); // Normalize
+
+        currentPosition->color = (planes->isSolidColor ? planes->solidColor : (colorOverZ + colorOverZStep * (float)pixelOffset) * (float)correctZ).toARGB(); // Get the (perspective correct) base color
+
+        // Create a view vector: Points from the face towards the camera
+        viewVectors[i] = NormalVector(-currentPosition->x, -currentPosition->y, -currentPosition->z);
+        viewVectors[i].normalize();
+
+        surfacePoints[i].position = currentPosition;
+        surfacePoints[i].viewVector = &viewVectors[i];
+        surfacePoints[i].doAmbient = doAmbient;
+        surfacePoints[i].specularPower = specularPower;
+        surfacePoints[i].specularCoefficient = specularCoefficient;
+
+        isEndPoint[i] = (x == xStart || x == xEnd);
+    }
+
+    // Light the visible pixels together, then set their colors. Their depths have already been stored
+    recursivelyLightPoints(surfacePoints, numVisible, currentScene->numRayBounces, isEndPoint, litColors);
+
+    int bufferY = yRes - y;
+    for (int i = 0; i < numVisible; i++){
+        frameBuffer.setPixel(pixelX[i], bufferY, litColors[i]);
+        if (isAntialiased)
+            isLinePixel[bufferY * xRes + pixelX[i]] = isDrawingLine;
+    }
+}
+
+// Ray trace the lighting of a batch of points on the current polygon, including their reflections
+// Note: isEndPoint marks points that lie at the ends of a scanline, where bounce rays may strike neighbouring faces across a shared edge
+void Renderer::recursivelyLightPoints(SurfacePoint* points, int numPoints, int bounceRays, const bool* isEndPoint, Color* results){
+    // Light the initial points:
+    lightPoints(points, numPoints, results);
+
+    if (bounceRays <= 0 || numPoints <= 0)
+        return;
+
+    // The reflections are scaled by the current polygon's reflectivity. Skip them if they can't change the image:
+    Color reflectivity = getReflectivityRatios(shading->currentPolygon);
+    if (reflectivity.red() <= currentScene->bounceCutoff){
+        shading->bounceRaysSkipped += numPoints;
+        return;
+    }
+
+    // Released from the frame arena when this scope ends
+    ArenaScope bounceScope(&shading->frameArena);
+    Vertex* bounceOrigins = shading->frameArena.allocateArray<Vertex>(numPoints);
+    NormalVector* bounceDirections = shading->frameArena.allocateArray<NormalVector>(numPoints);
+    double* bounceThroughputs = shading->frameArena.allocateArray<double>(numPoints);
+    Color* bounceColors = shading->frameArena.allocateArray<Color>(numPoints);
+
+    // Calculate the bounce directions: Point from the initial points towards the (potential) intersections
+    for (int i = 0; i < numPoints; i++){
+        bounceOrigins[i] = *points[i].position;
+        bounceDirections[i] = reflectOutVector(&(points[i].position->normal), points[i].viewVector);
+        bounceThroughputs[i] = reflectivity.red();
+    }
+
+    traceBounceRays(bounceOrigins, bounceDirections, isEndPoint, bounceThroughputs, numPoints, bounceRays, bounceColors);
+
+    // Add the intial points' colors and their reflective components:
+    for (int i = 0; i < numPoints; i++)
+        results[i] = ( results[i] + bounceColors[i] * reflectivity ).saturate();
+}
+
+// Trace a batch of bounce rays, and their reflections. Each bounce is traced as a batch, from the first bounce to the last, then the batches' colors are combined from the last back to the first
+// Paths end when they miss, hit a face that isn't reflective, run out of bounces, or their throughput falls to the scene's bounce cutoff: Their remaining bounces could change the final pixel by no more than the cutoff, as every color saturates at 1
+// Note: directions are normalized vectors that point from a face towards a potential point of intersection. They are reversed for rays that hit something
+void Renderer::traceBounceRays(Vertex* origins, NormalVector* directions, const bool* isEndPoint, const double* throughputs, int numRays, int numBounces, Color* results){
+
+    // Released from the frame arena when this scope ends
+    ArenaScope bounceScope(&shading->frameArena);
+    BounceBatch* batches = shading->frameArena.allocateArray<BounceBatch>(numBounces);
+
+    // The first batch holds the received rays:
+    batches[0].numRays = numRays;
+    batches[0].origins = origins;
+    batches[0].directions = directions;
+    batches[0].isEndPoint = isEndPoint;
+    batches[0].throughputs = throughputs;
+    batches[0].sourceHits = nullptr;
+    batches[0].colors = results;
+
+    // Trace the batches, from the first bounce to the last:
+    int numBatches = 0;
+    for (int depth = 0; depth < numBounces; depth++){
+        BounceBatch& batch = batches[depth];
+        numBatches++;
+
+        batch.intersections = shading->frameArena.allocateArray<Vertex>(batch.numRays);
+        batch.hitPolys = shading->frameArena.allocateArray<Polygon*>(batch.numRays);
+        batch.hitRays = shading->frameArena.allocateArray<int>(batch.numRays);
+        SurfacePoint* hitPoints = shading->frameArena.allocateArray<SurfacePoint>(batch.numRays);
+        batch.numHits = 0;
+
+        shading->bounceRaysTraced += batch.numRays;
+
+        // Find the intersection points. Rays that fail to hit anything return the scene's background color
+        bool useProxies = depth > 0 && currentScene->proxyRays == proxySecondaryRays;
+        for (int i = 0; i < batch.numRays; i++){
+            batch.hitPolys[i] = findBounceIntersection(&batch.origins[i], &batch.directions[i], batch.isEndPoint[i], &batch.intersections[i], false, useProxies);
+
+            if (batch.hitPolys[i] != nullptr){
+                // Update the intersection with the interpolated normal and color, using a camera space copy of the polygon that was hit:
+                Polygon* cameraSpaceHitPoly = getCameraSpaceCopy(batch.hitPolys[i]);
+                setInterpolatedIntersectionValues(&batch.intersections[i], cameraSpaceHitPoly);
+
+                // Reverse the recieved bounce direction to make it a view vector from the previous point
+                batch.directions[i].reverse();
+
+                hitPoints[batch.numHits].position = &batch.intersections[i];
+                hitPoints[batch.numHits].viewVector = &batch.directions[i];
+                hitPoints[batch.numHits].doAmbient = batch.hitPolys[i]->isAffectedByAmbientLight();
+                hitPoints[batch.numHits].specularPower = batch.hitPolys[i]->getSpecularPower();
+                hitPoints[batch.numHits].specularCoefficient = batch.hitPolys[i]->getSpecularCoefficient();
+                batch.hitRays[batch.numHits] = i;
+                batch.numHits++;
+            }
             else
-                setPixel(x, y_rounded, correctZ, getPerspCorrectLerpColor(start, end, ratio) );
+                batch.colors[i] = Color::fromARGB(currentScene->environmentColor);
         }
 
-        z += z_slope;
-        ratio += ratioDiff;
+        // Light the intersection points together:
+        batch.hitColors = shading->frameArena.allocateArray<Color>(batch.numHits);
+        lightPoints(hitPoints, batch.numHits, batch.hitColors);
+
+        if (depth == numBounces - 1)
+            break;
+
+        // Gather the next batch: The reflections of the hits on reflective faces, unless their paths can no longer change the image
+        BounceBatch& nextBatch = batches[depth + 1];
+        nextBatch.origins = shading->frameArena.allocateArray<Vertex>(batch.numHits);
+        nextBatch.directions = shading->frameArena.allocateArray<NormalVector>(batch.numHits);
+        bool* nextIsEndPoint = shading->frameArena.allocateArray<bool>(batch.numHits);
+        double* nextThroughputs = shading->frameArena.allocateArray<double>(batch.numHits);
+        nextBatch.isEndPoint = nextIsEndPoint;
+        nextBatch.throughputs = nextThroughputs;
+        nextBatch.sourceHits = shading->frameArena.allocateArray<int>(batch.numHits);
+        nextBatch.colors = shading->frameArena.allocateArray<Color>(batch.numHits);
+        nextBatch.numRays = 0;
+
+        for (int i = 0; i < batch.numHits; i++){
+            int ray = batch.hitRays[i];
+            if (batch.hitPolys[ray]->getReflectivity() <= 0)
+                continue;
+
+            double throughput = batch.throughputs[ray] * getReflectivityRatios(batch.hitPolys[ray]).red();
+            if (throughput <= currentScene->bounceCutoff){
+                shading->bounceRaysSkipped++;
+                continue;
+            }
+
+            // Calculate new bounce direction:
+            int nextRay = nextBatch.numRays++;
+            nextBatch.origins[nextRay] = batch.intersections[ray];
+            nextBatch.directions[nextRay] = reflectOutVector(&batch.intersections[ray].normal, &batch.directions[ray]);
+            nextIsEndPoint[nextRay] = false;
+            nextThroughputs[nextRay] = throughput;
+            nextBatch.sourceHits[nextRay] = i;
+        }
+
+        if (nextBatch.numRays == 0)
+            break;
+    }
+
+    // Combine the colors, from the last bounce back to the first: Each hit adds the reflection it recieved, scaled by its face's reflectivity
+    for (int depth = numBatches - 1; depth >= 0; depth--){
+        BounceBatch& batch = batches[depth];
+        for (int i = 0; i < batch.numHits; i++)
+            batch.colors[batch.hitRays[i]] = batch.hitColors[i];
+
+        if (depth == 0)
+            break;
+
+        BounceBatch& sourceBatch = batches[depth - 1];
+        for (int i = 0; i < batch.numRays; i++){
+            int hit = batch.sourceHits[i];
+            sourceBatch.hitColors[hit] = ( sourceBatch.hitColors[hit] + batch.colors[i] * getReflectivityRatios(sourceBatch.hitPolys[sourceBatch.hitRays[hit]]) ).saturate();
+        }
     }
 }
 
-// Draw a scanline using per-pixel lighting (ie Phong shading)
-void Renderer::drawPerPxLitScanlineIfVisible(Vertex* start, Vertex* end, bool doAmbient, double specularCoefficient, double specularExponent){
+// Get the largest difference between the channels of 2 colors
+static float getColorContrast(const Color& lhs, const Color& rhs){
+    return std::max( std::max(std::fabs(lhs.red() - rhs.red()), std::fabs(lhs.green() - rhs.green())), std::fabs(lhs.blue() - rhs.blue()) );
+}
 
-    // Calculate the starting parameters:
-    double zCameraSpace = start->z; // Recieved Z is the correct, camera space Z
-    double z_slope; // Make sure we're setting a valid z-slope value
-    if (end->x - start->x == 0)
-        z_slope = 0;
-    else
-        z_slope = (end->z - start->z)/(double)(end->x - start->x);
+// Refine the pixels on edges, or with high contrast, by averaging them with extra subpixel samples cast through the ray tracing path
+// Pre-condition: The whole frame has been drawn
+void Renderer::antialiasEdges(){
 
-    int x_start = (int)start->x;
-    int x_end = (int)end->x;
+    int xMin, yMin, xMax, yMax;
+    if (!getViewWindowPixels(&xMin, &yMin, &xMax, &yMax))
+        return;
 
-    int y_rounded = (int)start->y;
+    pixelsConsidered = (xMax - xMin + 1) * (yMax - yMin + 1);
 
-    double ratio = 0;
-    double ratioDiff;
-    if (x_end - x_start == 0)
-        ratioDiff = 0;
-    else
-        ratioDiff = 1/(double)(x_end - x_start);
+    // Find the pixels that need refining, before any of them are changed:
+    if (findEdgePixels(xMin, yMin, xMax, yMax) == 0)
+        return;
 
-    // Draw:
-    for (int x = x_start; x <= x_end; x++){
+    // Cast the extra samples, and average them with the original sample at the pixel center:
+    for (int y = yMin; y <= yMax; y++){
+        for (int x = xMin; x <= xMax; x++){
+            if (!isEdgePixel[y * xRes + x])
+                continue;
 
-        double correctZ = getPerspCorrectLerpValue(start->z, start->z, end->z, end->z, ratio); // Calculate the perspective correct Z for the current pixel
+            Color total = frameBuffer.getColor(x, y);
+            for (int i = 0; i < ANTIALIASING_SAMPLE_COUNT; i++)
+                total += traceSubpixelSample(x + ANTIALIASING_SAMPLE_OFFSETS[i][0], (yRes - y) + ANTIALIASING_SAMPLE_OFFSETS[i][1]);
 
-        // Only bother drawing if we know we're in front of the current z-buffer value:
-        if ( isVisible(x, y_rounded, correctZ) ){
+            frameBuffer.setPixel(x, y, total * (1.0f / (ANTIALIASING_SAMPLE_COUNT + 1)));
 
-            // Calculate the current pixel position, as a vertex in camera space:
-            Vertex currentPosition(x, y_rounded, correctZ);        // Create a vertex representing the current point on the scanline
+            pixelsRefined++;
+            extraSamples += ANTIALIASING_SAMPLE_COUNT;
+        }
+        presentIfDue();
+    }
+}
 
-            currentPosition.transform(&screenToPerspective); // Transform back to perspective space
+// Cast a primary ray through the center of each pixel in the view window, and write the lit colors and depths of the hits to the buffers
+// Rows are claimed one at a time by the calling thread and the workers, each shading with its own state. The buffers are only written once every row is done
+void Renderer::castPrimaryRays(){
+    int xMin, yMin, xMax, yMax;
+    if (!getViewWindowPixels(&xMin, &yMin, &xMax, &yMax))
+        return;
 
-            // Correct the perspective transformation: Transform the point back to camera space
-            currentPosition.x *= correctZ;
-            currentPosition.y *= correctZ;
+    int width = xMax - xMin + 1;
+    int height = yMax - yMin + 1;
+
+    // Released from the frame arena when this scope ends
+    ArenaScope rayScope(&shading->frameArena);
+    Color* rayColors = shading->frameArena.allocateArray<Color>(width * height);
+    double* rayDepths = shading->frameArena.allocateArray<double>(width * height); // The camera space z of each hit. 0 marks misses, as hits always lie beyond the hither plane
+
+    // Share the rows between the thread budget, or every available core:
+    rayCastThreads = rayCastThreadBudget > 0 ? rayCastThreadBudget : std::max(std::thread::hardware_concurrency(), 1u);
+    while (workerShadingStates.size() < rayCastThreads - 1)
+        workerShadingStates.emplace_back(new ShadingState());
+    rayCastWorkers.resize(rayCastThreads - 1);
+
+    std::atomic<int> nextRow(0);
+    auto castRows = [&](ShadingState* threadState){
+        shading = threadState;
+
+        for (int row = nextRow++; row < height; row = nextRow++){
+            for (int column = 0; column < width; column++){
+                int pixel = row * width + column;
+                rayDepths[pixel] = 0;
+                rayColors[pixel] = traceSubpixelSample(xMin + column, yRes - (yMin + row), &rayDepths[pixel]); // Flip the Y coordinate
+            }
+        }
+    };
+
+    for (unsigned int i = 0; i < rayCastThreads - 1; i++){
+        ShadingState* workerState = workerShadingStates[i].get();
+        workerState->frameArena.reset();
+        workerState->rayMeshTests = workerState->proxyMeshTests = 0;
+        workerState->rayFaceTests = workerState->drawnDetailFaceTests = 0;
+        workerState->bounceRaysTraced = workerState->bounceRaysSkipped = 0;
+        workerState->lightsEvaluated = workerState->lightsCulled = 0;
+    }
 
-            // Set the perspective correct normal:
-            currentPosition.normal.xn = getPerspCorrectLerpValue(start->normal.xn, start->z, end->normal.xn, end->z, ratio);
-            currentPosition.normal.yn = getPerspCorrectLerpValue(start->normal.yn, start->z, end->normal.yn, end->z, ratio);
-            currentPosition.normal.zn = getPerspCorrectLerpValue(start->normal.zn, start->z, end->normal.zn, end->z, ratio);
-            currentPosition.normal.normalize(); // Normalize
+    // Each worker shades with its own state. The calling thread (passed the index after the last worker) keeps its own
+    ShadingState* callerState = shading;
+    rayCastWorkers.run([&](unsigned int threadIndex){
+        castRows(threadIndex < rayCastThreads - 1 ? workerShadingStates[threadIndex].get() : callerState);
+    });
+
+    // Gather the workers' statistics:
+    for (unsigned int i = 0; i < rayCastThreads - 1; i++){
+        shading->rayMeshTests += workerShadingStates[i]->rayMeshTests;
+        shading->proxyMeshTests += workerShadingStates[i]->proxyMeshTests;
+        shading->rayFaceTests += workerShadingStates[i]->rayFaceTests;
+        shading->drawnDetailFaceTests += workerShadingStates[i]->drawnDetailFaceTests;
+        shading->bounceRaysTraced += workerShadingStates[i]->bounceRaysTraced;
+        shading->bounceRaysSkipped += workerShadingStates[i]->bounceRaysSkipped;
+        shading->lightsEvaluated += workerShadingStates[i]->lightsEvaluated;
+        shading->lightsCulled += workerShadingStates[i]->lightsCulled;
+    }
 
-            currentPosition.color = getPerspCorrectLerpColor(start, end, ratio); // Get the (perspective correct) base color
+    // Write the hits. Misses keep the fog color the canvas was filled with:
+    for (int row = 0; row < height; row++){
+        for (int column = 0; column < width; column++){
+            int pixel = row * width + column;
+            if (rayDepths[pixel] == 0)
+                continue;
 
-            // Create a view vector: Points from the face towards the camera
-            NormalVector viewVector(-currentPosition.x, -currentPosition.y, -currentPosition.z);
-            viewVector.normalize();
+            setPixel(xMin + column, yRes - (yMin + row), rayDepths[pixel], rayColors[pixel]);
+            primaryRayHits++;
+        }
+    }
+    primaryRaysCast = width * height;
+}
+
+// Find the pixels inside the view window, in UI window space
+bool Renderer::getViewWindowPixels(int* xMin, int* yMin, int* xMax, int* yMax){
+    Vertex windowMin(currentScene->xLow, currentScene->yLow, 1);
+    Vertex windowMax(currentScene->xHigh, currentScene->yHigh, 1);
+    windowMin.transform(&perspectiveToScreen);
+    windowMax.transform(&perspectiveToScreen);
 
-            // Calculate the lit pixel value, apply distance fog then set it:
-            currentPosition.color = recursivelyLightPointInCS(&currentPosition, &viewVector, doAmbient, specularExponent, specularCoefficient, currentScene->numRayBounces, x == x_start || x == x_end);
+    *xMin = std::max((int)std::ceil(windowMin.x), 0);
+    *xMax = std::min((int)std::floor(windowMax.x), xRes - 1);
+    *yMin = std::max(yRes - (int)std::floor(windowMax.y), 0); // Flip the Y coordinates
+    *yMax = std::min(yRes - (int)std::ceil(windowMin.y), yRes - 1);
+
+    return *xMin <= *xMax && *yMin <= *yMax;
+}
 
-            // Set the pixel value
-            setPixel(x, y_rounded, correctZ, currentPosition.color);
+// Mark the pixels within a rectangle whose color or depth differs sharply from a neighbour. Both pixels of each sharp difference are marked
+// Pre-condition: The rectangle is in UI window space, and inside the buffers
+int Renderer::findEdgePixels(int xMin, int yMin, int xMax, int yMax){
+    isEdgePixel.assign(xRes * yRes, 0);
+    int numMarked = 0;
+
+    for (int y = yMin; y <= yMax; y++){
+        for (int x = xMin; x <= xMax; x++){
+            Color currentColor = frameBuffer.getColor(x, y);
+            float currentDepth = depthBuffer.getDepth(x, y);
+
+            // Compare against the right and lower neighbours. The left and upper neighbours have already compared themselves against this pixel
+            const int neighbourOffsets[2][2] = { {1, 0}, {0, 1} };
+            for (int i = 0; i < 2; i++){
+                int neighbourX = x + neighbourOffsets[i][0];
+                int neighbourY = y + neighbourOffsets[i][1];
+                if (neighbourX > xMax || neighbourY > yMax)
+                    continue;
+
+                if (getColorContrast(currentColor, frameBuffer.getColor(neighbourX, neighbourY)) > ANTIALIASING_CONTRAST_THRESHOLD
+                    || std::fabs(currentDepth - depthBuffer.getDepth(neighbourX, neighbourY)) > ANTIALIASING_DEPTH_THRESHOLD){
+
+                    for (int index : { y * xRes + x, neighbourY * xRes + neighbourX }){
+                        if (!isEdgePixel[index] && !isLinePixel[index]){ // Lines can't be refined: Rays pass through them
+                            isEdgePixel[index] = 1;
+                            numMarked++;
+                        }
+                    }
+                }
+            }
         }
+    }
+
+    return numMarked;
+}
+
+// Cast a primary ray from the camera through a point in screen space, and light whatever it hits
+Color Renderer::traceSubpixelSample(double screenX, double screenY, double* hitZ){
+
+    // Find the ray direction: Screen space points map back onto the perspective plane, and the camera space point at depth z lies at (x * z, y * z, z)
+    Vertex perspectivePoint(screenX, screenY, 1);
+    perspectivePoint.transform(&screenToPerspective);
 
-        ratio += ratioDiff;
+    NormalVector rayDirection(perspectivePoint.x, perspectivePoint.y, 1);
+    rayDirection.normalize();
+    Vertex cameraPosition(0, 0, 0);
 
-        zCameraSpace += z_slope;
+    // Released from the frame arena when this scope ends
+    ArenaScope sampleScope(&shading->frameArena);
+    Vertex* hitPoint = shading->frameArena.create<Vertex>();
+
+    // Primary rays don't start on a face, so there's nothing to skip:
+    shading->currentPolygon = nullptr;
+    shading->currentMesh = nullptr;
+
+    Polygon* hitPoly = findBounceIntersection(&cameraPosition, &rayDirection, false, hitPoint, true);
+    if (hitPoly == nullptr || hitPoint->z < currentScene->camHither || hitPoint->z > currentScene->camYon)
+        return Color::fromARGB(currentScene->fogColor);
+
+    // Light the sample as if it were drawn with the polygon it hit, so its shadow and bounce rays skip the same faces:
+    shading->currentPolygon = hitPoly;
+    shading->currentMesh = getWorldSpaceMesh(hitPoly);
+
+    // Copy the hit polygon (with its material) to camera space in the sample's arena scope, and clip it the same way drawPolygon does, so its vertices are lit exactly as in the first pass:
+    Polygon* cameraSpaceHitPoly = getCameraSpaceCopy(hitPoly);
+
+    unsigned int anyOutside, allOutside;
+    getClipCodes(cameraSpaceHitPoly->vertices, cameraSpaceHitPoly->getVertexCount(), &anyOutside, &allOutside);
+    if (anyOutside & clipDepth)
+        cameraSpaceHitPoly->clipHitherYon(currentScene->camHither, currentScene->camYon);
+
+    Color result;
+    if (hitPoly->getShadingModel() == phong){
+        setInterpolatedIntersectionValues(hitPoint, cameraSpaceHitPoly);
+
+        NormalVector viewVector = rayDirection;
+        viewVector.reverse();
+
+        SurfacePoint samplePoint;
+        samplePoint.position = hitPoint;
+        samplePoint.viewVector = &viewVector;
+        samplePoint.doAmbient = hitPoly->isAffectedByAmbientLight();
+        samplePoint.specularPower = hitPoly->getSpecularPower();
+        samplePoint.specularCoefficient = hitPoly->getSpecularCoefficient();
+
+        bool isEndPoint = true; // Samples lie near polygon edges, where bounce rays may strike neighbouring faces across a shared edge
+        recursivelyLightPoints(&samplePoint, 1, currentScene->numRayBounces, &isEndPoint, &result);
+    }
+    else{
+        // Flat and gouraud shaded polygons are lit at their vertices, and their colors interpolated:
+        if (hitPoly->getShadingModel() == flat)
+            flatShadePolygon(cameraSpaceHitPoly);
+        else if (hitPoly->getShadingModel() == gouraud)
+            gouraudShadePolygon(cameraSpaceHitPoly);
+
+        setInterpolatedIntersectionValues(hitPoint, cameraSpaceHitPoly);
+
+        result = Color::fromARGB(hitPoint->color);
+        if (currentScene->isDepthFogged)
+            result = getDistanceFoggedColor(result, hitPoint->z);
+    }
+
+    shading->currentPolygon = nullptr;
+    shading->currentMesh = nullptr;
+
+    if (hitZ != nullptr)
+        *hitZ = hitPoint->z;
+
+    return result;
+}
+
+// Find the world space mesh that owns a world space polygon
+Mesh* Renderer::getWorldSpaceMesh(Polygon* worldSpacePolygon){
+    for (auto &worldSpaceMesh : worldSpaceMeshes){
+        vector<Polygon>& meshFaces = worldSpaceMesh.getActiveFaces();
+        if (!meshFaces.empty() && worldSpacePolygon >= meshFaces.data() && worldSpacePolygon < meshFaces.data() + meshFaces.size())
+            return &worldSpaceMesh;
     }
+
+    return nullptr;
 }
 
-// Recursively ray trace a point's lighting. Calls the recursive helper function
-unsigned int Renderer::recursivelyLightPointInCS(Vertex* currentPosition, NormalVector* viewVector, bool doAmbient, double specularExponent, double specularCoefficient, int bounceRays, bool isEndPoint){
-    // Light the initial point:
-    unsigned int initialColor = lightPointInCameraSpace(currentPosition, viewVector, doAmbient, specularExponent, specularCoefficient);
+// Get the faces of a world space mesh that a ray is tested against
+vector<Polygon>& Renderer::getRayFaces(Mesh* worldSpaceMesh, bool useProxy){
+    vector<Polygon>& drawnFaces = worldSpaceMesh->getActiveFaces();
 
-    // Handle ray tracing:
-    if (bounceRays > 0){
-        // Calculate the bounce direction: Points from initial point towards the (potential) intersection
-        NormalVector bounceDirection = reflectOutVector(&(currentPosition->normal), viewVector);
+    shading->rayMeshTests++;
+    shading->drawnDetailFaceTests += drawnFaces.size();
 
-        // Add the intial points' color and its reflective component:
-        return addColors(   initialColor,
-                            multiplyColorChannels(
-                                    recursiveLightHelper(currentPosition, &bounceDirection, doAmbient, specularExponent, specularCoefficient, bounceRays - 1, isEndPoint),
-                                    1.0, currentPolygon->getReflectivity(), currentPolygon->getReflectivity(), currentPolygon->getReflectivity()
-                            )
-                         );
+    // The mesh being drawn always sees its own drawn surface: A coarser copy of it would shadow and reflect the surface itself
+    if (!useProxy || worldSpaceMesh == shading->currentMesh || worldSpaceMesh->lodLevels.empty()){
+        shading->rayFaceTests += drawnFaces.size();
+        return drawnFaces;
     }
-    else
-        return initialColor;
+
+    vector<Polygon>& proxyFaces = worldSpaceMesh->lodLevels.back();
+    shading->proxyMeshTests++;
+    shading->rayFaceTests += proxyFaces.size();
+    return proxyFaces;
 }
 
-// Recursive helper function for ray tracing. Finds a new bounce intersection point, and returns its lighting value
-// Note: inBounceDirection is a normalized vector that points from a face towards a potential point of intersection
-unsigned int Renderer::recursiveLightHelper(Vertex* currentPosition, NormalVector* inBounceDirection, bool doAmbient, double specularExponent, double specularCoefficient, int bounceRays, bool isEndPoint){
+// Find the nearest polygon a bounce ray strikes. The ray is cast against the world space meshes
+// Return: The world space polygon that was hit, or nullptr if the ray hit nothing. Sets closestIntersection to the camera space point of intersection if a polygon was hit
+Polygon* Renderer::findBounceIntersection(Vertex* cameraSpacePosition, NormalVector* cameraSpaceDirection, bool isEndPoint, Vertex* closestIntersection, bool skipWireframeMeshes, bool useProxies){
+
+    // Move the ray into world space:
+    Vertex worldSpacePosition = *cameraSpacePosition;
+    worldSpacePosition.transform(&cameraToWorld);
+    Vertex* currentPosition = &worldSpacePosition;
 
-    // Find an intersection point, if it exists:
-    Vertex* intersectionResult;
-    Polygon* hitPoly;
-    double hitDistance;
+    NormalVector worldSpaceDirection = *cameraSpaceDirection;
+    worldSpaceDirection.transform(&cameraToWorld);
+    NormalVector* bounceDirection = &worldSpaceDirection;
 
-    intersectionResult = new Vertex(); // Allocate a new vertex
+    // Released from the frame arena when this scope ends
+    ArenaScope intersectionScope(&shading->frameArena);
+    Vertex* intersectionResult = shading->frameArena.create<Vertex>();
 
-    hitPoly = nullptr; // Track which polygon, if any, we've hit
-    hitDistance = std::numeric_limits<double>::max();         // Track how for the current nearest hit we've found is from the starting position
-    Vertex closestIntersection;
+    Polygon* hitPoly = nullptr; // Track which polygon, if any, we've hit
+    double hitDistance = std::numeric_limits<double>::max();         // Track how for the current nearest hit we've found is from the starting position
 
     // Loop through all Meshes in the current scene
-    for (auto &currentVisibleMesh : currentScene->theMeshes){
+    for (auto &currentVisibleMesh : worldSpaceMeshes){
+        if (skipWireframeMeshes && currentVisibleMesh.isWireframe)
+            continue;
 
         // Loop through each face of the current mesh's bounding box
         for (int i = 0; i < currentVisibleMesh.boundingBoxFaces.size(); i++){
 
             // Find an intersection point with the bounding box, if it exists:
-            if ( getPolyPlaneIntersectionPoint(currentPosition, inBounceDirection, &currentVisibleMesh.boundingBoxFaces[i].vertices[0], &currentVisibleMesh.boundingBoxFaces[i].faceNormal, intersectionResult ) ){
+            if ( getPolyPlaneIntersectionPoint(currentPosition, bounceDirection, &currentVisibleMesh.boundingBoxFaces[i].vertices[0], &currentVisibleMesh.boundingBoxFaces[i].faceNormal, intersectionResult ) ){
 
                 // Ensure the intersection point hit the bounding box
-                if ( pointIsInsidePoly( &currentVisibleMesh.boundingBoxFaces[i], intersectionResult ) || currentMesh == &currentVisibleMesh ){
+                if ( pointIsInsidePoly( &currentVisibleMesh.boundingBoxFaces[i], intersectionResult ) || shading->currentMesh == &currentVisibleMesh ){
 
                     // We have a bounding box intersection hit! Loop through each visible face in the current mesh and find an actual intersection point:
-                    for (int j = 0; j < currentVisibleMesh.faces.size(); j++){
+                    vector<Polygon>& meshFaces = getRayFaces(&currentVisibleMesh, useProxies);
+                    for (int j = 0; j < meshFaces.size(); j++){
 
                         // Skip the current polygon (as it always has an intersection)
-                        if ( &currentVisibleMesh.faces[j] == currentPolygon )
+                        if ( &meshFaces[j] == shading->currentPolygon )
                             continue;
 
                         // Find an actual intersection point, if it exists:
-                        if ( getPolyPlaneFrontFaceIntersectionPoint(currentPosition, inBounceDirection, &currentVisibleMesh.faces[j].vertices[0], &currentVisibleMesh.faces[j].faceNormal, intersectionResult ) ){
+                        if ( getPolyPlaneFrontFaceIntersectionPoint(currentPosition, bounceDirection, &meshFaces[j].vertices[0], &meshFaces[j].faceNormal, intersectionResult ) ){
 
                             // Check if the intersection point is inside of the polygon
-                            if( pointIsInsidePoly( &currentVisibleMesh.faces[j], intersectionResult ) // We've found an intersection!
+                            if( pointIsInsidePoly( &meshFaces[j], intersectionResult ) // We've found an intersection!
                                     // Ensure the intersection is not a self intersection, or intersecting a shared edge: Prevents ray bounces striking shared convex edges at sides of polygons
-                                    && (currentMesh !=  &currentVisibleMesh   || !isEndPoint || !haveSharedEdge(currentPolygon, &currentVisibleMesh.faces[j]) || !isFaceReflexAngle(currentPolygon, &currentVisibleMesh.faces[j]) )
+                                    && (shading->currentMesh !=  &currentVisibleMesh   || !isEndPoint || !haveSharedEdge(shading->currentPolygon, &meshFaces[j]) || !isFaceReflexAngle(shading->currentPolygon, &meshFaces[j]) )
                               )
                             {
                                 // Make sure the intersection is nearest, and keep it if it is
@@ -901,8 +2093,8 @@ unsigned int Renderer::recursiveLightHelper(Vertex* currentPosition, NormalVecto
 
                                 if (currentHitDistance < hitDistance){ // Store the new closest hit
                                     hitDistance = currentHitDistance;
-                                    hitPoly = &currentVisibleMesh.faces[j];
-                                    closestIntersection = *intersectionResult;
+                                    hitPoly = &meshFaces[j];
+                                    *closestIntersection = *intersectionResult;
                                 }
                             }
                         }
@@ -915,135 +2107,213 @@ unsigned int Renderer::recursiveLightHelper(Vertex* currentPosition, NormalVecto
         }
     } // End looping through all meshes
 
-    // Cleanup:
-    delete intersectionResult;
-
-    // If we've found bounced light intersection points, calculate their contribution and add it to the final color:
-    if (hitPoly != nullptr){
-
-        // Update the closestIntersection with the interpolated normal and color:
-        setInterpolatedIntersectionValues(&closestIntersection, hitPoly);
+    // Move the intersection back into camera space, for lighting:
+    if (hitPoly != nullptr)
+        closestIntersection->transform(&worldToCamera);
 
-        // Reverse the recieved bounce direction to make it a view vector from the previous point
-        inBounceDirection->reverse();
-
-        // Light the intersection point:
-        closestIntersection.color = lightPointInCameraSpace(&closestIntersection, inBounceDirection, hitPoly->isAffectedByAmbientLight(), hitPoly->getSpecularExponent(), hitPoly->getSpecularCoefficient());
+    return hitPoly;
+}
 
-        // Make a recursive call
-        if (bounceRays > 0 && hitPoly->getReflectivity() > 0){
+// List the lights whose influence spheres reach each screen tile's frustum in lightTiles
+void Renderer::buildLightTiles(){
+    int columns = (xRes + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    int rows = (yRes + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+    lightTiles.reset(columns, rows);
+
+    for (int row = 0; row < rows; row++){
+        for (int column = 0; column < columns; column++){
+
+            // Find the tile's bounds in perspective space. They're padded by half a pixel, so points that project onto a tile's edges are always inside its frustum
+            Vertex tileMin(column * LIGHT_TILE_SIZE - 0.5, row * LIGHT_TILE_SIZE - 0.5, 0);
+            Vertex tileMax((column + 1) * LIGHT_TILE_SIZE + 0.5, (row + 1) * LIGHT_TILE_SIZE + 0.5, 0);
+            tileMin.transform(&screenToPerspective);
+            tileMax.transform(&screenToPerspective);
+
+            double xLow = std::min(tileMin.x, tileMax.x);
+            double xHigh = std::max(tileMin.x, tileMax.x);
+            double yLow = std::min(tileMin.y, tileMax.y);
+            double yHigh = std::max(tileMin.y, tileMax.y);
+
+            for (unsigned int i = 0; i < cameraSpaceLightList.size(); i++){
+                double x = cameraSpaceLightList.positionX[i];
+                double y = cameraSpaceLightList.positionY[i];
+                double z = cameraSpaceLightList.positionZ[i];
+                double radius = cameraSpaceLightList.influenceRadius[i];
+
+                // The tile's frustum is bounded by 4 planes through the camera, as in isClusterCulled(). The light can't reach it if its influence sphere is entirely behind any of them
+                if (   (x - xLow * z) < -radius * std::sqrt(1 + xLow * xLow)
+                    || (xHigh * z - x) < -radius * std::sqrt(1 + xHigh * xHigh)
+                    || (y - yLow * z) < -radius * std::sqrt(1 + yLow * yLow)
+                    || (yHigh * z - y) < -radius * std::sqrt(1 + yHigh * yHigh) )
+                    continue;
+
+                lightTiles.addLight(i);
+            }
+            lightTiles.finishTile();
+        }
+    }
+}
 
-            // Calculate new bounce direction:
-            NormalVector nextBounceDirection = reflectOutVector(&closestIntersection.normal, inBounceDirection);
+// Get the light tile a camera space point projects into
+int Renderer::getLightTile(const Vertex& cameraSpacePoint){
+    if (cameraSpacePoint.z <= 0)
+        return -1;
 
-            return addColors(  closestIntersection.color,
-                                   multiplyColorChannels(   recursiveLightHelper(&closestIntersection, &nextBounceDirection, doAmbient, specularExponent, specularCoefficient, bounceRays - 1, false),
-                                                            1.0, hitPoly->getReflectivity(), hitPoly->getReflectivity(), hitPoly->getReflectivity() )
-                             );
+    // Apply perspective, then project to screen space (as in getProjectedBounds()):
+    double perspX = cameraSpacePoint.x / cameraSpacePoint.z;
+    double perspY = cameraSpacePoint.y / cameraSpacePoint.z;
 
-        }
-        // No more recursive calls to make: Return the intersection color
-        else
-            return closestIntersection.color;
+    double screenX = perspectiveToScreen.arrayVal(0, 0) * perspX + perspectiveToScreen.arrayVal(0, 1) * perspY + perspectiveToScreen.arrayVal(0, 3);
+    double screenY = perspectiveToScreen.arrayVal(1, 0) * perspX + perspectiveToScreen.arrayVal(1, 1) * perspY + perspectiveToScreen.arrayVal(1, 3);
 
-    } // End hitPoly check
+    if (!(screenX >= 0 && screenX < xRes && screenY >= 0 && screenY < yRes))
+        return -1;
 
-    // We failed to hit anything: Return the scene's background color
-    return currentScene->environmentColor;
+    return ((int)screenY / LIGHT_TILE_SIZE) * lightTiles.columns + ((int)screenX / LIGHT_TILE_SIZE);
 }
 
 // Light a given point in camera space
 // Precondition: viewVector is normalized
-unsigned int Renderer::lightPointInCameraSpace(Vertex* currentPosition, NormalVector* viewVector, bool doAmbient, double specularExponent, double specularCoefficient) {
+Color Renderer::lightPointInCameraSpace(Vertex* currentPosition, NormalVector* viewVector, bool doAmbient, double specularExponent, double specularCoefficient) {
+    SurfacePoint thePoint;
+    thePoint.position = currentPosition;
+    thePoint.viewVector = viewVector;
+    thePoint.doAmbient = doAmbient;
+    thePoint.specularPower = SpecularPower(specularExponent);
+    thePoint.specularCoefficient = specularCoefficient;
+
+    Color litColor;
+    lightPoints(&thePoint, 1, &litColor);
+
+    return litColor;
+}
 
-    // Running light totals:
-    unsigned int ambientValue = 0;
-    double redTotalDiffuseIntensity, greenTotalDiffuseIntensity, blueTotalDiffuseIntensity, redTotalSpecIntensity, greenTotalSpecIntensity, blueTotalSpecIntensity;
-    redTotalDiffuseIntensity = greenTotalDiffuseIntensity = blueTotalDiffuseIntensity = redTotalSpecIntensity = greenTotalSpecIntensity = blueTotalSpecIntensity = 0;
+// Light a batch of points in camera space. The light geometry for each light is computed for every point at once by the lighting kernel
+// Only the lights listed by the tiles the points project into are evaluated, and each of them only at the points inside its influence radius
+// Precondition: All view vectors are normalized
+void Renderer::lightPoints(SurfacePoint* points, int numPoints, Color* results){
+    if (numPoints <= 0)
+        return;
 
-    // Calculate the ambient component:
-    if ( doAmbient ){
-        ambientValue = multiplyColorChannels(currentPosition->color, 1.0, currentScene->ambientRedIntensity, currentScene->ambientGreenIntensity, currentScene->ambientBlueIntensity );
+    // Released from the frame arena when this scope ends
+    ArenaScope lightingScope(&shading->frameArena);
+
+    // Gather the points into structure of arrays form. Padding is filled by repeating the last point, so the kernel never reads uninitialized values
+    int paddedCount = ((numPoints + LIGHTING_BATCH_WIDTH - 1) / LIGHTING_BATCH_WIDTH) * LIGHTING_BATCH_WIDTH;
+
+    SurfacePointBatch batch;
+    batch.count = numPoints;
+    double** batchArrays[] = { &batch.positionX, &batch.positionY, &batch.positionZ, &batch.normalX, &batch.normalY, &batch.normalZ, &batch.viewX, &batch.viewY, &batch.viewZ };
+    for (double** currentArray : batchArrays)
+        *currentArray = shading->frameArena.allocateArray<double>(paddedCount);
+
+    for (int i = 0; i < paddedCount; i++){
+        SurfacePoint* currentPoint = &points[i < numPoints ? i : numPoints - 1];
+        batch.positionX[i] = currentPoint->position->x;
+        batch.positionY[i] = currentPoint->position->y;
+        batch.positionZ[i] = currentPoint->position->z;
+        batch.normalX[i] = currentPoint->position->normal.xn;
+        batch.normalY[i] = currentPoint->position->normal.yn;
+        batch.normalZ[i] = currentPoint->position->normal.zn;
+        batch.viewX[i] = currentPoint->viewVector->xn;
+        batch.viewY[i] = currentPoint->viewVector->yn;
+        batch.viewZ[i] = currentPoint->viewVector->zn;
     }
 
-    // Loop through each light in the scene:
-    for (unsigned int i = 0; i < currentScene->theLights.size(); i++){
-
-        // Get the (normalized) light direction vector: Points from the face towards the light
-        NormalVector lightDirection(currentScene->theLights[i].position.x - currentPosition->x, currentScene->theLights[i].position.y - currentPosition->y, currentScene->theLights[i].position.z - currentPosition->z);
-        lightDirection.normalize();
-
-        // Get the cosine of the angle between the face normal and the light direction
-        double currentNormalDotLightDirection = currentPosition->normal.dotProduct(lightDirection);
+    LightGeometryBatch geometry;
+    double** geometryArrays[] = { &geometry.directionX, &geometry.directionY, &geometry.directionZ, &geometry.distance, &geometry.normalDotLight, &geometry.viewDotReflection, &geometry.attenuation };
+    for (double** currentArray : geometryArrays)
+        *currentArray = shading->frameArena.allocateArray<double>(paddedCount);
 
-        // Ensure the light is within 90 degrees about the surface normal, and is not shaded by any other polygons in the scene:
-        if (currentNormalDotLightDirection > 0) {
+    // Running light totals:
+    Color* diffuseTotals = shading->frameArena.allocateArray<Color>(numPoints);
+    Color* specularTotals = shading->frameArena.allocateArray<Color>(numPoints);
+
+    // Find the lights that can reach the batch: Those listed by any of the tiles its points project into. Neighbouring points usually share a tile
+    unsigned int numLights = cameraSpaceLightList.size();
+    bool* isLightListed = shading->frameArena.allocateArray<bool>(numLights);
+    std::fill(isLightListed, isLightListed + numLights, false);
+
+    int previousTile = -2;
+    for (int i = 0; i < numPoints; i++){
+        int currentTile = getLightTile(*points[i].position);
+        if (currentTile == previousTile)
+            continue;
+        previousTile = currentTile;
+
+        // Points off the screen aren't covered by a tile. Any light might reach them:
+        if (currentTile < 0){
+            std::fill(isLightListed, isLightListed + numLights, true);
+            break;
+        }
 
-            double lightDistance = NormalVector(currentScene->theLights[i].position.x - currentPosition->x, currentScene->theLights[i].position.y - currentPosition->y, currentScene->theLights[i].position.z - currentPosition->z).length();
+        for (unsigned int j = lightTiles.tileStarts[currentTile]; j < lightTiles.tileStarts[currentTile + 1]; j++)
+            isLightListed[lightTiles.lights[j]] = true;
+    }
 
-            // Calculate light value if scene or current point is unshadowed
-            if (currentScene->noRayShadows || !isShadowed(*currentPosition, &lightDirection, lightDistance) ){
+    // Loop through each light that can reach the batch:
+    for (unsigned int i = 0; i < numLights; i++){
+        if (!isLightListed[i]){
+            shading->lightsCulled += numPoints;
+            continue;
+        }
 
-                double attenuationFactor = currentScene->theLights[i].getAttenuationFactor(lightDistance);
+        computeLightGeometry(cameraSpaceLightList, i, batch, &geometry);
 
-                // Mutliply the light intensities by the attenuation:
-                double redDiffuseIntensity = currentScene->theLights[i].redIntensity * attenuationFactor;
-                double greenDiffuseIntensity = currentScene->theLights[i].greenIntensity * attenuationFactor;
-                double blueDiffuseIntensity = currentScene->theLights[i].blueIntensity * attenuationFactor;
+        Color lightColor( (float)cameraSpaceLightList.redIntensity[i], (float)cameraSpaceLightList.greenIntensity[i], (float)cameraSpaceLightList.blueIntensity[i], 0.0f );
+        double influenceRadius = cameraSpaceLightList.influenceRadius[i];
 
-                // Factor the cosine value into the light intensity values:
-                redDiffuseIntensity *= currentNormalDotLightDirection;
-                greenDiffuseIntensity *= currentNormalDotLightDirection;
-                blueDiffuseIntensity *= currentNormalDotLightDirection;
+        for (int j = 0; j < numPoints; j++){
 
-                // Add the diffuse intensity for the current light to the running totals
-                redTotalDiffuseIntensity += redDiffuseIntensity;
-                greenTotalDiffuseIntensity += greenDiffuseIntensity;
-                blueTotalDiffuseIntensity += blueDiffuseIntensity;
+            // Skip points the light is too far from to visibly affect:
+            if (geometry.distance[j] >= influenceRadius){
+                shading->lightsCulled++;
+                continue;
+            }
+            shading->lightsEvaluated++;
 
-                // Calculate the reflection vector:
-                NormalVector reflectionVector = reflectOutVector(&(currentPosition->normal), &lightDirection);
+            // Ensure the light is within 90 degrees about the surface normal, and is not shaded by any other polygons in the scene:
+            if (geometry.normalDotLight[j] > 0){
 
-                // Calculate the cosine of the angle between the view vector and the reflection vector:
-                double viewDotReflection = viewVector->dotProduct(reflectionVector);
+                NormalVector lightDirection(geometry.directionX[j], geometry.directionY[j], geometry.directionZ[j]);
 
-                if (viewDotReflection > 0){
+                // Calculate light value if scene or current point is unshadowed
+                if (currentScene->noRayShadows || !isShadowed(*points[j].position, &lightDirection, geometry.distance[j]) ){
 
-                    // Calculate the spec component:
-                    double redSpecIntensity = specularCoefficient;
-                    double greenSpecIntensity = specularCoefficient;
-                    double blueSpecIntensity = specularCoefficient;
+                    // Add the diffuse intensity for the current light, attenuated and factored by the cosine value, to the running totals:
+                    diffuseTotals[j] += lightColor * (float)(geometry.attenuation[j] * geometry.normalDotLight[j]);
 
-                    viewDotReflection = pow(viewDotReflection, specularExponent );
+                    // Calculate the spec component, and add it to the running totals:
+                    if (geometry.viewDotReflection[j] > 0)
+                        specularTotals[j] += lightColor * (float)(points[j].specularCoefficient * geometry.attenuation[j] * points[j].specularPower.evaluate(geometry.viewDotReflection[j]));
 
-                    redSpecIntensity *= (currentScene->theLights[i].redIntensity * attenuationFactor * viewDotReflection);
-                    greenSpecIntensity *= (currentScene->theLights[i].greenIntensity * attenuationFactor * viewDotReflection);
-                    blueSpecIntensity *= (currentScene->theLights[i].blueIntensity * attenuationFactor * viewDotReflection);
+                } // End ifShadowed check
+            } // end if surface normal check
+        }
+    } // End lights loop
 
-                    // Add the final diffuse/spec values to the running totals:
-                    redTotalSpecIntensity += redSpecIntensity;
-                    greenTotalSpecIntensity += greenSpecIntensity;
-                    blueTotalSpecIntensity += blueSpecIntensity;
-                }
+    Color ambientIntensity = Color( (float)currentScene->ambientRedIntensity, (float)currentScene->ambientGreenIntensity, (float)currentScene->ambientBlueIntensity, 1.0f ).saturate();
+    bool isFogged = currentScene->isDepthFogged && shading->currentPolygon->getShadingModel() == phong;
 
-            } // End ifShadowed check
-        } // end if surface normal check
-    } // End lights loop
+    for (int i = 0; i < numPoints; i++){
+        Color baseColor = Color::fromARGB(points[i].position->color);
 
-    if (currentScene->isDepthFogged && currentPolygon->getShadingModel() == phong){
-        return getDistanceFoggedColor( addColors(     ambientValue,
-                                                  addColors(
-                                                      multiplyColorChannels( currentPosition->color, 1.0, redTotalDiffuseIntensity, greenTotalDiffuseIntensity, blueTotalDiffuseIntensity ),
-                                                      combineColorChannels( redTotalSpecIntensity, greenTotalSpecIntensity, blueTotalSpecIntensity ) )
-                                                  ),
-                                   currentPosition->z);
+        // Calculate the ambient component:
+        Color ambientValue;
+        if (points[i].doAmbient)
+            ambientValue = baseColor * ambientIntensity;
+
+        // Combine the components. Each light total saturates at full intensity, as does the final sum
+        Color litColor = ( ambientValue
+                           + baseColor * (diffuseTotals[i] + Color(0.0f, 0.0f, 0.0f, 1.0f)).saturate()
+                           + (specularTotals[i] + Color(0.0f, 0.0f, 0.0f, 1.0f)).saturate()
+                         ).saturate();
+
+        if (isFogged)
+            results[i] = getDistanceFoggedColor(litColor, points[i].position->z);
+        else
+            results[i] = litColor;
     }
-    else
-        return addColors(     ambientValue,
-                              addColors(
-                                  multiplyColorChannels( currentPosition->color, 1.0, redTotalDiffuseIntensity, greenTotalDiffuseIntensity, blueTotalDiffuseIntensity ),
-                                  combineColorChannels( redTotalSpecIntensity, greenTotalSpecIntensity, blueTotalSpecIntensity ) )
-                        );
 }
 
 // Determine whether a current position is shadowed by some polygon in the scene that lies between it and a light
@@ -1053,11 +2323,20 @@ bool Renderer::isShadowed(Vertex currentPosition, NormalVector* lightDirection,
     // Shift the current position slightly along its normal, to avoid self-intersections
     currentPosition += (currentPosition.normal * 0.1);
 
+    // Move the shadow ray into world space. Distances are unchanged, as the camera transformation is rigid
+    currentPosition.transform(&cameraToWorld);
+
+    NormalVector worldSpaceLightDirection = *lightDirection;
+    worldSpaceLightDirection.transform(&cameraToWorld);
+    lightDirection = &worldSpaceLightDirection;
+
     // Allocate a vertex to hold any intersection results we find:
-    Vertex* intersectionResult = new Vertex(); // Modified if getPolyPlaneIntersectionPoint() finds a point of intersection
+    // Released from the frame arena when this scope ends
+    ArenaScope shadowScope(&shading->frameArena);
+    Vertex* intersectionResult = shading->frameArena.create<Vertex>(); // Modified if getPolyPlaneIntersectionPoint() finds a point of intersection
 
     // Loop through all Meshes in the current scene
-    for (auto &currentVisibleMesh : currentScene->theMeshes){
+    for (auto &currentVisibleMesh : worldSpaceMeshes){
 
         // Loop through each face of the current mesh's bounding box
         for (int i = 0; i < currentVisibleMesh.boundingBoxFaces.size(); i++){
@@ -1072,26 +2351,24 @@ bool Renderer::isShadowed(Vertex currentPosition, NormalVector* lightDirection,
                  && ( pointIsInsidePoly( &currentVisibleMesh.boundingBoxFaces[i], intersectionResult ) )
                 ) {
                         // We have a bounding box intersection hit! Loop through each visible face in the current mesh and find an actual intersection point:
-                        for (int j = 0; j < currentVisibleMesh.faces.size(); j++){
+                        vector<Polygon>& meshFaces = getRayFaces(&currentVisibleMesh, currentScene->proxyRays != noProxyRays);
+                        for (int j = 0; j < meshFaces.size(); j++){
 
                             // Skip the current polygon (as it always has an intersection)
-                            if ( &currentVisibleMesh.faces[j] == currentPolygon )
+                            if ( &meshFaces[j] == shading->currentPolygon )
                                 continue;
 
                                 // Find an actual intersection point, if it exists:
-                            if ( ( getPolyPlaneBackFaceIntersectionPoint(&currentPosition, lightDirection, &currentVisibleMesh.faces[j].vertices[0], &currentVisibleMesh.faces[j].faceNormal, intersectionResult ) )
+                            if ( ( getPolyPlaneBackFaceIntersectionPoint(&currentPosition, lightDirection, &meshFaces[j].vertices[0], &meshFaces[j].faceNormal, intersectionResult ) )
 
                                 // Ensure the intersection is between the currentPosition and the light:
                                 && ( (*intersectionResult - currentPosition).length() < lightDistance )
 
                                    // Check if the intersection point is inside of the polygon
-                                && ( pointIsInsidePoly( &currentVisibleMesh.faces[j], intersectionResult ) )
+                                && ( pointIsInsidePoly( &meshFaces[j], intersectionResult ) )
 
                                  ){ // We've found an intersection!
 
-                                    // Cleanup:
-                                    delete intersectionResult;
-
                                     return true;
 
                             } // End current face checking ifs
@@ -1104,9 +2381,6 @@ bool Renderer::isShadowed(Vertex currentPosition, NormalVector* lightDirection,
         } // End bounding box face loop
     } // End mesh loop
 
-    // Cleanup:
-    delete intersectionResult;
-
     return false;
 }
 
@@ -1207,7 +2481,7 @@ bool Renderer::pointIsInsidePoly(Polygon* thePolygon, Vertex* intersectionPoint)
 // Calculate value of blending an existing pixel with a color, based on an opacity ratio
 // Written color = opacity * color + (1 - opacity) * color at (x, y)
 unsigned int Renderer::blendPixelValues(int x, int y, unsigned int color, float opacity){
-    unsigned int currentColor = drawable->getPixel(x, y); // Sample the existing color
+    unsigned int currentColor = frameBuffer.getPixel(x, y); // Sample the existing color
 
     // Return the blended sum
     return addColors (multiplyColorChannels(color, opacity), multiplyColorChannels(currentColor, (1 - opacity) ) ); // Calculate the blended colors
@@ -1216,24 +2490,24 @@ unsigned int Renderer::blendPixelValues(int x, int y, unsigned int color, float
 // Override: Lerp between the color values of 2 points (Perspective correct: Takes Z-Depth into account)
 // Pre-condition: Recieved points are ordered left to right
 // Return: An unsigned int color value, calculated based on a LERP of the current position between the 2 points
-unsigned int Renderer::getPerspCorrectLerpColor(Vertex* p1, Vertex* p2, double ratio) const {
+Color Renderer::getPerspCorrectLerpColor(Vertex* p1, Vertex* p2, double ratio) const {
     // Handle solidly colored objects:
     if (p1->color == p2->color || ratio <= 0)
-        return p1->color;
+        return Color::fromARGB(p1->color);
 
     if (ratio >= 1)
-        return p2->color;
+        return Color::fromARGB(p2->color);
 
-    double red = getPerspCorrectLerpValue(extractColorChannel(p1->color, 1), p1->z, extractColorChannel(p2->color, 1), p2->z, ratio);
-    double green = getPerspCorrectLerpValue(extractColorChannel(p1->color, 2), p1->z, extractColorChannel(p2->color, 2), p2->z, ratio);
-    double blue = getPerspCorrectLerpValue(extractColorChannel(p1->color, 3), p1->z, extractColorChannel(p2->color, 3), p2->z, ratio);
+    // The perspective correct lerp is a weighted sum of the end points: Calculate the weights once, and apply them to all channels together
+    double oneMinusRatio = 1 - ratio;
+    double denominator = (ratio * p1->z) + (oneMinusRatio * p2->z);
 
-    return combineColorChannels(red, green, blue);
+    return Color::fromARGB(p1->color).blend( (float)((oneMinusRatio * p2->z) / denominator), Color::fromARGB(p2->color), (float)((ratio * p1->z) / denominator) );
 }
 
 // Calculate fogged pixel value for a given pixel on a line between 2 points
 // Pre-condition: Ambient lighting has already been applied to the vertex color values. All points/coords are in screen space
-unsigned int Renderer::getFogPixelValue(Vertex* p1, Vertex* p2, double ratio, double correctZ) {
+Color Renderer::getFogPixelValue(Vertex* p1, Vertex* p2, double ratio, double correctZ) {
 
     // Apply distance fog to the base lerped color, and return the final value:
     return getDistanceFoggedColor( getPerspCorrectLerpColor(p1, p2, ratio) , correctZ );
@@ -1241,7 +2515,7 @@ unsigned int Renderer::getFogPixelValue(Vertex* p1, Vertex* p2, double ratio, do
 
 // Calculate interpolated pixel and depth fog value
 // Pre-condition: Z is in camera space
-unsigned int Renderer::getDistanceFoggedColor(unsigned int pixelColor, double correctZ){
+Color Renderer::getDistanceFoggedColor(const Color& pixelColor, double correctZ){
 
     // Handle objects too close for fog:
     if (correctZ <= currentScene->fogHither)
@@ -1249,21 +2523,24 @@ unsigned int Renderer::getDistanceFoggedColor(unsigned int pixelColor, double co
 
     // Handle objects past the max fog distance:
     if (correctZ >= currentScene->fogYon)
-        return currentScene->fogColor;
+        return Color::fromARGB(currentScene->fogColor);
 
     // Lerp, based on the fog distance:
     double ratio = (correctZ - currentScene->fogHither) / (currentScene->fogYon - currentScene->fogHither);
 
-    return addColors( multiplyColorChannels(pixelColor, (1 - ratio) ), multiplyColorChannels(currentScene->fogColor, ratio) );
+    return pixelColor.blend( (float)(1 - ratio), Color::fromARGB(currentScene->fogColor), (float)ratio ).saturate();
+}
+
+// Get a polygon's reflectivity as a color channel multiplier. Alpha is unaffected, and reflectivity saturates at 1
+Color Renderer::getReflectivityRatios(Polygon* thePolygon){
+    float reflectivity = (float)thePolygon->getReflectivity();
+
+    return Color(reflectivity, reflectivity, reflectivity, 1.0f).saturate();
 }
 
 // Reset the depth buffer
 void Renderer::resetDepthBuffer(){
-    for (int x = 0; x < xRes; x++){
-        for (int y = 0; y < yRes; y++){
-            ZBuffer[x][y] = maxZVal;
-        }
-    }
+    depthBuffer.clear();
 }
 
 // Set a pixel on the raster
@@ -1274,20 +2551,42 @@ void Renderer::setPixel(int x, int y, double z, unsigned int color){
     y = yRes - y;
 
     // Update the frame buffer:
-    drawable->setPixel(x, y, color);
+    frameBuffer.setPixel(x, y, color);
+
+    // Update the z buffer:
+    depthBuffer.setDepth(x, y, getScaledZVal( z ));
+
+    // Track which pixels were last drawn by lines:
+    if (isAntialiased)
+        isLinePixel[y * xRes + x] = isDrawingLine;
+}
+
+// Set a pixel on the raster, using a linear float color
+// Pre-condition: Point is a valid coordinate on the raster canvas and has been previously checked against the z-buffer
+void Renderer::setPixel(int x, int y, double z, const Color& color){
+
+    // Flip the Y coordinate:
+    y = yRes - y;
+
+    // Update the frame buffer:
+    frameBuffer.setPixel(x, y, color);
 
     // Update the z buffer:
-    ZBuffer[x][y] = getScaledZVal( z );
+    depthBuffer.setDepth(x, y, getScaledZVal( z ));
+
+    // Track which pixels were last drawn by lines:
+    if (isAntialiased)
+        isLinePixel[y * xRes + x] = isDrawingLine;
 }
 
 // Check if a pixel coordinate is in front of the current z-buffer depth
 bool Renderer::isVisible(int x, int y, double z){
-    return ( getScaledZVal( z ) < ZBuffer[x][yRes - y]);
+    return depthBuffer.isCloser(x, yRes - y, getScaledZVal( z ));
 }
 
-// Get a scaled z-buffer value for a given Z
-int Renderer::getScaledZVal(double correctZ){
-    return (int)( (correctZ - currentScene->camHither)/(double)(currentScene->camYon - currentScene->camHither) * std::numeric_limits<int>::max() );
+// Get a normalized z-buffer value for a given Z: The hither plane maps to 0, and the yon plane maps to 1
+float Renderer::getScaledZVal(double correctZ){
+    return (float)( (correctZ - currentScene->camHither)/(double)(currentScene->camYon - currentScene->camHither) );
 }
 
 // Change the frustum shape
@@ -1298,16 +2597,17 @@ void Renderer::transformCamera(TransformationMatrix cameraMovement){
     resetDepthBuffer();
 
     worldToCamera = cameraMovement.getInverse(); // Store the inverse of the camera movements as the world->camera xform
+    cameraToWorld = cameraMovement;
 
     // Rebuild the toScreen matrix:
     perspectiveToScreen = TransformationMatrix(); // Reset to the identity matrix
 
-    // Calculate highest resolution
-    int highestResolution;
-    if (xRes > yRes)
-        highestResolution = xRes;
+    // Calculate lowest resolution: The view window is fit to the raster's shorter side, so it stays within the buffers when xRes != yRes
+    int lowestResolution;
+    if (xRes < yRes)
+        lowestResolution = xRes;
     else
-        highestResolution = yRes;
+        lowestResolution = yRes;
 
     double highestXYDelta;
     if ((currentScene->xHigh - currentScene->xLow) > (currentScene->yHigh - currentScene->yLow))
@@ -1320,7 +2620,7 @@ void Renderer::transformCamera(TransformationMatrix cameraMovement){
     perspectiveToScreen.addTranslation(xRes/2, yRes/2, 0); // Shift local space origin to be centered at center of raster
 
     // Scale:
-    perspectiveToScreen.addNonUniformScale( (highestResolution - (2 * border)) / (highestXYDelta), ( (highestResolution - (2 * border)) / (highestXYDelta) ), 1 ); // Scale
+    perspectiveToScreen.addNonUniformScale( (lowestResolution - (2 * border)) / (highestXYDelta), ( (lowestResolution - (2 * border)) / (highestXYDelta) ), 1 ); // Scale
 
     // Center the camera within the xlow/ylow/xhigh/yhigh view window:
     perspectiveToScreen.addTranslation(-(currentScene->xHigh + currentScene->xLow)/2.0, -(currentScene->yHigh + currentScene->yLow)/2.0, 0);
@@ -1329,6 +2629,25 @@ void Renderer::transformCamera(TransformationMatrix cameraMovement){
     screenToPerspective = TransformationMatrix();        // Reset the matrix back to the identity
     screenToPerspective *= perspectiveToScreen;
     screenToPerspective = screenToPerspective.getInverse();
+
+    // Extend the view window by the guard band:
+    double guardBandWidth = CLIP_GUARD_BAND * (currentScene->xHigh - currentScene->xLow);
+    double guardBandHeight = CLIP_GUARD_BAND * (currentScene->yHigh - currentScene->yLow);
+    guardBandXLow = currentScene->xLow - guardBandWidth;
+    guardBandXHigh = currentScene->xHigh + guardBandWidth;
+    guardBandYLow = currentScene->yLow - guardBandHeight;
+    guardBandYHigh = currentScene->yHigh + guardBandHeight;
+
+    // Find the pixels inside the view window, rounded as the vertices of clipped polygons would be. Kept on the raster
+    Vertex windowMin(currentScene->xLow, currentScene->yLow, 1);
+    Vertex windowMax(currentScene->xHigh, currentScene->yHigh, 1);
+    windowMin.transform(&perspectiveToScreen, true);
+    windowMax.transform(&perspectiveToScreen, true);
+
+    scissorXMin = std::max((int)windowMin.x, 0);
+    scissorXMax = std::min((int)windowMax.x, xRes - 1);
+    scissorYMin = std::max((int)windowMin.y, 1); // Screen space y is flipped when pixels are set
+    scissorYMax = std::min((int)windowMax.y, yRes);
 }
 
 // Calculate a reflection of vector pointing away from a surface
@@ -1342,111 +2661,87 @@ NormalVector Renderer::reflectOutVector(NormalVector* faceNormal, NormalVector*
     return bounceDirection;
 }
 
-// Update a raytracing intersection point with interpolated normals and color values
-void Renderer::setInterpolatedIntersectionValues(Vertex* intersectionPoint, Polygon* hitPoly){
-
-    // Find our position between the edges of the polygon:
-    Vertex* topLeftVertex = hitPoly->getHighest();
-    Vertex* topRightVertex = topLeftVertex; // Start edge traversal at the same point
+// Copy a world space polygon (with its material) into camera space, using storage from the frame arena
+// Return: The camera space copy. Released when the frame arena is rewound past it
+Polygon* Renderer::getCameraSpaceCopy(Polygon* worldSpacePolygon){
+    int numVertices = worldSpacePolygon->getVertexCount();
 
-    Vertex* botLeftVertex = hitPoly->getNext(topLeftVertex->vertexNumber); // Get the next/left vertex (using counter-clockwise ordering)
-    Vertex* botRightVertex = hitPoly->getPrev(topRightVertex->vertexNumber); // Get the prev/right vertex
-
-    // Handle multiple "top" vertices with the same y coordinate - Slide down the edge
-    int count = hitPoly->getVertexCount(); // Track how many times we've moved, to prevent infinite loops when all vertices have the same y-coord.
-    while (topLeftVertex->y == botLeftVertex->y && count > 0){
-        count--;
-        topLeftVertex = botLeftVertex;
-        botLeftVertex = hitPoly->getNext(botLeftVertex->vertexNumber);
-    }
-    count = hitPoly->getVertexCount();
-    while (topRightVertex->y == botRightVertex->y && count > 0){
-        count--;
-        topRightVertex = botRightVertex;
-        botRightVertex = hitPoly->getPrev(botRightVertex->vertexNumber);
-    }
-
-    // Move the pointers to encompass the correct edge:
-    count = hitPoly->getVertexCount();
-    while (!(topLeftVertex->y >= intersectionPoint->y && botLeftVertex->y <= intersectionPoint->y) && count > 0){
-        count--;
-        topLeftVertex = botLeftVertex;
-        botLeftVertex = hitPoly->getNext(botLeftVertex->vertexNumber);
+    Polygon* result = shading->frameArena.create<Polygon>(shading->frameArena.allocateArray<Vertex>(numVertices), (unsigned int)numVertices);
+    for (int i = 0; i < numVertices; i++){
+        result->addVertex(worldSpacePolygon->vertices[i]);
     }
-    count = hitPoly->getVertexCount();
-    while (!(topRightVertex->y >= intersectionPoint->y && botRightVertex->y <= intersectionPoint->y) && count > 0){
-        count--;
-        topRightVertex = botRightVertex;
-        botRightVertex = hitPoly->getPrev(botRightVertex->vertexNumber);
-    }
-
-    // Find how far along each edge we are, as a ratio:
-    double leftRatio = (intersectionPoint->y - topLeftVertex->y)/(double)(botLeftVertex->y - topLeftVertex->y); // How far from top to bot we are
-    double rightRatio = (intersectionPoint->y - topRightVertex->y)/(double)(botRightVertex->y - topRightVertex->y);
-
-    // Calculate normals on the edges:
-    NormalVector leftNml;
-    leftNml.xn = ((1 - leftRatio) * topLeftVertex->normal.xn) + (leftRatio * botLeftVertex->normal.xn);
-    leftNml.yn = ((1 - leftRatio) * topLeftVertex->normal.yn) + (leftRatio * botLeftVertex->normal.yn);
-    leftNml.zn = ((1 - leftRatio) * topLeftVertex->normal.zn) + (leftRatio * botLeftVertex->normal.zn);
-    leftNml.normalize();
+    result->copyAttributes(*worldSpacePolygon);
 
-    NormalVector rightNml;
-    rightNml.xn = ((1 - rightRatio) * topRightVertex->normal.xn) + (rightRatio * botRightVertex->normal.xn);
-    rightNml.yn = ((1 - rightRatio) * topRightVertex->normal.yn) + (rightRatio * botRightVertex->normal.yn);
-    rightNml.zn = ((1 - rightRatio) * topRightVertex->normal.zn) + (rightRatio * botRightVertex->normal.zn);
-    rightNml.normalize();
+    result->transform(&worldToCamera);
 
-    // Calculate edge colors:
-    unsigned int leftColor = addColors(
-                                        multiplyColorChannels(topLeftVertex->color, 1 - leftRatio ),
-                                        multiplyColorChannels(botLeftVertex->color, leftRatio)
-                );
-
-    unsigned int rightColor = addColors(
-                                        multiplyColorChannels(topRightVertex->color, 1 - rightRatio ),
-                                        multiplyColorChannels(botRightVertex->color, rightRatio)
-                );
-
-    // Calculate the x positions along the polygon edges:
+    return result;
+}
 
-    double leftX, rightX;
-    double leftYDiff = botLeftVertex->y - topLeftVertex->y;
-    double rightYDiff = botRightVertex->y - topRightVertex->y;
+// Update a raytracing intersection point with interpolated normals and color values
+// The polygon is split into a fan of triangles about its first vertex, and the triangle holding the point is interpolated with barycentric weights
+// The weights are found in the polygon's plane, so faces in any orientation interpolate correctly (eg. floors, whose vertices all share a camera space y coordinate)
+void Renderer::setInterpolatedIntersectionValues(Vertex* intersectionPoint, Polygon* hitPoly){
 
-    if (leftYDiff != 0){
-        leftX = ((intersectionPoint->y - topLeftVertex->y) * ((botLeftVertex->x - topLeftVertex->x)/leftYDiff) + topLeftVertex->x);
+    Vertex* corners[3] = { &hitPoly->vertices[0], &hitPoly->vertices[0], &hitPoly->vertices[0] };
+    double weights[3] = { 1, 0, 0 };
+    double bestMinWeight = -std::numeric_limits<double>::max();
+
+    for (int i = 1; i < hitPoly->getVertexCount() - 1; i++){
+        Vertex* v0 = &hitPoly->vertices[0];
+        Vertex* v1 = &hitPoly->vertices[i];
+        Vertex* v2 = &hitPoly->vertices[i + 1];
+
+        // Solve for the point's position along the triangle's 2 edges from v0:
+        double edge1[3] = { v1->x - v0->x, v1->y - v0->y, v1->z - v0->z };
+        double edge2[3] = { v2->x - v0->x, v2->y - v0->y, v2->z - v0->z };
+        double toPoint[3] = { intersectionPoint->x - v0->x, intersectionPoint->y - v0->y, intersectionPoint->z - v0->z };
+
+        double edge1DotEdge1 = edge1[0] * edge1[0] + edge1[1] * edge1[1] + edge1[2] * edge1[2];
+        double edge1DotEdge2 = edge1[0] * edge2[0] + edge1[1] * edge2[1] + edge1[2] * edge2[2];
+        double edge2DotEdge2 = edge2[0] * edge2[0] + edge2[1] * edge2[1] + edge2[2] * edge2[2];
+        double pointDotEdge1 = toPoint[0] * edge1[0] + toPoint[1] * edge1[1] + toPoint[2] * edge1[2];
+        double pointDotEdge2 = toPoint[0] * edge2[0] + toPoint[1] * edge2[1] + toPoint[2] * edge2[2];
+
+        double denominator = edge1DotEdge1 * edge2DotEdge2 - edge1DotEdge2 * edge1DotEdge2;
+        if (denominator == 0) // Degenerate triangle
+            continue;
+
+        double weight1 = (edge2DotEdge2 * pointDotEdge1 - edge1DotEdge2 * pointDotEdge2) / denominator;
+        double weight2 = (edge1DotEdge1 * pointDotEdge2 - edge1DotEdge2 * pointDotEdge1) / denominator;
+        double weight0 = 1 - weight1 - weight2;
+
+        // Keep the triangle the point lies furthest inside of. Points rounded just outside of every triangle still find the nearest one
+        double minWeight = std::min(weight0, std::min(weight1, weight2));
+        if (minWeight > bestMinWeight){
+            bestMinWeight = minWeight;
+            corners[1] = v1;
+            corners[2] = v2;
+            weights[0] = weight0;
+            weights[1] = weight1;
+            weights[2] = weight2;
+        }
     }
-    else
-        leftX = botLeftVertex->x;
 
-    if (rightYDiff != 0){
-        rightX = ((intersectionPoint->y - topRightVertex->y) * ((botRightVertex->x - topRightVertex->x)/rightYDiff) + topRightVertex->x);
+    // Clamp the weights to the triangle, so the colors stay within the vertex colors:
+    double weightTotal = 0;
+    for (int i = 0; i < 3; i++){
+        weights[i] = std::max(weights[i], 0.0);
+        weightTotal += weights[i];
     }
-    else
-        rightX = botRightVertex->x;
-
-    // Calculate how far along the face the intersection point is, as a ratio:
-    double pointRatio;
-    double xDiff = rightX - leftX;
-    if (xDiff != 0)
-        pointRatio = (intersectionPoint->x - leftX)/(double)(xDiff);
-    else
-        pointRatio = 0;
-
+    for (int i = 0; i < 3; i++)
+        weights[i] = weightTotal > 0 ? weights[i] / weightTotal : (i == 0 ? 1 : 0);
 
     // Set the normal:
-    intersectionPoint->normal.xn = ((1 - pointRatio) * leftNml.xn) + (pointRatio * rightNml.xn);
-    intersectionPoint->normal.yn = ((1 - pointRatio) * leftNml.yn) + (pointRatio * rightNml.yn);
-    intersectionPoint->normal.zn = ((1 - pointRatio) * leftNml.zn) + (pointRatio * rightNml.zn);
+    intersectionPoint->normal.xn = weights[0] * corners[0]->normal.xn + weights[1] * corners[1]->normal.xn + weights[2] * corners[2]->normal.xn;
+    intersectionPoint->normal.yn = weights[0] * corners[0]->normal.yn + weights[1] * corners[1]->normal.yn + weights[2] * corners[2]->normal.yn;
+    intersectionPoint->normal.zn = weights[0] * corners[0]->normal.zn + weights[1] * corners[1]->normal.zn + weights[2] * corners[2]->normal.zn;
     intersectionPoint->normal.normalize();
 
     // Set the color:
-    intersectionPoint->color = addColors(
-                                        multiplyColorChannels(leftColor, 1 - pointRatio ),
-                                        multiplyColorChannels(rightColor, pointRatio )
-    );
-
+    Color interpolatedColor = Color::fromARGB(corners[0]->color) * (float)weights[0]
+                            + Color::fromARGB(corners[1]->color) * (float)weights[1]
+                            + Color::fromARGB(corners[2]->color) * (float)weights[2];
+    intersectionPoint->color = interpolatedColor.saturate().toARGB();
 }
 
 // Check if 2 polygons share an edge
@@ -1508,8 +2803,8 @@ bool Renderer::isFaceReflexAngle(Polygon* currentPoly, Polygon* hitPoly){
 // Visually debug lights:
 void Renderer::debugLights(){
 
-    for (unsigned int i = 0; i < currentScene->theLights.size(); i++){
-        Light debug = currentScene->theLights[i];
+    for (unsigned int i = 0; i < cameraSpaceLights.size(); i++){
+        Light debug = cameraSpaceLights[i];
         debug.position.transform(&cameraToPerspective);
         debug.position.transform(&perspectiveToScreen);
         drawLine( Line(Vertex(debug.position.x - 15, debug.position.y, debug.position.z, 0xffff0000), Vertex(debug.position.x + 15, debug.position.y, debug.position.z, 0xffff0000) ), ambientOnly, true, 0, 0);
@@ -1518,4 +2813,6 @@ void Renderer::debugLights(){
 
         debug.debug();
     }
+
+    presentFrame();
 }
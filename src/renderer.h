@@ -15,6 +15,50 @@
 #include "transformationmatrix.h"
 #include "light.h"
 #include "scene.h"
+#include "framearena.h"
+#include "depthbuffer.h"
+#include "framebuffer.h"
+#include "color.h"
+#include "lightingkernel.h"
+#include "spankernel.h"
+#include "workerpool.h"
+
+// STL includes:
+#include <chrono>
+#include <memory>
+
+// Clip codes: Each bit marks a vertex as outside one plane of the view volume, tested in homogeneous clip space (where w is the camera space z)
+enum ClipCode{
+    clipHither      = 1,
+    clipYon         = 2,
+    clipLeft        = 4,
+    clipRight       = 8,
+    clipBottom      = 16,
+    clipTop         = 32,
+    clipGuardBand   = 64,   // Outside the guard band surrounding the view window
+
+    clipDepth       = clipHither | clipYon,
+    clipWindow      = clipLeft | clipRight | clipBottom | clipTop
+};
+
+// Rasterizer enumerator: Selects how filled polygons are converted to pixels
+enum RasterizerMode{
+    scanlineRasterizer = 0,     // Walks the left and right edges of each polygon, drawing a scanline between them. Vertices are rounded to whole pixels
+    edgeFunctionRasterizer = 1, // Tests pixels against each triangle's edge functions, in blocks. Vertices are snapped to subpixels
+    rayCastRasterizer = 2       // Casts a ray from the camera through each pixel center, on every core, and lights whatever it hits: Each pixel is shaded once. Wireframe meshes are still drawn by the scanline rasterizer
+};
+
+// Edge function rasterizer settings:
+const int RASTER_SUBPIXEL_BITS = 4;                             // Vertices are snapped to 1/16th of a pixel
+const int RASTER_SUBPIXEL_SCALE = 1 << RASTER_SUBPIXEL_BITS;
+const int RASTER_BLOCK_SIZE = 8;                                // Pixels are tested in 8x8 blocks. Blocks entirely inside or outside a triangle skip the per-pixel edge tests
+
+// How far the guard band extends past each edge of the view window, as a fraction of the window's width/height
+// Filled polygons that cross the view window's edges but stay inside the guard band are scissored while rasterizing, rather than clipped
+const double CLIP_GUARD_BAND = 0.5;
+
+// Lights are culled against square tiles of this many pixels. Each tile lists the lights whose influence spheres can reach it
+const int LIGHT_TILE_SIZE = 16;
 
 // Custom renderer class
 class Renderer{
@@ -29,12 +73,35 @@ public:
     // Pre-condition: topLeft_ and botRight_ coords are valid, and in UI window space (ie. (0,0) is in the top left of the screen!)
     void drawRectangle(int topLeftX, int topLeftY, int botRightX, int botRightY, unsigned int color);
 
-    // Render a scene
-    void renderScene(Scene theScene);
+    // Render a scene. The scene is not modified: It is transformed into the renderer's camera space buffers
+    void renderScene(const Scene& theScene);
+
+    // Render a scene's meshes, with the lights, camera and other settings of another scene (see Scene::getSettings())
+    // Lets many renders share one scene's meshes while overriding its settings
+    void renderScene(const Scene& theScene, const Scene& theSettings);
 
     // Visually debug the renderer's collection of lights
     void debugLights();
 
+    // Print statistics about the most recently rendered frame to cout
+    void printFrameStatistics() const;
+
+    // Get the frame arena, to inspect the memory used by the most recently rendered frame
+    const FrameArena& getFrameArena() const;
+
+    // Enable or disable adaptive antialiasing: Once a frame is drawn, pixels on edges or with high contrast are refined with extra ray traced subpixel samples. Disabled by default
+    void setAntialiasing(bool isEnabled);
+
+    // Select the rasterizer used to fill polygons. Wireframe polygons and lines are always drawn by the scanline rasterizer. Defaults to scanlineRasterizer
+    void setRasterizer(RasterizerMode newRasterizer);
+
+    // Set the number of threads the ray cast rasterizer shares primary rays between, including the thread that calls renderScene(). 0 = one per core (the default)
+    // Callers running several renderers at once should split the cores between them
+    void setRayCastThreads(int numThreads);
+
+    // Set the minimum time between presentations of a partially rendered frame. 0 disables partial presentation: Frames are only presented once complete
+    void setPresentInterval(int milliseconds);
+
 private:
     Drawable* drawable; // A drawable object, used to interface with QT framework
 
@@ -43,17 +110,107 @@ private:
     int xRes;           // Calculated horizontal raster resolution
     int yRes;           // Calculated vertical raster resolution
 
-    int** ZBuffer;               // Z Depth buffer
-    int maxZVal = std::numeric_limits<int>::max();    // Max possible z-depth value
-
-    // The current scene, mesh & polgyon objects being drawn (used to access various render variables)
-    Scene* currentScene;
-    Mesh* currentMesh;
-    Polygon* currentPolygon;
+    FrameBuffer frameBuffer;    // Linear float color buffer. Indexed in UI window space (ie. (0,0) is in the top left of the screen!)
+    DepthBuffer depthBuffer;    // Z Depth buffer. Indexed in UI window space
+
+    // Presentation throttling: Partially rendered frames are shown at most once per interval
+    std::chrono::milliseconds presentInterval = std::chrono::milliseconds(33);
+    std::chrono::steady_clock::time_point lastPresentTime;
+
+    // The current scene being drawn (used to access various render variables)
+    const Scene* currentScene;
+
+    // Per-thread shading state: The mesh & polygon being drawn or lit, scratch memory, and secondary ray statistics
+    // Ray cast frames shade their pixels on several threads at once, so each thread needs its own copy
+    struct ShadingState{
+        Mesh* currentMesh = nullptr;
+        Polygon* currentPolygon = nullptr;
+
+        // Scratch memory for per-polygon and per-ray temporaries. Reset at the start of each frame
+        FrameArena frameArena;
+
+        // Secondary ray statistics for the current frame:
+        unsigned int rayMeshTests = 0, proxyMeshTests = 0;                  // Meshes whose faces were tested by shadow and bounce rays, and how many of them were proxies
+        unsigned long long rayFaceTests = 0, drawnDetailFaceTests = 0;      // Faces tested, and the faces that would have been tested at the drawn levels of detail
+        unsigned long long bounceRaysTraced = 0, bounceRaysSkipped = 0;     // Bounce rays cast, and the rays a full depth trace would have cast that the bounce cutoff skipped
+        unsigned long long lightsEvaluated = 0, lightsCulled = 0;           // Lights evaluated at a point, and lights skipped at a point because it was outside their influence or its tile's list
+    };
+    ShadingState mainShadingState;                              // Used by the thread that calls renderScene(). Worker statistics are added to it once their rays are cast
+    vector<std::unique_ptr<ShadingState>> workerShadingStates;  // Kept between frames, so their arenas' blocks are reused
+    static thread_local ShadingState* shading;                  // The calling thread's shading state
+
+    // World space copy of the current scene's meshes, with their bounding boxes. Kept between renders, and only refreshed when the scene's geometry version changes
+    // Polygons are transformed into camera space as they're drawn, and ray queries run against this copy directly
+    vector<Mesh> worldSpaceMeshes;
+    unsigned int worldSpaceGeometryVersion = 0;     // The geometry version of the scene worldSpaceMeshes was copied from. 0 = none
+    bool wasGeometryRefreshed = false;              // Whether the most recent render had to refresh worldSpaceMeshes
+
+    // Camera space copy of the current scene's lights
+    vector<Light> cameraSpaceLights;
+    LightList cameraSpaceLightList;     // The camera space lights, in the lighting kernel's structure of arrays form
+    LightTileGrid lightTiles;           // The camera space lights that can reach each screen tile. Rebuilt every frame
+    double maxSpecularCoefficient = 0;  // The largest specular coefficient of any world space face. Bounds how much a light can add to a point, with the diffuse term
+
+    // The order meshes are drawn in: Front to back, so near occluders fill the depth buffer first
+    vector<Mesh*> meshDrawOrder;
+    vector<double> meshDepths;      // The nearest camera space depth of each mesh's bounding box, indexed like worldSpaceMeshes
+
+    // Occlusion culling statistics for the current frame:
+    unsigned int meshesTested = 0, meshesOccluded = 0;
+    unsigned int polygonsTested = 0, polygonsOccluded = 0;
+
+    // The rasterizer used to fill polygons
+    RasterizerMode rasterizer = scanlineRasterizer;
+
+    // Ray cast threads: The requested number (0 = one per core), and the workers that help the calling thread. Workers are kept between frames
+    unsigned int rayCastThreadBudget = 0;
+    WorkerPool rayCastWorkers;
+
+    // Edge function rasterizer statistics for the current frame:
+    unsigned int trianglesRasterized = 0;
+    unsigned int blocksAccepted = 0, blocksRejected = 0, blocksPartial = 0;    // Blocks drawn without per-pixel edge tests, skipped entirely, and tested per pixel
+
+    // Span kernel statistics for the current frame:
+    unsigned int spanGroupsTested = 0;              // Groups of SPAN_KERNEL_WIDTH pixels depth tested together
+    unsigned int spanPixelsTested = 0, spanPixelsVisible = 0;
+
+    // Ray casting statistics for the current frame:
+    unsigned int primaryRaysCast = 0, primaryRayHits = 0;
+    unsigned int rayCastThreads = 0;                // Threads the primary rays were shared between
+
+    // Clipping statistics for the current frame:
+    unsigned int polygonsClipTested = 0;            // Polygons that reached the clip stage
+    unsigned int polygonsDepthClipped = 0;          // Polygons clipped to hither/yon
+    unsigned int polygonsScreenClipped = 0;         // Polygons clipped to the view window
+    unsigned int polygonsGuardBandAccepted = 0;     // Polygons crossing the view window's edges that were scissored instead of clipped
+
+    // The guard band, in perspective space. Set by transformCamera()
+    double guardBandXLow = 0, guardBandXHigh = 0, guardBandYLow = 0, guardBandYHigh = 0;
+
+    // The screen space pixels inside the view window, which rasterized polygons are scissored to. Set by transformCamera()
+    int scissorXMin = 0, scissorXMax = 0, scissorYMin = 0, scissorYMax = 0;
+
+    // Cluster culling statistics for the current frame:
+    unsigned int meshesOutsideFrustum = 0;
+    unsigned int clustersTested = 0, clustersOutsideFrustum = 0, clustersBackfacing = 0;
+
+    // Level of detail statistics for the current frame:
+    unsigned int meshesReduced = 0;                     // Meshes drawn below full detail
+    unsigned int fullDetailFaces = 0, activeFaces = 0;  // Faces in the scene at full detail, and at the chosen levels of detail
+
+    // Adaptive antialiasing:
+    bool isAntialiased = false;
+    vector<unsigned char> isEdgePixel;  // Pixels selected for refinement in the current frame. Indexed in UI window space
+    vector<unsigned char> isLinePixel;  // Pixels last drawn by a line or wireframe in the current frame. Indexed in UI window space
+    bool isDrawingLine = false;
+    unsigned int pixelsConsidered = 0, pixelsRefined = 0, extraSamples = 0; // Statistics for the current frame
 
     // A transformation matrix from world to camera space
     TransformationMatrix worldToCamera;
 
+    // A transformation matrix from camera space back to world space. Used to cast rays against the world space meshes
+    TransformationMatrix cameraToWorld;
+
     // Perspective transformation: Takes an object in camera space, and adds perspective
     TransformationMatrix cameraToPerspective;   // Assembled in the constructor
 
@@ -76,20 +233,45 @@ private:
     // Draw a polygon in wireframe only
     void drawPolygonWireframe(Polygon* thePolygon);
 
-    // Draw a mesh object
+    // Draw a world space mesh object, transforming each polygon into camera space as it is drawn
     void drawMesh(Mesh* theMesh);
 
-    // Draw a scanline, with consideration to the Z-Buffer.
-    // Pre-condition: start and end vertices are in left to right order
-    // Note: LERP's if start.color != end.color. Does NOT update the screen!
-    void drawScanlineIfVisible(Vertex* start, Vertex* end);
-
-    // Draw a scanline with per-pixel phong lighting, with consideration to the Z-Buffer
-    void drawPerPxLitScanlineIfVisible(Vertex* start, Vertex* end, bool doAmbient, double specularCoefficient, double specularExponent);
+    // Perspective correct interpolation planes of a screen space triangle: 1/z, and each attribute divided by z, vary linearly across the screen
+    // Each is stored as its value at (originX, originY), and its change per pixel in x and y
+    struct AttributePlanes{
+        double originX, originY;
+        double inverseZ, inverseZDx, inverseZDy;                    // 1/z
+        Color colorOverZ, colorOverZDx, colorOverZDy;               // Vertex color/z. Unused if isSolidColor
+        double normalOverZ[3], normalOverZDx[3], normalOverZDy[3];  // Vertex normal/z: x, y and z components. Only set for phong shaded triangles
+        bool isSolidColor;
+        Color solidColor;
+    };
+
+    // Set up the interpolation planes of a triangle, so its pixels can be interpolated with one reciprocal each
+    // Pre-condition: Received polygon is a triangle in screen space, with camera space z. Degenerate triangles take the attributes of their first vertex
+    void setupAttributePlanes(Polygon* thePolygon, AttributePlanes* planes);
+
+    // Depth test the pixels of a scanline from xFirst to xLast with the span kernels, storing the depths of those that pass. inverseZ is 1/z at xFirst
+    // Writes the x coordinates and camera space z of the visible pixels to visibleX and visibleZ, which must hold xLast - xFirst + 1 entries
+    // Return: The number of visible pixels
+    int depthTestScanline(int xFirst, int xLast, int y, double inverseZ, double inverseZStep, int* visibleX, double* visibleZ);
+
+    // Draw a scanline of a triangle between its left and right edge positions (which are rounded to pixels), with consideration to the Z-Buffer. Pixels outside of the scissor rectangle are skipped
+    // Note: Does NOT update the screen!
+    void drawScanlineIfVisible(double xLeft, double xRight, int y, const AttributePlanes* planes);
+
+    // Draw a scanline of a triangle with per-pixel phong lighting, with consideration to the Z-Buffer. Pixels outside of the scissor rectangle are skipped
+    void drawPerPxLitScanlineIfVisible(double xLeft, double xRight, int y, const AttributePlanes* planes, bool doAmbient, double specularCoefficient, SpecularPower specularPower);
 
     // Reset the depth buffer
     void resetDepthBuffer();
 
+    // Present the frame buffer to the drawable, if the present interval has elapsed since the last presentation
+    void presentIfDue();
+
+    // Quantize the frame buffer, and present it to the drawable
+    void presentFrame();
+
     // Change the frustum shape
     // Precondition: currentScene != nullptr
     void transformCamera(TransformationMatrix cameraMovement);
@@ -101,23 +283,39 @@ private:
 
     // Override: Lerp be#Filter:3tween the color values of 2 points (Perspective correct: Takes Z-Depth into account)
     // Return: An unsigned int color value, calculated based on a LERP of the current position between the 2 provided points
-    unsigned int getPerspCorrectLerpColor(Vertex* p1, Vertex* p2, double ratio) const;
+    Color getPerspCorrectLerpColor(Vertex* p1, Vertex* p2, double ratio) const;
 
     // Calculate a lighting value for a given pixel on a line between 2 points
     // Pre-condition: Ambient lighting has already been applied to the vertex color values
-    unsigned int getFogPixelValue(Vertex* p1, Vertex* p2, double ratio, double correctZ);
+    Color getFogPixelValue(Vertex* p1, Vertex* p2, double ratio, double correctZ);
 
     // Calculate interpolated pixel and depth fog value
-    unsigned int getDistanceFoggedColor(unsigned int pixelColor, double correctZ);
+    Color getDistanceFoggedColor(const Color& pixelColor, double correctZ);
+
+    // Get a polygon's reflectivity as a color channel multiplier. Alpha is unaffected, and reflectivity saturates at 1
+    Color getReflectivityRatios(Polygon* thePolygon);
 
     // Set a pixel on the raster
     // Pre-condition: Point is a valid coordinate on the raster canvas and has been previously checked against the z-buffer
     void setPixel(int x, int y, double z, unsigned int color);
 
+    // Set a pixel on the raster, using a linear float color
+    // Pre-condition: Point is a valid coordinate on the raster canvas and has been previously checked against the z-buffer
+    void setPixel(int x, int y, double z, const Color& color);
+
     // Draw a polygon using opacity
-    // If thePolygon vertices are all not the same color, the color will be LERP'd
+    // If thePolygon vertices are all not the same color, the color will be LERP'd. Scanlines outside of the scissor rectangle are skipped
     void rasterizePolygon(Polygon* thePolygon);
 
+    // Draw a triangle using edge functions: Its vertices are snapped to fixed point subpixels, and pixels are tested against its edges in 8x8 blocks, following the top-left fill rule
+    // Pixels outside of the scissor rectangle are skipped
+    // Pre-condition: Received polygon is a triangle in perspective space (ie. its vertices have not been transformed to screen space or rounded)
+    void rasterizeTriangle(Polygon* thePolygon);
+
+    // Shade and set a set of covered pixels of the triangle being rasterized by rasterizeTriangle(), if they pass the depth test
+    // weights holds 3 screen space barycentric weights per pixel, and isEndPoint marks pixels on the triangle's left or right edges
+    void shadeTrianglePixels(Polygon* thePolygon, int* pixelX, int* pixelY, double* weights, bool* isEndPoint, int numPixels);
+
     // Light a Polygon using flat shading
     // Pre-condition: All vertices have a valid normal
     void flatShadePolygon(Polygon* thePolygon);
@@ -126,20 +324,118 @@ private:
     // Pre-condition: All vertices have a valid normal
     void gouraudShadePolygon(Polygon* thePolygon);
 
-    // Light a given point in camera space
-    unsigned int lightPointInCameraSpace(Vertex* currentPosition, NormalVector* viewVector, bool doAmbient, double specularExponent, double specularCoefficient);
+    // A point to be lit, and the material properties used to light it
+    struct SurfacePoint{
+        Vertex* position;           // Camera space position, with a normalized normal and base color
+        NormalVector* viewVector;   // Normalized: Points from the surface towards the viewer
+        bool doAmbient;
+        SpecularPower specularPower;
+        double specularCoefficient;
+    };
+
+    // List the lights whose influence spheres reach each screen tile's frustum in lightTiles. Lights with an infinite influence radius are listed by every tile
+    void buildLightTiles();
 
-    // Recursively ray trace a point's lighting
-    unsigned int recursivelyLightPointInCS(Vertex* currentPosition, NormalVector* viewVector, bool doAmbient, double specularExponent, double specularCoefficient, int bounceRays, bool isEndPoint);
+    // Get the light tile a camera space point projects into
+    // Return: The tile's index, or -1 if the point lies behind the camera or projects outside of the screen
+    int getLightTile(const Vertex& cameraSpacePoint);
 
-    // Recursive helper function for ray tracing
-    unsigned int recursiveLightHelper(Vertex* currentPosition, NormalVector* viewVector, bool doAmbient, double specularExponent, double specularCoefficient, int bounceRays, bool isEndPoint);
+    // Light a given point in camera space
+    Color lightPointInCameraSpace(Vertex* currentPosition, NormalVector* viewVector, bool doAmbient, double specularExponent, double specularCoefficient);
+
+    // Light a batch of points in camera space. Writes one color per point to results
+    void lightPoints(SurfacePoint* points, int numPoints, Color* results);
+
+    // Ray trace the lighting of a batch of points on the current polygon, including up to bounceRays bounces of their reflections. Writes one color per point to results
+    void recursivelyLightPoints(SurfacePoint* points, int numPoints, int bounceRays, const bool* isEndPoint, Color* results);
+
+    // A batch of bounce rays at the same depth along their paths, and the points they hit. Allocated from the frame arena by traceBounceRays()
+    struct BounceBatch{
+        int numRays;
+        Vertex* origins;
+        NormalVector* directions;
+        const bool* isEndPoint;
+        const double* throughputs;  // The product of the reflectivities along each ray's path: The most its color can add to the final pixel
+        int* sourceHits;            // The hit on the previous batch each ray was reflected from. Unused by the first batch
+        Color* colors;              // The color each ray returns
+
+        Vertex* intersections;      // Indexed by ray
+        Polygon** hitPolys;         // Indexed by ray. nullptr if the ray hit nothing
+        int numHits;
+        int* hitRays;               // The ray each hit belongs to
+        Color* hitColors;           // The lit color of each hit, plus the reflection it receives
+    };
+
+    // Trace a batch of bounce rays cast from the drawn surface, and their reflections, for up to numBounces bounces. Writes one color per ray to results
+    // Rays whose path throughput falls to the scene's bounce cutoff are not traced (see Scene::bounceCutoff). Bounces after the first may be traced against coarse proxies (see Scene::proxyRays)
+    void traceBounceRays(Vertex* origins, NormalVector* directions, const bool* isEndPoint, const double* throughputs, int numRays, int numBounces, Color* results);
+
+    // Refine the pixels on edges, or with high contrast, by averaging them with extra subpixel samples cast through the ray tracing path
+    void antialiasEdges();
+
+    // Cast a primary ray through the center of each pixel in the view window, and write the lit colors and depths of the hits to the buffers
+    // The rows are shared between the calling thread and the ray cast workers (see setRayCastThreads())
+    void castPrimaryRays();
+
+    // Find the pixels inside the view window, in UI window space. Pixels outside of it belong to the border
+    // Return: False if no pixels lie inside it
+    bool getViewWindowPixels(int* xMin, int* yMin, int* xMax, int* yMax);
+
+    // Mark the pixels within a rectangle whose color or depth differs sharply from a neighbour
+    // Return: The number of pixels marked
+    int findEdgePixels(int xMin, int yMin, int xMax, int yMax);
+
+    // Cast a primary ray from the camera through a point in screen space, and light whatever it hits. If hitZ isn't nullptr, it's set to the camera space depth of the hit (and left unchanged if there is none)
+    // Return: The lit color, or the fog color if the ray hits nothing
+    Color traceSubpixelSample(double screenX, double screenY, double* hitZ = nullptr);
+
+    // Find the world space mesh that owns a world space polygon
+    // Return: The mesh, or nullptr if the polygon isn't part of the world space geometry
+    Mesh* getWorldSpaceMesh(Polygon* worldSpacePolygon);
+
+    // Find the nearest polygon a bounce ray strikes. Wireframe meshes are optionally ignored, as primary rays see through them. Other meshes are optionally tested at their proxy detail
+    // Return: The polygon that was hit, or nullptr. Sets closestIntersection to the point of intersection if a polygon was hit
+    Polygon* findBounceIntersection(Vertex* currentPosition, NormalVector* bounceDirection, bool isEndPoint, Vertex* closestIntersection, bool skipWireframeMeshes = false, bool useProxies = false);
+
+    // Get the faces of a world space mesh that a ray is tested against: Its coarsest level of detail if useProxy is set, unless it's the mesh being drawn. Its drawn level otherwise
+    // Updates the secondary ray statistics
+    vector<Polygon>& getRayFaces(Mesh* worldSpaceMesh, bool useProxy);
 
     // Check if a pixel coordinate is in front of the current z-buffer depth
     bool isVisible(int x, int y, double z);
 
-    // Get a scaled z-buffer value for a given Z
-    int getScaledZVal(double correctZ);
+    // Get a normalized z-buffer value for a given Z: The hither plane maps to 0, and the yon plane maps to 1
+    float getScaledZVal(double correctZ);
+
+    // Find the screen space bounds of a set of camera space points, and their nearest depth
+    // Return: True if the bounds were found, false if there are no points or any of them lie in front of the hither plane (and can't be projected)
+    bool getProjectedBounds(Vertex* cameraSpacePoints, int numPoints, double* xMin, double* yMin, double* xMax, double* yMax, double* zMin);
+
+    // Check whether a set of camera space points is hidden behind what has already been drawn, using the depth buffer's hierarchical depth pyramid
+    // Return: True if the screen space bounds of the points are entirely behind the depth buffer, false if they might be visible (or lie in front of the hither plane)
+    bool isOccluded(Vertex* cameraSpacePoints, int numPoints);
+
+    // Get the nearest camera space depth of a world space mesh's bounding box. Used to sort meshes front to back
+    double getNearestBoundingBoxDepth(Mesh* theMesh);
+
+    // Check whether a world space mesh's bounding box is hidden behind what has already been drawn
+    bool isBoundingBoxOccluded(Mesh* theMesh);
+
+    // Get the clip codes of a set of camera space points: The planes any of the points are outside of, and the planes all of the points are outside of
+    void getClipCodes(Vertex* cameraSpacePoints, int numPoints, unsigned int* anyOutside, unsigned int* allOutside);
+
+    // Check whether a set of camera space points lies entirely outside the view frustum: Beyond the hither, yon or one of the view window planes
+    bool isOutsideFrustum(Vertex* cameraSpacePoints, int numPoints);
+
+    // Check whether a world space mesh's bounding box lies entirely outside the view frustum
+    bool isBoundingBoxOutsideFrustum(Mesh* theMesh);
+
+    // Check whether every face of a world space cluster can be culled, because its bounding sphere is outside the view frustum or its normal cone faces away from the camera
+    // Wireframe clusters are never backface culled, as their polygons are drawn from both sides. Updates the cluster culling statistics
+    bool isClusterCulled(MeshCluster* theCluster, bool isWireframe);
+
+    // Choose the level of detail a world space mesh is drawn (and ray traced) at, from the projected size of its bounding box
+    void selectLevelOfDetail(Mesh* theMesh);
 
     // Determine whether a current position is shadowed by some polygon in the scene that lies between it and a light
     bool isShadowed(Vertex currentPosition, NormalVector* lightDirection, double lightDistance);
@@ -165,6 +461,9 @@ private:
     // Update a raytracing intersection point with interpolated normals and color values
     void setInterpolatedIntersectionValues(Vertex* intersectionPoint, Polygon* hitPoly);
 
+    // Copy a world space polygon into camera space, using storage from the frame arena
+    Polygon* getCameraSpaceCopy(Polygon* worldSpacePolygon);
+
     // Check if two polygons share an edge
     bool haveSharedEdge(Polygon* poly1, Polygon* poly2);
 
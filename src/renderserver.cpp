@@ -0,0 +1,162 @@
+// Render server object: A local socket server that renders scenes on request, keeping them warm between requests
+// By Adam Badke
+
+#include "renderserver.h"
+
+#include <QRunnable>
+#include <QMetaObject>
+#include <QThread>
+#include <algorithm>
+#include <iostream>
+
+// Property used to mark a client that is waiting on a job
+static const char* IS_RENDERING_PROPERTY = "isRendering";
+
+// Build the response to a request: A header, followed by the image's tiles
+static QByteArray buildResponse(const RenderResult& result, int tileSize){
+    if (!result.succeeded)
+        return QByteArray("error ") + result.error.c_str() + "\n";
+
+    if (tileSize <= 0) // Send the whole image as a single tile
+        tileSize = std::max(result.width, result.height);
+
+    QByteArray response;
+    response.reserve(result.width * result.height * (int)sizeof(unsigned int) + 64);
+    response += "ok " + QByteArray::number(result.width) + " " + QByteArray::number(result.height) + " " + QByteArray::number(tileSize) + "\n";
+
+    for (int tileY = 0; tileY < result.height; tileY += tileSize){
+        int tileHeight = std::min(tileSize, result.height - tileY);
+
+        for (int tileX = 0; tileX < result.width; tileX += tileSize){
+            int tileWidth = std::min(tileSize, result.width - tileX);
+
+            response += "tile " + QByteArray::number(tileX) + " " + QByteArray::number(tileY) + " " + QByteArray::number(tileWidth) + " " + QByteArray::number(tileHeight) + "\n";
+            for (int row = tileY; row < tileY + tileHeight; row++)
+                response.append((const char*)&result.pixels[row * result.width + tileX], tileWidth * (int)sizeof(unsigned int));
+        }
+    }
+
+    response += "done " + QByteArray::number(result.loadMilliseconds + result.renderMilliseconds, 'f', 1) + "\n";
+
+    return response;
+}
+
+// A single render request, run on the server's job pool
+class RenderJob : public QRunnable
+{
+public:
+    RenderJob(RenderServer* newServer, RenderService* newService, quint64 newJobId, const RenderRequest& newRequest){
+        server = newServer;
+        service = newService;
+        jobId = newJobId;
+        request = newRequest;
+    }
+
+    // Render the request, and hand the response back to the server's thread
+    void run(){
+        RenderResult result = service->render(request);
+
+        std::cout << "Job " << jobId << ": " << request.sceneName << " " << result.width << "x" << result.height
+                  << (result.succeeded ? "" : " failed: " + result.error)
+                  << (result.wasSceneCached ? " (cached scene)" : "")
+                  << " loaded in " << result.loadMilliseconds << "ms, rendered in " << result.renderMilliseconds << "ms\n";
+
+        QMetaObject::invokeMethod(server, "jobFinished", Qt::QueuedConnection, Q_ARG(quint64, jobId), Q_ARG(QByteArray, buildResponse(result, request.tileSize)));
+    }
+
+private:
+    RenderServer* server;
+    RenderService* service;
+    quint64 jobId;
+    RenderRequest request;
+};
+
+// Constructor
+RenderServer::RenderServer(int maxConcurrentJobs, int maxQueuedJobs, QObject* parent) : QObject(parent) {
+    jobPool.setMaxThreadCount(std::max(maxConcurrentJobs, 1));
+    maxJobs = jobPool.maxThreadCount() + std::max(maxQueuedJobs, 0);
+
+    // Ray cast jobs share the cores left over for each concurrent job between their own threads:
+    rayCastThreads = std::max(1, QThread::idealThreadCount() / jobPool.maxThreadCount());
+    service.setRayCastThreads(rayCastThreads);
+    nextJobId = 0;
+    numJobs = 0;
+
+    connect(&localServer, &QLocalServer::newConnection, this, &RenderServer::acceptConnections);
+}
+
+// Destructor
+RenderServer::~RenderServer(){
+    jobPool.waitForDone();
+}
+
+// Start listening for connections
+bool RenderServer::listen(const QString& serverName){
+    QLocalServer::removeServer(serverName);
+
+    if (!localServer.listen(serverName)){
+        std::cout << "Error: Could not start render server \"" << serverName.toStdString() << "\": " << localServer.errorString().toStdString() << "\n";
+        return false;
+    }
+
+    std::cout << "Render server listening on " << localServer.fullServerName().toStdString() << " (" << jobPool.maxThreadCount() << " concurrent jobs, " << maxJobs - jobPool.maxThreadCount() << " queued, " << rayCastThreads << " thread(s) per ray cast job)\n";
+    return true;
+}
+
+// Accept new client connections
+void RenderServer::acceptConnections(){
+    while (localServer.hasPendingConnections()){
+        QLocalSocket* client = localServer.nextPendingConnection();
+
+        connect(client, &QLocalSocket::readyRead, this, &RenderServer::readRequest);
+        connect(client, &QLocalSocket::disconnected, client, &QLocalSocket::deleteLater);
+    }
+}
+
+// Start a job for the next request sent by a client
+void RenderServer::readRequest(){
+    QLocalSocket* client = qobject_cast<QLocalSocket*>(sender());
+    if (client == nullptr || client->property(IS_RENDERING_PROPERTY).toBool() || !client->canReadLine())
+        return;
+
+    string line = QString::fromUtf8(client->readLine()).trimmed().toStdString();
+
+    RenderRequest request;
+    string error;
+    if (!RenderRequest::parse(line, &request, &error)){
+        sendResponse(client, QByteArray("error ") + error.c_str() + "\n");
+        return;
+    }
+
+    if (numJobs >= maxJobs){
+        sendResponse(client, "error busy\n");
+        return;
+    }
+
+    quint64 jobId = nextJobId++;
+    pendingJobs.insert(jobId, client);
+    numJobs++;
+    client->setProperty(IS_RENDERING_PROPERTY, true);
+
+    jobPool.start(new RenderJob(this, &service, jobId, request));
+}
+
+// Send a finished job's response to the client that requested it
+void RenderServer::jobFinished(quint64 jobId, QByteArray response){
+    QPointer<QLocalSocket> client = pendingJobs.take(jobId);
+    numJobs--;
+
+    if (client.isNull()) // The client disconnected while its job was running
+        return;
+
+    client->setProperty(IS_RENDERING_PROPERTY, false);
+    sendResponse(client, response);
+}
+
+// Reply to a client's request, and start on its next request if it has already sent one
+void RenderServer::sendResponse(QLocalSocket* client, const QByteArray& response){
+    client->write(response);
+
+    if (client->canReadLine())
+        QMetaObject::invokeMethod(client, "readyRead", Qt::QueuedConnection);
+}
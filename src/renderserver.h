@@ -0,0 +1,66 @@
+// Render server object: A local socket server that renders scenes on request, keeping them warm between requests
+// By Adam Badke
+
+#ifndef RENDERSERVER_H
+#define RENDERSERVER_H
+
+#include "renderservice.h"
+
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QThreadPool>
+#include <QPointer>
+#include <QHash>
+#include <QByteArray>
+
+// Name the server listens on, if none is given. A Unix domain socket in the temp directory on Unix, a named pipe on Windows
+const QString DEFAULT_RENDER_SERVER_NAME = "qtqt-render";
+
+// Render server protocol:
+// -> The client sends a request as a single line of text (see RenderRequest::parse). Eg. "04 width=640 height=480 bounces=2 tile=32"
+// -> The server replies with "ok <width> <height> <tileSize>\n", followed by each tile as "tile <x> <y> <width> <height>\n" and its rows of
+//    packed 32 bit ARGB pixels, then "done <milliseconds>\n". Tiles are sent in row-major order from the top left
+// -> Failed requests are answered with "error <description>\n". Requests are rejected with "error busy" when the job queue is full
+// -> A connection may send any number of requests. They are answered one at a time, in the order they were sent
+class RenderServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Constructor: Renders up to maxConcurrentJobs requests at once, and queues up to maxQueuedJobs more
+    RenderServer(int maxConcurrentJobs, int maxQueuedJobs, QObject* parent = nullptr);
+
+    // Destructor: Waits for any running jobs to finish
+    ~RenderServer();
+
+    // Start listening for connections. Removes any stale socket left behind by a server that crashed
+    // Return: True if the server is listening, false otherwise
+    bool listen(const QString& serverName);
+
+private slots:
+    // Accept new client connections
+    void acceptConnections();
+
+    // Start a job for the next request sent by a client, if it isn't already waiting on one
+    void readRequest();
+
+    // Send a finished job's response to the client that requested it. Called on the server's thread
+    void jobFinished(quint64 jobId, QByteArray response);
+
+private:
+    // Reply to a client's request, and start on its next request if it has already sent one
+    void sendResponse(QLocalSocket* client, const QByteArray& response);
+
+    QLocalServer localServer;
+    QThreadPool jobPool;                            // Runs render jobs. Its thread count is the concurrency limit
+    RenderService service;                          // Shared by all jobs, so every request benefits from the warm caches
+
+    QHash<quint64, QPointer<QLocalSocket>> pendingJobs; // The client waiting on each job. Null if the client disconnected
+    quint64 nextJobId;
+    int numJobs;                                    // Running and queued jobs
+    int maxJobs;                                    // Requests arriving when numJobs == maxJobs are rejected
+    int rayCastThreads;                             // Threads each ray cast job shares its primary rays between
+};
+
+#endif // RENDERSERVER_H
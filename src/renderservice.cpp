@@ -0,0 +1,244 @@
+// Render service object: Renders scenes on request, keeping parsed scenes and renderers warm between requests
+// By Adam Badke
+
+#include "renderservice.h"
+#include "fileinterpreter.h"
+#include "scenesnapshot.h"
+
+// STL includes:
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// Parse an integer option value
+// Return: True if the whole value is an integer in [minValue, maxValue], false otherwise
+static bool parseOption(const string& value, int minValue, int maxValue, int* result){
+    if (value.empty())
+        return false;
+
+    char* end;
+    long parsed = std::strtol(value.c_str(), &end, 10);
+    if (*end != '\0' || parsed < minValue || parsed > maxValue)
+        return false;
+
+    *result = (int)parsed;
+    return true;
+}
+
+// Parse a request from a line of text
+bool RenderRequest::parse(const string& line, RenderRequest* result, string* error){
+    std::istringstream tokens(line);
+    RenderRequest request;
+
+    if (!(tokens >> request.sceneName)){
+        *error = "missing scene name";
+        return false;
+    }
+
+    string option;
+    while (tokens >> option){
+        size_t separator = option.find('=');
+        string key = option.substr(0, separator);
+        string value = separator == string::npos ? "" : option.substr(separator + 1);
+
+        bool isValid;
+        if (key == "width")
+            isValid = parseOption(value, 1, RenderService::MAX_RESOLUTION, &request.width);
+        else if (key == "height")
+            isValid = parseOption(value, 1, RenderService::MAX_RESOLUTION, &request.height);
+        else if (key == "tile")
+            isValid = parseOption(value, 0, RenderService::MAX_RESOLUTION, &request.tileSize);
+        else if (key == "bounces")
+            isValid = parseOption(value, 0, 64, &request.rayBounces);
+        else if (key == "shadows")
+            isValid = parseOption(value, 0, 1, &request.shadows);
+        else if (key == "fog")
+            isValid = parseOption(value, 0, 1, &request.depthFog);
+        else if (key == "proxies")
+            isValid = parseOption(value, 0, 2, &request.proxyRays);
+        else if (key == "aa"){
+            int antialiasing = 0;
+            isValid = parseOption(value, 0, 1, &antialiasing);
+            request.isAntialiased = antialiasing == 1;
+        }
+        else if (key == "raster"){
+            int rasterizer = scanlineRasterizer;
+            isValid = parseOption(value, 0, 2, &rasterizer);
+            request.rasterizer = (RasterizerMode)rasterizer;
+        }
+        else{
+            *error = "unknown option " + key;
+            return false;
+        }
+
+        if (!isValid){
+            *error = "invalid value for " + key;
+            return false;
+        }
+    }
+
+    *result = request;
+    return true;
+}
+
+// PooledRenderer constructor
+RenderService::PooledRenderer::PooledRenderer(int width, int height) : drawable(width, height), renderer(&drawable, width, height, 1) {
+    renderer.setPresentInterval(0); // Nobody is watching: Only present finished frames
+}
+
+// Constructor
+RenderService::RenderService(){
+    // Do nothing
+}
+
+// Destructor
+RenderService::~RenderService(){
+    for (auto currentRenderer : idleRenderers)
+        delete currentRenderer;
+}
+
+// Render a request
+RenderResult RenderService::render(const RenderRequest& request){
+    RenderResult result;
+
+    string filename = request.sceneName;
+    if (filename.size() < 5 || filename.compare(filename.size() - 5, 5, ".simp") != 0)
+        filename += ".simp";
+
+    // Get the scene, and apply the request's overrides to a copy of its settings. Its meshes are shared with other requests, not copied
+    auto loadStart = std::chrono::steady_clock::now();
+
+    std::shared_ptr<const Scene> theScene;
+    if (!getScene(filename, &theScene, &result.wasSceneCached)){
+        result.error = "scene " + filename + " not found";
+        return result;
+    }
+
+    Scene theSettings = theScene->getSettings();
+    if (request.rayBounces >= 0)
+        theSettings.numRayBounces = request.rayBounces;
+    if (request.shadows >= 0)
+        theSettings.noRayShadows = request.shadows == 0;
+    if (request.depthFog >= 0)
+        theSettings.isDepthFogged = request.depthFog == 1;
+    if (request.proxyRays >= 0)
+        theSettings.proxyRays = (ProxyRayMode)request.proxyRays;
+
+    auto renderStart = std::chrono::steady_clock::now();
+
+    // Render:
+    PooledRenderer* pooledRenderer = acquireRenderer(request.width, request.height);
+    pooledRenderer->renderer.setAntialiasing(request.isAntialiased);
+    pooledRenderer->renderer.setRasterizer(request.rasterizer);
+    pooledRenderer->renderer.setRayCastThreads(rayCastThreads);
+    pooledRenderer->renderer.renderScene(*theScene, theSettings);
+
+    result.width = request.width;
+    result.height = request.height;
+    result.pixels.assign(pooledRenderer->drawable.getPixels(), pooledRenderer->drawable.getPixels() + request.width * request.height);
+    result.frameArenaPeakBytes = pooledRenderer->renderer.getFrameArena().getPeakBytes();
+    result.frameArenaReservedBytes = pooledRenderer->renderer.getFrameArena().getReservedBytes();
+
+    releaseRenderer(pooledRenderer);
+
+    auto renderEnd = std::chrono::steady_clock::now();
+    result.loadMilliseconds = std::chrono::duration<double, std::milli>(renderStart - loadStart).count();
+    result.renderMilliseconds = std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+    result.succeeded = true;
+
+    return result;
+}
+
+// Set the number of threads each ray cast request shares its primary rays between
+void RenderService::setRayCastThreads(int numThreads){
+    rayCastThreads = numThreads;
+}
+
+// Get a scene, loading it if it isn't cached or its files have changed since it was cached
+bool RenderService::getScene(const string& filename, std::shared_ptr<const Scene>* result, bool* wasCached){
+    if (getCachedScene(filename, result)){
+        *wasCached = true;
+        return true;
+    }
+
+    if (!std::ifstream(filename).good())
+        return false;
+
+    // Load the scene. This also refreshes its snapshot, if it was out of date
+    std::lock_guard<std::mutex> loadLock(sceneLoadMutex);
+
+    // Another request may have loaded it while this one waited:
+    if (getCachedScene(filename, result)){
+        *wasCached = true;
+        return true;
+    }
+
+    FileInterpreter sceneInterpreter;
+    std::shared_ptr<const Scene> loadedScene = std::make_shared<const Scene>(sceneInterpreter.buildSceneFromFile(filename));
+
+    std::lock_guard<std::mutex> cacheLock(sceneCacheMutex);
+    sceneCache[filename] = loadedScene;
+    *result = loadedScene;
+    *wasCached = false;
+
+    return true;
+}
+
+// Get a cached scene, as long as none of the files it was built from have changed since it was cached
+bool RenderService::getCachedScene(const string& filename, std::shared_ptr<const Scene>* result){
+    std::lock_guard<std::mutex> cacheLock(sceneCacheMutex);
+
+    auto cachedScene = sceneCache.find(filename);
+    if (cachedScene == sceneCache.end() || !SceneSnapshot::isUpToDate(filename + SCENE_SNAPSHOT_EXTENSION))
+        return false;
+
+    *result = cachedScene->second;
+    return true;
+}
+
+// Take an idle renderer of a given resolution from the pool, creating one if none is available
+RenderService::PooledRenderer* RenderService::acquireRenderer(int width, int height){
+    {
+        // Prefer the most recently used match, as it's the most likely to hold the requested scene's geometry:
+        std::lock_guard<std::mutex> poolLock(rendererPoolMutex);
+        for (int i = (int)idleRenderers.size() - 1; i >= 0; i--){
+            if (idleRenderers[i]->drawable.getWidth() == width && idleRenderers[i]->drawable.getHeight() == height){
+                PooledRenderer* result = idleRenderers[i];
+                idleRenderers.erase(idleRenderers.begin() + i);
+                idleRendererBytes -= getRendererBytes(width, height);
+                return result;
+            }
+        }
+    }
+
+    return new PooledRenderer(width, height);
+}
+
+// Return a renderer to the pool, freeing the least recently used idle renderers if the pool holds more than MAX_IDLE_RENDERER_BYTES
+void RenderService::releaseRenderer(PooledRenderer* theRenderer){
+    vector<PooledRenderer*> evictedRenderers;
+    {
+        std::lock_guard<std::mutex> poolLock(rendererPoolMutex);
+        idleRenderers.push_back(theRenderer);
+        idleRendererBytes += getRendererBytes(theRenderer->drawable.getWidth(), theRenderer->drawable.getHeight());
+
+        unsigned int numEvicted = 0;
+        while (idleRendererBytes > MAX_IDLE_RENDERER_BYTES){
+            PooledRenderer* evictedRenderer = idleRenderers[numEvicted++];
+            idleRendererBytes -= getRendererBytes(evictedRenderer->drawable.getWidth(), evictedRenderer->drawable.getHeight());
+            evictedRenderers.push_back(evictedRenderer);
+        }
+        idleRenderers.erase(idleRenderers.begin(), idleRenderers.begin() + numEvicted);
+    }
+
+    // Free the evicted renderers' buffers without holding up other requests:
+    for (auto evictedRenderer : evictedRenderers)
+        delete evictedRenderer;
+}
+
+// Estimate the buffer memory held by a renderer of a given resolution
+size_t RenderService::getRendererBytes(int width, int height){
+    // The frame buffer's float channels and quantized copy (20 bytes), the depth buffer (4), the drawable (4) and the renderer's per-pixel flags (2), rounded up:
+    return (size_t)width * height * 32;
+}
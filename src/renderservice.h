@@ -0,0 +1,127 @@
+// Render service object: Renders scenes on request, keeping parsed scenes and renderers warm between requests
+// By Adam Badke
+
+#ifndef RENDERSERVICE_H
+#define RENDERSERVICE_H
+
+#include "scene.h"
+#include "renderer.h"
+#include "offscreendrawable.h"
+
+// STL includes:
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+// A request to render a scene, with optional overrides of the scene's settings
+struct RenderRequest
+{
+    string sceneName;           // The .simp file to render. The ".simp" extension is optional
+    int width = 1000;           // Output resolution, in pixels
+    int height = 1000;
+    int tileSize = 64;          // Size of the square tiles the image is returned in. 0 = return the whole image as a single tile
+    bool isAntialiased = false; // Refine edge pixels with extra ray traced samples
+    RasterizerMode rasterizer = scanlineRasterizer; // How filled polygons are converted to pixels
+
+    // Overrides: Negative values leave the scene's own setting in place
+    int rayBounces = -1;        // Number of ray tracing bounces
+    int shadows = -1;           // 0 = disable shadow rays, 1 = enable them
+    int depthFog = -1;          // 0 = disable depth fog, 1 = enable it
+    int proxyRays = -1;         // Secondary rays traced against coarse proxies: 0 = none, 1 = shadow rays, 2 = shadow rays and later bounces (see ProxyRayMode)
+
+    // Parse a request from a line of text: The scene name, followed by any number of key=value options
+    // Eg. "04 width=640 height=480 bounces=2 shadows=0 fog=1 proxies=2 aa=1 raster=1 tile=32"
+    // Return: True if the request was parsed, false otherwise (with a description of the problem in error)
+    static bool parse(const string& line, RenderRequest* result, string* error);
+};
+
+// The result of rendering a request
+struct RenderResult
+{
+    bool succeeded = false;
+    string error;                   // Describes the failure, if the render did not succeed
+
+    int width = 0;
+    int height = 0;
+    vector<unsigned int> pixels;    // Packed ARGB pixels, in row-major order from the top left
+
+    bool wasSceneCached = false;    // Whether the scene was already loaded by an earlier request
+    double loadMilliseconds = 0;
+    double renderMilliseconds = 0;
+
+    size_t frameArenaPeakBytes = 0;     // Scratch memory used by the frame
+    size_t frameArenaReservedBytes = 0; // Scratch memory held by the renderer that drew the frame
+};
+
+class RenderService
+{
+public:
+    // Constructor
+    RenderService();
+
+    // Destructor
+    ~RenderService();
+
+    // Render a request. Thread safe: Any number of requests may be rendered concurrently
+    RenderResult render(const RenderRequest& request);
+
+    // Set the number of threads each ray cast request shares its primary rays between (see Renderer::setRayCastThreads()). 0 = one per core (the default)
+    // Callers rendering several requests at once should split the cores between them. Call before rendering
+    void setRayCastThreads(int numThreads);
+
+    // Upper bound on the resolution of a single request, in pixels per side
+    static const int MAX_RESOLUTION = 8192;
+
+    // Upper bound on the buffer memory held by idle renderers. The least recently used are freed once it's exceeded
+    static const size_t MAX_IDLE_RENDERER_BYTES = 512 * 1024 * 1024;
+
+private:
+    // Render services cannot be copied
+    RenderService(const RenderService&) = delete;
+    RenderService& operator=(const RenderService&) = delete;
+
+    // A renderer and the offscreen drawable it draws into. Kept between requests, so its buffers and world space geometry stay warm
+    struct PooledRenderer{
+        PooledRenderer(int width, int height);
+
+        OffscreenDrawable drawable;
+        Renderer renderer;
+    };
+
+    // Get a scene, loading it if it isn't cached or its files have changed since it was cached. Cached scenes are shared, not copied
+    // Return: True if the scene was found, false otherwise
+    bool getScene(const string& filename, std::shared_ptr<const Scene>* result, bool* wasCached);
+
+    // Get a cached scene, as long as none of the files it was built from have changed since it was cached
+    // Return: True if an up to date copy was cached, false otherwise
+    bool getCachedScene(const string& filename, std::shared_ptr<const Scene>* result);
+
+    // Take an idle renderer of a given resolution from the pool, creating one if none is available
+    PooledRenderer* acquireRenderer(int width, int height);
+
+    // Return a renderer to the pool, freeing the least recently used idle renderers if the pool holds more than MAX_IDLE_RENDERER_BYTES
+    void releaseRenderer(PooledRenderer* theRenderer);
+
+    // Estimate the buffer memory held by a renderer of a given resolution
+    static size_t getRendererBytes(int width, int height);
+
+    // Parsed scenes, by filename. Requests share them, so pooled renderers reuse their world space geometry for repeated scenes
+    map<string, std::shared_ptr<const Scene>> sceneCache;
+    std::mutex sceneCacheMutex;
+    std::mutex sceneLoadMutex;      // Serializes scene loading, so concurrent requests for the same scene don't write its snapshot at the same time
+
+    int rayCastThreads = 0;         // Applied to every renderer as it's acquired
+
+    // Idle renderers, least recently used first
+    vector<PooledRenderer*> idleRenderers;
+    size_t idleRendererBytes = 0;       // The estimated buffer memory held by the idle renderers
+    std::mutex rendererPoolMutex;
+};
+
+#endif // RENDERSERVICE_H
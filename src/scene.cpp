@@ -1,9 +1,14 @@
 #include "scene.h"
+#include <atomic>
+#include <utility>
+
+// The next geometry version to hand out. Shared by all scenes, so versions are never reused
+static std::atomic<unsigned int> nextGeometryVersion(1);
 
 // Constructor
 Scene::Scene()
 {
-    // Do nothing
+    geometryVersion = nextGeometryVersion++;
 }
 
 // Copy constructor
@@ -11,34 +16,21 @@ Scene::Scene(const Scene &rhs){
     this->theMeshes = rhs.theMeshes;
     this->theLights = rhs.theLights;
 
-    this->ambientRedIntensity = rhs.ambientRedIntensity;
-    this->ambientGreenIntensity = rhs.ambientGreenIntensity;
-    this->ambientBlueIntensity = rhs.ambientBlueIntensity;
-
-    this->xLow = rhs.xLow;
-    this->xHigh = rhs.xHigh;
-    this->yLow = rhs.yLow;
-    this->yHigh = rhs.yHigh;
-
-    this->camHither = rhs.camHither;
-    this->camYon = rhs.camYon;
-
-    this->cameraMovement = rhs.cameraMovement;
-
-    this->fogHither = rhs.fogHither;
-    this->fogYon = rhs.fogYon;
+    copySettings(rhs);
 
-    this->fogRedIntensity = rhs.fogRedIntensity;
-    this->fogGreenIntensity = rhs.fogGreenIntensity;
-    this->fogBlueIntensity = rhs.fogBlueIntensity;
-    this->fogColor = rhs.fogColor;
+    this->geometryVersion = rhs.geometryVersion;
+}
 
-    this->isDepthFogged = rhs.isDepthFogged;
+// Move constructor
+Scene::Scene(Scene&& rhs) noexcept {
+    this->theMeshes = std::move(rhs.theMeshes);
+    this->theLights = std::move(rhs.theLights);
 
-    this->environmentColor = rhs.environmentColor;
+    copySettings(rhs);
 
-    this->numRayBounces = rhs.numRayBounces;
-    this->noRayShadows = rhs.noRayShadows;
+    // The moved from scene no longer holds this geometry:
+    this->geometryVersion = rhs.geometryVersion;
+    rhs.geometryChanged();
 }
 
 // Overloaded assignment operator
@@ -49,6 +41,41 @@ Scene& Scene::operator=(const Scene& rhs){
     this->theMeshes = rhs.theMeshes;
     this->theLights = rhs.theLights;
 
+    copySettings(rhs);
+
+    this->geometryVersion = rhs.geometryVersion;
+
+    return *this;
+}
+
+// Overloaded move assignment operator
+Scene& Scene::operator=(Scene&& rhs) noexcept {
+    if (this == &rhs)
+        return *this;
+
+    this->theMeshes = std::move(rhs.theMeshes);
+    this->theLights = std::move(rhs.theLights);
+
+    copySettings(rhs);
+
+    // The moved from scene no longer holds this geometry:
+    this->geometryVersion = rhs.geometryVersion;
+    rhs.geometryChanged();
+
+    return *this;
+}
+
+// Get a copy of this scene's lights, camera and other settings, without its meshes
+Scene Scene::getSettings() const{
+    Scene result;
+    result.theLights = theLights;
+    result.copySettings(*this);
+
+    return result;
+}
+
+// Copy every setting of another scene: Everything but its meshes, lights and geometry version
+void Scene::copySettings(const Scene& rhs){
     this->ambientRedIntensity = rhs.ambientRedIntensity;
     this->ambientGreenIntensity = rhs.ambientGreenIntensity;
     this->ambientBlueIntensity = rhs.ambientBlueIntensity;
@@ -77,6 +104,20 @@ Scene& Scene::operator=(const Scene& rhs){
 
     this->numRayBounces = rhs.numRayBounces;
     this->noRayShadows = rhs.noRayShadows;
+    this->bounceCutoff = rhs.bounceCutoff;
+    this->lightCutoff = rhs.lightCutoff;
 
-    return *this;
+    this->lodThreshold = rhs.lodThreshold;
+    this->lodHysteresis = rhs.lodHysteresis;
+    this->proxyRays = rhs.proxyRays;
+}
+
+// Mark this scene's meshes as modified
+void Scene::geometryChanged(){
+    geometryVersion = nextGeometryVersion++;
+}
+
+// Get this scene's geometry version
+unsigned int Scene::getGeometryVersion() const{
+    return geometryVersion;
 }
@@ -8,6 +8,13 @@
 #include "mesh.h"
 #include "light.h"
 
+// Proxy ray enumerator: Selects the secondary rays that are traced against a coarse proxy of each mesh (its coarsest level of detail), rather than the level that is drawn
+enum ProxyRayMode{
+    noProxyRays = 0,            // Every ray sees the drawn geometry
+    proxyShadowRays = 1,        // Shadow rays only
+    proxySecondaryRays = 2      // Shadow rays, and reflection rays after the first bounce
+};
+
 class Scene
 {
 public:
@@ -17,9 +24,26 @@ public:
     // Copy constructor
     Scene(const Scene &rhs);
 
+    // Move constructor
+    Scene(Scene&& rhs) noexcept;
+
     // Overloaded assignment operator
     Scene& operator=(const Scene& rhs);
 
+    // Overloaded move assignment operator
+    Scene& operator=(Scene&& rhs) noexcept;
+
+    // Mark this scene's meshes as modified. Renderers keep their own copy of a scene's world space geometry between renders, and only refresh it when the geometry version changes
+    // Call this after editing theMeshes of a scene that has already been rendered. Camera, light and other setting changes don't need it
+    void geometryChanged();
+
+    // Get this scene's geometry version: Unique to this scene's meshes, and shared by copies of it
+    unsigned int getGeometryVersion() const;
+
+    // Get a copy of this scene's lights, camera and other settings, without its meshes. The copy has its own (empty) geometry version
+    // Used with Renderer::renderScene() to override a shared scene's settings without copying its meshes
+    Scene getSettings() const;
+
     vector<Mesh> theMeshes;     // Contains our meshes
     vector<Light> theLights;    // Contains our lights
 
@@ -53,6 +77,19 @@ public:
     // Scene ray trace settings:
     int numRayBounces = 0;          // Default number of bounces when ray tracing. Default = 0 (ie. No ray tracing)
     bool noRayShadows = false;      // Whether or not to use shadow rays. Default = false (ie. Calculate shadows). Shadows can be disabled with "noshadows" command in the .simp file
+    double bounceCutoff = 0.5 / 255;    // Bounce rays aren't traced once the product of the reflectivities along their path falls to this, as they can't change a pixel by more. Set with the "bouncecutoff" command in the .simp file. Default = half of an 8 bit color step
+    double lightCutoff = 0.5 / 255;     // Lights aren't evaluated or shadow tested at points they can't add more than this to. Set with the "lightcutoff" command in the .simp file. Default = half of an 8 bit color step. 0 = Always evaluate every light
+
+    // Level of detail settings: Set with the "lod" command in the .simp file
+    double lodThreshold = 100;      // Meshes drop to their next coarser level each time their projected size halves below this many pixels
+    double lodHysteresis = 0.15;    // How far past a threshold (as a fraction of it) a mesh's size must move before its level changes. Stops meshes flickering between levels
+    ProxyRayMode proxyRays = noProxyRays;   // Secondary rays traced against coarse proxies. Set with the "proxyrays" command in the .simp file. A mesh's own surface is always traced at its drawn detail
+
+private:
+    // Copy every setting of another scene: Everything but its meshes, lights and geometry version
+    void copySettings(const Scene& rhs);
+
+    unsigned int geometryVersion;   // Identifies the current contents of theMeshes
 };
 
 #endif // SCENE_H
@@ -0,0 +1,628 @@
+// Scene snapshot object: Saves fully built scenes to a versioned binary file, and loads them back by memory mapping it
+// By Adam Badke
+
+#include "scenesnapshot.h"
+
+// STL includes:
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+// Platform memory mapping:
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+using std::ofstream;
+
+// Identifies a snapshot file, and the byte order it was written with
+const char SNAPSHOT_MAGIC[8] = {'S', 'I', 'M', 'P', 'S', 'N', 'A', 'P'};
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// Snapshot writing and reading helpers
+//*************************************
+
+// Accumulates a snapshot in memory, so it can be written to disk in a single call
+class SnapshotWriter
+{
+public:
+    // Append a fixed size value
+    template <typename T>
+    void write(T value){
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    // Append a length prefixed string
+    void writeString(const string& value){
+        write<uint32_t>((uint32_t)value.size());
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    vector<char> buffer;
+};
+
+// Reads values from a snapshot in memory. Every read is bounds checked: Reading past the end fails, rather than crashing on truncated files
+class SnapshotReader
+{
+public:
+    // Constructor
+    SnapshotReader(const char* newData, size_t newSize) : data(newData), size(newSize), position(0), failed(false) {}
+
+    // Read a fixed size value
+    // Return: The value read, or a zeroed value if the snapshot is too short
+    template <typename T>
+    T read(){
+        T value;
+        if (!checkRemaining(sizeof(T))){
+            std::memset(&value, 0, sizeof(T));
+            return value;
+        }
+        std::memcpy(&value, data + position, sizeof(T)); // Values are unaligned in the file
+        position += sizeof(T);
+        return value;
+    }
+
+    // Read a length prefixed string
+    string readString(){
+        uint32_t length = read<uint32_t>();
+        if (!checkRemaining(length))
+            return string();
+        string value(data + position, length);
+        position += length;
+        return value;
+    }
+
+    // Read an element count, ensuring the snapshot is large enough to hold that many elements of a minimum size
+    // Return: The count, or 0 if it cannot be valid
+    uint32_t readCount(size_t minimumElementSize){
+        uint32_t count = read<uint32_t>();
+        if (!checkRemaining((size_t)count * minimumElementSize))
+            return 0;
+        return count;
+    }
+
+    // Check whether any read has failed
+    bool hasFailed() const{
+        return failed;
+    }
+
+    // Check whether every byte has been read
+    bool isFinished() const{
+        return position == size;
+    }
+
+private:
+    // Check that the snapshot holds at least numBytes more bytes, and record a failure if it does not
+    bool checkRemaining(size_t numBytes){
+        if (failed || numBytes > size - position){
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    const char* data;
+    size_t size;
+    size_t position;
+    bool failed;
+};
+
+// A read-only view of an entire file, mapped into memory. Unmapped when destroyed
+class MappedFile
+{
+public:
+    // Constructor: Map a file. Check getData() for success
+    MappedFile(const string& filename);
+
+    // Destructor
+    ~MappedFile();
+
+    // Get the mapped contents, or nullptr if the file could not be mapped
+    const char* getData() const{
+        return data;
+    }
+
+    // Get the size of the mapped file, in bytes
+    size_t getSize() const{
+        return size;
+    }
+
+private:
+    // Mapped files cannot be copied
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = NULL;
+#endif
+};
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string& filename){
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+        return;
+
+    mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle == NULL)
+        return;
+
+    data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (data != nullptr)
+        size = (size_t)fileSize.QuadPart;
+}
+
+MappedFile::~MappedFile(){
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mappingHandle != NULL)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+}
+
+#else // POSIX:
+
+MappedFile::MappedFile(const string& filename){
+    int fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+        return;
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) == 0 && fileStatus.st_size > 0){
+        void* mapping = mmap(nullptr, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (mapping != MAP_FAILED){
+            data = static_cast<const char*>(mapping);
+            size = (size_t)fileStatus.st_size;
+        }
+    }
+
+    close(fileDescriptor); // The mapping remains valid after the file is closed
+}
+
+MappedFile::~MappedFile(){
+    if (data != nullptr)
+        munmap(const_cast<char*>(data), size);
+}
+
+#endif // _WIN32
+
+// Get the size and modification time of a file, used to detect when a dependency has changed
+// Return: True if the file exists, false otherwise (in which case size and modificationTime are set to -1)
+static bool getFileStamp(const string& filename, int64_t* size, int64_t* modificationTime){
+    struct stat fileStatus;
+    if (stat(filename.c_str(), &fileStatus) != 0){
+        *size = -1;
+        *modificationTime = -1;
+        return false;
+    }
+
+    *size = (int64_t)fileStatus.st_size;
+    *modificationTime = (int64_t)fileStatus.st_mtime;
+    return true;
+}
+
+// Write a polygon, including its material
+static void writePolygon(SnapshotWriter* writer, Polygon* thePolygon){
+    writer->write<uint32_t>((uint32_t)thePolygon->getVertexCount());
+    for (int i = 0; i < thePolygon->getVertexCount(); i++){
+        Vertex* currentVertex = &thePolygon->vertices[i];
+        writer->write<double>(currentVertex->x);
+        writer->write<double>(currentVertex->y);
+        writer->write<double>(currentVertex->z);
+        writer->write<uint32_t>(currentVertex->color);
+        writer->write<double>(currentVertex->normal.xn);
+        writer->write<double>(currentVertex->normal.yn);
+        writer->write<double>(currentVertex->normal.zn);
+    }
+
+    writer->write<double>(thePolygon->faceNormal.xn);
+    writer->write<double>(thePolygon->faceNormal.yn);
+    writer->write<double>(thePolygon->faceNormal.zn);
+
+    writer->write<uint8_t>(thePolygon->isAffectedByAmbientLight() ? 1 : 0);
+    writer->write<int32_t>((int32_t)thePolygon->getShadingModel());
+    writer->write<double>(thePolygon->getSpecularCoefficient());
+    writer->write<double>(thePolygon->getSpecularExponent());
+    writer->write<double>(thePolygon->getReflectivity());
+}
+
+// Size of a single vertex in a snapshot
+const size_t SNAPSHOT_VERTEX_SIZE = 6 * sizeof(double) + sizeof(uint32_t);
+
+// Size of a polygon with no vertices in a snapshot
+const size_t SNAPSHOT_POLYGON_SIZE = sizeof(uint32_t) + 6 * sizeof(double) + sizeof(uint8_t) + sizeof(int32_t);
+
+// Read a polygon, including its material
+static void readPolygon(SnapshotReader* reader, Polygon* result){
+    uint32_t vertexCount = reader->readCount(SNAPSHOT_VERTEX_SIZE);
+    for (uint32_t i = 0; i < vertexCount; i++){
+        double x = reader->read<double>();
+        double y = reader->read<double>();
+        double z = reader->read<double>();
+        Vertex currentVertex(x, y, z, reader->read<uint32_t>(), (int)i);
+        currentVertex.normal.xn = reader->read<double>();
+        currentVertex.normal.yn = reader->read<double>();
+        currentVertex.normal.zn = reader->read<double>();
+
+        result->addVertex(currentVertex);
+    }
+
+    result->faceNormal.xn = reader->read<double>();
+    result->faceNormal.yn = reader->read<double>();
+    result->faceNormal.zn = reader->read<double>();
+
+    result->setAffectedByAmbientLight(reader->read<uint8_t>() != 0);
+    result->setShadingModel((ShadingModel)reader->read<int32_t>());
+    result->setSpecularCoefficient(reader->read<double>());
+    result->setSpecularExponent(reader->read<double>());
+    result->setReflectivity(reader->read<double>());
+}
+
+// Write a collection of polygons
+static void writePolygons(SnapshotWriter* writer, vector<Polygon>* thePolygons){
+    writer->write<uint32_t>((uint32_t)thePolygons->size());
+    for (auto &currentPolygon : *thePolygons)
+        writePolygon(writer, &currentPolygon);
+}
+
+// Read a collection of polygons
+static void readPolygons(SnapshotReader* reader, vector<Polygon>* result){
+    uint32_t polygonCount = reader->readCount(SNAPSHOT_POLYGON_SIZE);
+    result->resize(polygonCount);
+    for (uint32_t i = 0; i < polygonCount && !reader->hasFailed(); i++)
+        readPolygon(reader, &(*result)[i]);
+}
+
+// Write the clusters of each of a mesh's levels of detail, and the cluster each face belongs to
+static void writeClusters(SnapshotWriter* writer, Mesh* theMesh){
+    writer->write<uint32_t>((uint32_t)theMesh->clusters.size());
+    for (unsigned int level = 0; level < theMesh->clusters.size(); level++){
+        writer->write<uint32_t>((uint32_t)theMesh->clusters[level].size());
+        for (auto &currentCluster : theMesh->clusters[level]){
+            writer->write<uint32_t>(currentCluster.numFaces);
+            writer->write<double>(currentCluster.center.x);
+            writer->write<double>(currentCluster.center.y);
+            writer->write<double>(currentCluster.center.z);
+            writer->write<double>(currentCluster.radius);
+            writer->write<double>(currentCluster.coneAxis.xn);
+            writer->write<double>(currentCluster.coneAxis.yn);
+            writer->write<double>(currentCluster.coneAxis.zn);
+            writer->write<double>(currentCluster.coneCutoff);
+        }
+
+        writer->write<uint32_t>((uint32_t)theMesh->faceClusters[level].size());
+        for (auto clusterIndex : theMesh->faceClusters[level])
+            writer->write<uint32_t>(clusterIndex);
+    }
+}
+
+// Size of a single cluster in a snapshot
+const size_t SNAPSHOT_CLUSTER_SIZE = sizeof(uint32_t) + 8 * sizeof(double);
+
+// Read the clusters of each of a mesh's levels of detail. The mesh's faces and levels of detail must already have been read
+// Return: True if the clusters were read and match the mesh's faces, false otherwise
+static bool readClusters(SnapshotReader* reader, Mesh* result){
+    uint32_t levelCount = reader->readCount(2 * sizeof(uint32_t));
+    if (levelCount != 0 && levelCount != (uint32_t)result->getLodCount())
+        return false;
+
+    result->clusters.resize(levelCount);
+    result->faceClusters.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount && !reader->hasFailed(); level++){
+        vector<MeshCluster>& levelClusters = result->clusters[level];
+        levelClusters.resize(reader->readCount(SNAPSHOT_CLUSTER_SIZE));
+        for (auto &currentCluster : levelClusters){
+            currentCluster.numFaces = reader->read<uint32_t>();
+            double x = reader->read<double>();
+            double y = reader->read<double>();
+            double z = reader->read<double>();
+            currentCluster.center = Vertex(x, y, z);
+            currentCluster.radius = reader->read<double>();
+            currentCluster.coneAxis.xn = reader->read<double>();
+            currentCluster.coneAxis.yn = reader->read<double>();
+            currentCluster.coneAxis.zn = reader->read<double>();
+            currentCluster.coneCutoff = reader->read<double>();
+        }
+
+        // Every face must belong to one of the level's clusters:
+        vector<unsigned int>& levelFaceClusters = result->faceClusters[level];
+        levelFaceClusters.resize(reader->readCount(sizeof(uint32_t)));
+        size_t levelFaceCount = level == 0 ? result->faces.size() : result->lodLevels[level - 1].size();
+        if (levelFaceClusters.size() != levelFaceCount && !reader->hasFailed())
+            return false;
+
+        for (auto &clusterIndex : levelFaceClusters){
+            clusterIndex = reader->read<uint32_t>();
+            if (clusterIndex >= levelClusters.size() && !reader->hasFailed())
+                return false;
+        }
+    }
+
+    return !reader->hasFailed();
+}
+
+// Write a snapshot's header and dependency list, stamping each dependency with its current size and modification time
+static void writeHeader(SnapshotWriter* writer, const vector<string>& dependencies){
+    writer->buffer.insert(writer->buffer.end(), SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + sizeof(SNAPSHOT_MAGIC));
+    writer->write<uint32_t>(SNAPSHOT_BYTE_ORDER);
+    writer->write<uint32_t>(SCENE_SNAPSHOT_VERSION);
+
+    writer->write<uint32_t>((uint32_t)dependencies.size());
+    for (auto &currentDependency : dependencies){
+        int64_t size, modificationTime;
+        getFileStamp(currentDependency, &size, &modificationTime);
+
+        writer->writeString(currentDependency);
+        writer->write<int64_t>(size);
+        writer->write<int64_t>(modificationTime);
+    }
+}
+
+// Write a finished snapshot to disk in a single call
+// Return: True if the file was written, false otherwise
+static bool writeFile(SnapshotWriter* writer, const string& filename){
+    ofstream output(filename, std::ios::binary | std::ios::trunc);
+    if (!output.is_open())
+        return false;
+    output.write(writer->buffer.data(), (std::streamsize)writer->buffer.size());
+
+    return output.good();
+}
+
+// Read and validate a snapshot's header and dependency list
+// Return: True if the snapshot is from the current format version and none of its dependencies have changed. The reader is left at the start of the scene data
+static bool readHeader(SnapshotReader* reader){
+
+    // Validate the header:
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    for (unsigned int i = 0; i < sizeof(SNAPSHOT_MAGIC); i++)
+        magic[i] = reader->read<char>();
+    if (std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+        || reader->read<uint32_t>() != SNAPSHOT_BYTE_ORDER
+        || reader->read<uint32_t>() != SCENE_SNAPSHOT_VERSION)
+        return false;
+
+    // Ensure no dependency has changed since the snapshot was written:
+    uint32_t dependencyCount = reader->readCount(sizeof(uint32_t) + 2 * sizeof(int64_t));
+    for (uint32_t i = 0; i < dependencyCount; i++){
+        string currentDependency = reader->readString();
+        int64_t snapshotSize = reader->read<int64_t>();
+        int64_t snapshotModificationTime = reader->read<int64_t>();
+
+        int64_t size, modificationTime;
+        getFileStamp(currentDependency, &size, &modificationTime);
+        if (reader->hasFailed() || size != snapshotSize || modificationTime != snapshotModificationTime)
+            return false;
+    }
+
+    return !reader->hasFailed();
+}
+
+// SceneSnapshot functions
+//************************
+
+// Save a fully built scene: Lights, camera, materials, processed geometry and bounding boxes
+bool SceneSnapshot::save(Scene* theScene, const vector<string>& dependencies, const string& snapshotFilename){
+    SnapshotWriter writer;
+
+    // Header, and dependencies:
+    writeHeader(&writer, dependencies);
+
+    // Ambient lighting:
+    writer.write<double>(theScene->ambientRedIntensity);
+    writer.write<double>(theScene->ambientGreenIntensity);
+    writer.write<double>(theScene->ambientBlueIntensity);
+
+    // Camera:
+    writer.write<double>(theScene->xLow);
+    writer.write<double>(theScene->xHigh);
+    writer.write<double>(theScene->yLow);
+    writer.write<double>(theScene->yHigh);
+    writer.write<double>(theScene->camHither);
+    writer.write<double>(theScene->camYon);
+    for (int row = 0; row < theScene->cameraMovement.size(); row++)
+        for (int col = 0; col < theScene->cameraMovement.size(); col++)
+            writer.write<double>(theScene->cameraMovement.arrayVal(row, col));
+
+    // Distance fog:
+    writer.write<double>(theScene->fogHither);
+    writer.write<double>(theScene->fogYon);
+    writer.write<double>(theScene->fogRedIntensity);
+    writer.write<double>(theScene->fogGreenIntensity);
+    writer.write<double>(theScene->fogBlueIntensity);
+    writer.write<uint32_t>(theScene->fogColor);
+    writer.write<uint8_t>(theScene->isDepthFogged ? 1 : 0);
+
+    // Ray tracing settings:
+    writer.write<uint32_t>(theScene->environmentColor);
+    writer.write<int32_t>(theScene->numRayBounces);
+    writer.write<uint8_t>(theScene->noRayShadows ? 1 : 0);
+    writer.write<double>(theScene->bounceCutoff);
+    writer.write<double>(theScene->lightCutoff);
+
+    // Level of detail settings:
+    writer.write<double>(theScene->lodThreshold);
+    writer.write<double>(theScene->lodHysteresis);
+    writer.write<int32_t>((int32_t)theScene->proxyRays);
+
+    // Lights:
+    writer.write<uint32_t>((uint32_t)theScene->theLights.size());
+    for (auto &currentLight : theScene->theLights){
+        writer.write<double>(currentLight.position.x);
+        writer.write<double>(currentLight.position.y);
+        writer.write<double>(currentLight.position.z);
+        writer.write<double>(currentLight.redIntensity);
+        writer.write<double>(currentLight.greenIntensity);
+        writer.write<double>(currentLight.blueIntensity);
+        writer.write<double>(currentLight.attenuationA);
+        writer.write<double>(currentLight.attenuationB);
+    }
+
+    // Meshes, with their levels of detail, bounding boxes and clusters:
+    writer.write<uint32_t>((uint32_t)theScene->theMeshes.size());
+    for (auto &currentMesh : theScene->theMeshes){
+        writer.write<uint8_t>(currentMesh.isWireframe ? 1 : 0);
+        writePolygons(&writer, &currentMesh.faces);
+
+        writer.write<uint32_t>((uint32_t)currentMesh.lodLevels.size());
+        for (auto &currentLevel : currentMesh.lodLevels)
+            writePolygons(&writer, &currentLevel);
+
+        writePolygons(&writer, &currentMesh.boundingBoxFaces);
+        writeClusters(&writer, &currentMesh);
+    }
+
+    return writeFile(&writer, snapshotFilename);
+}
+
+// Load a scene from a snapshot
+bool SceneSnapshot::load(const string& snapshotFilename, Scene* result){
+    MappedFile snapshotFile(snapshotFilename);
+    if (snapshotFile.getData() == nullptr)
+        return false;
+
+    SnapshotReader reader(snapshotFile.getData(), snapshotFile.getSize());
+    if (!readHeader(&reader))
+        return false;
+
+    // Build the scene:
+    Scene theScene;
+
+    // Ambient lighting:
+    theScene.ambientRedIntensity = reader.read<double>();
+    theScene.ambientGreenIntensity = reader.read<double>();
+    theScene.ambientBlueIntensity = reader.read<double>();
+
+    // Camera:
+    theScene.xLow = reader.read<double>();
+    theScene.xHigh = reader.read<double>();
+    theScene.yLow = reader.read<double>();
+    theScene.yHigh = reader.read<double>();
+    theScene.camHither = reader.read<double>();
+    theScene.camYon = reader.read<double>();
+    for (int row = 0; row < theScene.cameraMovement.size(); row++)
+        for (int col = 0; col < theScene.cameraMovement.size(); col++)
+            theScene.cameraMovement.arrayVal(row, col) = reader.read<double>();
+
+    // Distance fog:
+    theScene.fogHither = reader.read<double>();
+    theScene.fogYon = reader.read<double>();
+    theScene.fogRedIntensity = reader.read<double>();
+    theScene.fogGreenIntensity = reader.read<double>();
+    theScene.fogBlueIntensity = reader.read<double>();
+    theScene.fogColor = reader.read<uint32_t>();
+    theScene.isDepthFogged = reader.read<uint8_t>() != 0;
+
+    // Ray tracing settings:
+    theScene.environmentColor = reader.read<uint32_t>();
+    theScene.numRayBounces = reader.read<int32_t>();
+    theScene.noRayShadows = reader.read<uint8_t>() != 0;
+    theScene.bounceCutoff = reader.read<double>();
+    theScene.lightCutoff = reader.read<double>();
+
+    // Level of detail settings:
+    theScene.lodThreshold = reader.read<double>();
+    theScene.lodHysteresis = reader.read<double>();
+    theScene.proxyRays = (ProxyRayMode)reader.read<int32_t>();
+
+    // Lights:
+    uint32_t lightCount = reader.readCount(8 * sizeof(double));
+    theScene.theLights.resize(lightCount);
+    for (auto &currentLight : theScene.theLights){
+        double x = reader.read<double>();
+        double y = reader.read<double>();
+        double z = reader.read<double>();
+        currentLight.position = Vertex(x, y, z);
+        currentLight.redIntensity = reader.read<double>();
+        currentLight.greenIntensity = reader.read<double>();
+        currentLight.blueIntensity = reader.read<double>();
+        currentLight.attenuationA = reader.read<double>();
+        currentLight.attenuationB = reader.read<double>();
+    }
+
+    // Meshes, with their levels of detail, bounding boxes and clusters:
+    uint32_t meshCount = reader.readCount(sizeof(uint8_t) + 4 * sizeof(uint32_t));
+    theScene.theMeshes.resize(meshCount);
+    for (uint32_t i = 0; i < meshCount && !reader.hasFailed(); i++){
+        theScene.theMeshes[i].isWireframe = reader.read<uint8_t>() != 0;
+        readPolygons(&reader, &theScene.theMeshes[i].faces);
+
+        uint32_t lodCount = reader.readCount(sizeof(uint32_t));
+        theScene.theMeshes[i].lodLevels.resize(lodCount);
+        for (uint32_t j = 0; j < lodCount && !reader.hasFailed(); j++)
+            readPolygons(&reader, &theScene.theMeshes[i].lodLevels[j]);
+
+        readPolygons(&reader, &theScene.theMeshes[i].boundingBoxFaces);
+        if (!readClusters(&reader, &theScene.theMeshes[i]))
+            return false;
+    }
+
+    // Only accept snapshots that were read completely, with nothing left over:
+    if (reader.hasFailed() || !reader.isFinished())
+        return false;
+
+    *result = std::move(theScene);
+    return true;
+}
+
+// Check whether a snapshot is up to date, reading only its header
+bool SceneSnapshot::isUpToDate(const string& snapshotFilename){
+    MappedFile snapshotFile(snapshotFilename);
+    if (snapshotFile.getData() == nullptr)
+        return false;
+
+    SnapshotReader reader(snapshotFile.getData(), snapshotFile.getSize());
+    return readHeader(&reader);
+}
+
+// Save the generated levels of detail of an obj
+bool SceneSnapshot::saveMeshLevels(vector<vector<Polygon>>* levels, const string& objFilename, const string& settingsKey, const string& cacheFilename){
+    SnapshotWriter writer;
+
+    writeHeader(&writer, vector<string>(1, objFilename));
+    writer.writeString(settingsKey);
+
+    writer.write<uint32_t>((uint32_t)levels->size());
+    for (auto &currentLevel : *levels)
+        writePolygons(&writer, &currentLevel);
+
+    return writeFile(&writer, cacheFilename);
+}
+
+// Load the levels of detail of an obj
+bool SceneSnapshot::loadMeshLevels(const string& cacheFilename, const string& settingsKey, vector<vector<Polygon>>* result){
+    MappedFile cacheFile(cacheFilename);
+    if (cacheFile.getData() == nullptr)
+        return false;
+
+    SnapshotReader reader(cacheFile.getData(), cacheFile.getSize());
+    if (!readHeader(&reader) || reader.readString() != settingsKey)
+        return false;
+
+    vector<vector<Polygon>> levels(reader.readCount(sizeof(uint32_t)));
+    for (uint32_t i = 0; i < levels.size() && !reader.hasFailed(); i++)
+        readPolygons(&reader, &levels[i]);
+
+    if (reader.hasFailed() || !reader.isFinished())
+        return false;
+
+    *result = std::move(levels);
+    return true;
+}
@@ -0,0 +1,47 @@
+// Scene snapshot object: Saves fully built scenes to a versioned binary file, and loads them back by memory mapping it
+// By Adam Badke
+
+#ifndef SCENESNAPSHOT_H
+#define SCENESNAPSHOT_H
+
+#include "scene.h"
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Appended to a .simp filename to get the name of its snapshot
+const string SCENE_SNAPSHOT_EXTENSION = ".snapshot";
+
+// Appended to an .obj filename to get the name of its cache of generated levels of detail
+const string MESH_LEVELS_EXTENSION = ".lod" + SCENE_SNAPSHOT_EXTENSION;
+
+// Snapshot format version. Increment this whenever the snapshot layout, or the way scenes are built from .simp/.obj files, changes
+const unsigned int SCENE_SNAPSHOT_VERSION = 7;
+
+class SceneSnapshot
+{
+public:
+    // Save a fully built scene: Lights, camera, materials, processed geometry and bounding boxes
+    // dependencies are the files the scene was built from. The snapshot is invalidated if any of them change
+    // Return: True if the snapshot was written, false otherwise
+    static bool save(Scene* theScene, const vector<string>& dependencies, const string& snapshotFilename);
+
+    // Load a scene from a snapshot
+    // Return: True if the snapshot was loaded into result. False if it is missing, malformed, from another format version, or any of its dependencies have changed
+    static bool load(const string& snapshotFilename, Scene* result);
+
+    // Check whether a snapshot exists, is from the current format version, and none of its dependencies have changed. Cheaper than load(): Only the header is read
+    static bool isUpToDate(const string& snapshotFilename);
+
+    // Save the generated levels of detail of an obj, so they needn't be simplified again. settingsKey identifies the settings they were generated with
+    // Return: True if the levels were written, false otherwise
+    static bool saveMeshLevels(vector<vector<Polygon>>* levels, const string& objFilename, const string& settingsKey, const string& cacheFilename);
+
+    // Load the levels of detail of an obj
+    // Return: True if the levels were loaded into result. False if the cache is missing, malformed, from another format version, was generated with other settings, or the obj has changed
+    static bool loadMeshLevels(const string& cacheFilename, const string& settingsKey, vector<vector<Polygon>>* result);
+};
+
+#endif // SCENESNAPSHOT_H
@@ -0,0 +1,282 @@
+// Span kernel: Depth tests groups of 8 adjacent scanline pixels at once, vectorized with AVX2 or SSE2 (selected at runtime), with a scalar fallback
+// By Adam Badke
+
+#include "spankernel.h"
+
+// Use SSE2 wherever the compiler targets it (always the case for x86-64):
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SPAN_KERNEL_USE_SSE
+    #include <emmintrin.h>
+#endif
+
+// Compile the AVX2 kernels wherever the compiler can target them per function. They are only called if the CPU supports them
+#if defined(SPAN_KERNEL_USE_SSE) && (defined(__GNUC__) || defined(__clang__))
+    #define SPAN_KERNEL_USE_AVX2
+    #define SPAN_KERNEL_AVX2_TARGET __attribute__((target("avx2")))
+    #include <immintrin.h>
+#elif defined(SPAN_KERNEL_USE_SSE) && defined(_MSC_VER)
+    #define SPAN_KERNEL_USE_AVX2
+    #define SPAN_KERNEL_AVX2_TARGET
+    #include <immintrin.h>
+    #include <intrin.h>
+#endif
+
+// Detect the widest instruction set supported by both the compiler and the CPU
+static SpanKernelLevel detectSpanKernelLevel(){
+#ifdef SPAN_KERNEL_USE_AVX2
+    #ifdef _MSC_VER
+        // AVX2 needs both the CPU feature, and the OS to save the YMM registers:
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] >= 7){
+            __cpuid(info, 1);
+            bool isOSSaved = (info[2] & (1 << 27)) && (info[2] & (1 << 28)); // OSXSAVE and AVX
+            if (isOSSaved && (_xgetbv(0) & 6) == 6){
+                __cpuidex(info, 7, 0);
+                if (info[1] & (1 << 5))
+                    return spanKernelAVX2;
+            }
+        }
+    #else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return spanKernelAVX2;
+    #endif
+#endif
+
+#ifdef SPAN_KERNEL_USE_SSE
+    return spanKernelSSE2;
+#else
+    return spanKernelScalar;
+#endif
+}
+
+// Get the widest instruction set supported by both the compiler and the CPU
+SpanKernelLevel getSupportedSpanKernelLevel(){
+    static const SpanKernelLevel supportedLevel = detectSpanKernelLevel();
+    return supportedLevel;
+}
+
+// The instruction set selected for the kernels
+static SpanKernelLevel& getSelectedLevel(){
+    static SpanKernelLevel selectedLevel = getSupportedSpanKernelLevel();
+    return selectedLevel;
+}
+
+// Get the instruction set used by the kernels
+SpanKernelLevel getSpanKernelLevel(){
+    return getSelectedLevel();
+}
+
+// Set the instruction set used by the kernels
+void setSpanKernelLevel(SpanKernelLevel level){
+    if (level > getSupportedSpanKernelLevel())
+        level = getSupportedSpanKernelLevel();
+
+    getSelectedLevel() = level;
+}
+
+// Get the name of an instruction set
+const char* getSpanKernelLevelName(SpanKernelLevel level){
+    switch (level){
+    case spanKernelAVX2:
+        return "AVX2";
+    case spanKernelSSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+// Get the mask of the lanes from firstLane to lastLane
+unsigned int getSpanLaneMask(int firstLane, int lastLane){
+    if (firstLane < 0)
+        firstLane = 0;
+    if (lastLane > SPAN_KERNEL_WIDTH - 1)
+        lastLane = SPAN_KERNEL_WIDTH - 1;
+    if (firstLane > lastLane)
+        return 0;
+
+    return ((1u << (lastLane + 1)) - 1) & ~((1u << firstLane) - 1);
+}
+
+// Scalar kernels: Each lane is interpolated directly from the first pixel of the scanline, with the same operations in the same order as the vector kernels
+//**********************************************************************************************************************************************************
+
+static unsigned int depthTestSpanGroupScalar(const SpanGroup& group, const float* storedDepths, double* correctZ, float* scaledDepths){
+    unsigned int visibleMask = 0;
+    for (int i = 0; i < SPAN_KERNEL_WIDTH; i++){
+        correctZ[i] = 1.0 / (group.inverseZ + group.inverseZStep * (group.firstLaneOffset + i));
+        scaledDepths[i] = (float)( (correctZ[i] - group.depthHither) / group.depthRange );
+
+        if (scaledDepths[i] < storedDepths[i])
+            visibleMask |= 1u << i;
+    }
+
+    return visibleMask & group.laneMask;
+}
+
+static void writeSpanGroupDepthsScalar(unsigned int mask, const float* scaledDepths, float* storedDepths){
+    for (int i = 0; i < SPAN_KERNEL_WIDTH; i++){
+        if (mask & (1u << i))
+            storedDepths[i] = scaledDepths[i];
+    }
+}
+
+// SSE2 kernels: 2 doubles or 4 floats per register
+//*************************************************
+
+#ifdef SPAN_KERNEL_USE_SSE
+
+static unsigned int depthTestSpanGroupSSE2(const SpanGroup& group, const float* storedDepths, double* correctZ, float* scaledDepths){
+    __m128d inverseZ = _mm_set1_pd(group.inverseZ);
+    __m128d inverseZStep = _mm_set1_pd(group.inverseZStep);
+    __m128d firstLaneOffset = _mm_set1_pd(group.firstLaneOffset);
+    __m128d depthHither = _mm_set1_pd(group.depthHither);
+    __m128d depthRange = _mm_set1_pd(group.depthRange);
+    __m128d one = _mm_set1_pd(1.0);
+
+    unsigned int visibleMask = 0;
+    for (int i = 0; i < SPAN_KERNEL_WIDTH; i += 4){
+        // Interpolate, and scale the depths of 4 lanes as 2 pairs:
+        __m128d lowOffsets = _mm_add_pd(firstLaneOffset, _mm_setr_pd(i, i + 1));      // Whole numbers, so these sums are exact
+        __m128d highOffsets = _mm_add_pd(firstLaneOffset, _mm_setr_pd(i + 2, i + 3));
+        __m128d lowZ = _mm_div_pd( one, _mm_add_pd(inverseZ, _mm_mul_pd(inverseZStep, lowOffsets)) );
+        __m128d highZ = _mm_div_pd( one, _mm_add_pd(inverseZ, _mm_mul_pd(inverseZStep, highOffsets)) );
+        _mm_storeu_pd(&correctZ[i], lowZ);
+        _mm_storeu_pd(&correctZ[i + 2], highZ);
+
+        __m128 depths = _mm_movelh_ps( _mm_cvtpd_ps( _mm_div_pd(_mm_sub_pd(lowZ, depthHither), depthRange) ),
+                                       _mm_cvtpd_ps( _mm_div_pd(_mm_sub_pd(highZ, depthHither), depthRange) ) );
+        _mm_storeu_ps(&scaledDepths[i], depths);
+
+        // Depth test:
+        visibleMask |= (unsigned int)_mm_movemask_ps( _mm_cmplt_ps(depths, _mm_loadu_ps(&storedDepths[i])) ) << i;
+    }
+
+    return visibleMask & group.laneMask;
+}
+
+static void writeSpanGroupDepthsSSE2(unsigned int mask, const float* scaledDepths, float* storedDepths){
+    __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+
+    for (int i = 0; i < SPAN_KERNEL_WIDTH; i += 4){
+        // Expand the lanes' bits into a select mask, and blend the new depths over the stored ones:
+        __m128 isWritten = _mm_castsi128_ps( _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)(mask >> i)), laneBits), laneBits) );
+        __m128 blended = _mm_or_ps( _mm_and_ps(isWritten, _mm_loadu_ps(&scaledDepths[i])), _mm_andnot_ps(isWritten, _mm_loadu_ps(&storedDepths[i])) );
+        _mm_storeu_ps(&storedDepths[i], blended);
+    }
+}
+
+#endif // SPAN_KERNEL_USE_SSE
+
+// AVX2 kernels: 4 doubles or 8 floats per register
+//*************************************************
+
+#ifdef SPAN_KERNEL_USE_AVX2
+
+SPAN_KERNEL_AVX2_TARGET
+static unsigned int depthTestSpanGroupAVX2(const SpanGroup& group, const float* storedDepths, double* correctZ, float* scaledDepths){
+    __m256d inverseZ = _mm256_set1_pd(group.inverseZ);
+    __m256d inverseZStep = _mm256_set1_pd(group.inverseZStep);
+    __m256d firstLaneOffset = _mm256_set1_pd(group.firstLaneOffset);
+    __m256d depthHither = _mm256_set1_pd(group.depthHither);
+    __m256d depthRange = _mm256_set1_pd(group.depthRange);
+    __m256d one = _mm256_set1_pd(1.0);
+
+    // Interpolate, and scale the depths of all 8 lanes as 2 quads:
+    __m256d lowOffsets = _mm256_add_pd(firstLaneOffset, _mm256_setr_pd(0, 1, 2, 3));   // Whole numbers, so these sums are exact
+    __m256d highOffsets = _mm256_add_pd(firstLaneOffset, _mm256_setr_pd(4, 5, 6, 7));
+    __m256d lowZ = _mm256_div_pd( one, _mm256_add_pd(inverseZ, _mm256_mul_pd(inverseZStep, lowOffsets)) );
+    __m256d highZ = _mm256_div_pd( one, _mm256_add_pd(inverseZ, _mm256_mul_pd(inverseZStep, highOffsets)) );
+    _mm256_storeu_pd(&correctZ[0], lowZ);
+    _mm256_storeu_pd(&correctZ[4], highZ);
+
+    __m128 lowDepths = _mm256_cvtpd_ps( _mm256_div_pd(_mm256_sub_pd(lowZ, depthHither), depthRange) );
+    __m128 highDepths = _mm256_cvtpd_ps( _mm256_div_pd(_mm256_sub_pd(highZ, depthHither), depthRange) );
+    __m256 depths = _mm256_insertf128_ps(_mm256_castps128_ps256(lowDepths), highDepths, 1);
+    _mm256_storeu_ps(scaledDepths, depths);
+
+    // Depth test:
+    unsigned int visibleMask = (unsigned int)_mm256_movemask_ps( _mm256_cmp_ps(depths, _mm256_loadu_ps(storedDepths), _CMP_LT_OQ) );
+
+    return visibleMask & group.laneMask;
+}
+
+SPAN_KERNEL_AVX2_TARGET
+static void writeSpanGroupDepthsAVX2(unsigned int mask, const float* scaledDepths, float* storedDepths){
+    // Expand the lanes' bits into a store mask:
+    __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i isWritten = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)mask), laneBits), laneBits);
+
+    _mm256_maskstore_ps(storedDepths, isWritten, _mm256_loadu_ps(scaledDepths));
+}
+
+#endif // SPAN_KERNEL_USE_AVX2
+
+// Dispatch:
+//**********
+
+// Interpolate and depth test a group of pixels against their stored depths
+unsigned int depthTestSpanGroup(const SpanGroup& group, const float* storedDepths, double* correctZ, float* scaledDepths){
+    switch (getSelectedLevel()){
+#ifdef SPAN_KERNEL_USE_AVX2
+    case spanKernelAVX2:
+        return depthTestSpanGroupAVX2(group, storedDepths, correctZ, scaledDepths);
+#endif
+#ifdef SPAN_KERNEL_USE_SSE
+    case spanKernelSSE2:
+        return depthTestSpanGroupSSE2(group, storedDepths, correctZ, scaledDepths);
+#endif
+    default:
+        return depthTestSpanGroupScalar(group, storedDepths, correctZ, scaledDepths);
+    }
+}
+
+// Store the scaled depths of the lanes in a mask
+void writeSpanGroupDepths(unsigned int mask, const float* scaledDepths, float* storedDepths){
+    switch (getSelectedLevel()){
+#ifdef SPAN_KERNEL_USE_AVX2
+    case spanKernelAVX2:
+        writeSpanGroupDepthsAVX2(mask, scaledDepths, storedDepths);
+        return;
+#endif
+#ifdef SPAN_KERNEL_USE_SSE
+    case spanKernelSSE2:
+        writeSpanGroupDepthsSSE2(mask, scaledDepths, storedDepths);
+        return;
+#endif
+    default:
+        writeSpanGroupDepthsScalar(mask, scaledDepths, storedDepths);
+    }
+}
+
+// Lane compaction table: The set lanes of each 8 bit mask, lowest first, and how many there are
+struct SpanCompactionTable
+{
+    unsigned char lanes[1 << SPAN_KERNEL_WIDTH][SPAN_KERNEL_WIDTH];
+    unsigned char counts[1 << SPAN_KERNEL_WIDTH];
+
+    SpanCompactionTable(){
+        for (int mask = 0; mask < (1 << SPAN_KERNEL_WIDTH); mask++){
+            int count = 0;
+            for (int lane = 0; lane < SPAN_KERNEL_WIDTH; lane++){
+                lanes[mask][lane] = 0;
+                if (mask & (1 << lane))
+                    lanes[mask][count++] = (unsigned char)lane;
+            }
+            counts[mask] = (unsigned char)count;
+        }
+    }
+};
+
+// Compact the lanes in a mask, without branching on the individual lanes
+int compactSpanGroupMask(unsigned int mask, int* lanes){
+    static const SpanCompactionTable table;
+
+    const unsigned char* maskLanes = table.lanes[mask & ((1 << SPAN_KERNEL_WIDTH) - 1)];
+    for (int i = 0; i < SPAN_KERNEL_WIDTH; i++)
+        lanes[i] = maskLanes[i];
+
+    return table.counts[mask & ((1 << SPAN_KERNEL_WIDTH) - 1)];
+}
@@ -0,0 +1,56 @@
+// Span kernel: Depth tests groups of 8 adjacent scanline pixels at once, vectorized with AVX2 or SSE2 (selected at runtime), with a scalar fallback
+// By Adam Badke
+
+#ifndef SPANKERNEL_H
+#define SPANKERNEL_H
+
+// Number of pixels tested together. Matches the depth buffer's tile width, so the stored depths of a group aligned to a tile are contiguous
+const int SPAN_KERNEL_WIDTH = 8;
+
+// Instruction sets the kernel can be run with, narrowest first
+enum SpanKernelLevel{
+    spanKernelScalar = 0,
+    spanKernelSSE2 = 1,
+    spanKernelAVX2 = 2
+};
+
+// A group of pixels along a scanline: Lane i is the i'th pixel from the left of the group
+struct SpanGroup
+{
+    double inverseZ;            // 1/z at the first pixel of the scanline, where z is the camera space depth
+    double inverseZStep;        // Change in 1/z from each pixel to the next
+    double firstLaneOffset;     // Pixels from the first pixel of the scanline to lane 0 (negative if lane 0 lies before it). Lane i has 1/z = inverseZ + inverseZStep * (firstLaneOffset + i)
+    double depthHither;         // Depths are scaled to (z - depthHither) / depthRange before they are tested, as in Renderer::getScaledZVal()
+    double depthRange;
+    unsigned int laneMask;      // The lanes that lie on the scanline. Other lanes never pass the depth test
+};
+
+// Get the widest instruction set supported by both the compiler and the CPU. Detected once, on first use
+SpanKernelLevel getSupportedSpanKernelLevel();
+
+// Get the instruction set used by the kernels. Defaults to the widest supported
+SpanKernelLevel getSpanKernelLevel();
+
+// Set the instruction set used by the kernels. Levels wider than the supported level are reduced to it
+// Note: Every level produces identical results. Intended for benchmarking
+void setSpanKernelLevel(SpanKernelLevel level);
+
+// Get the name of an instruction set, for reports
+const char* getSpanKernelLevelName(SpanKernelLevel level);
+
+// Get the mask of the lanes from firstLane to lastLane (inclusive). Lanes outside of the group are ignored
+unsigned int getSpanLaneMask(int firstLane, int lastLane);
+
+// Interpolate and depth test a group of pixels against their stored depths
+// Writes the camera space z and scaled depth of all SPAN_KERNEL_WIDTH lanes to correctZ and scaledDepths
+// Return: A mask of the lanes that are on the scanline, and in front of their stored depth
+unsigned int depthTestSpanGroup(const SpanGroup& group, const float* storedDepths, double* correctZ, float* scaledDepths);
+
+// Store the scaled depths of the lanes in a mask, leaving the other lanes' stored depths untouched
+void writeSpanGroupDepths(unsigned int mask, const float* scaledDepths, float* storedDepths);
+
+// Compact the lanes in a mask: Writes the indexes of the set lanes to lanes (which holds SPAN_KERNEL_WIDTH entries), lowest first
+// Return: The number of lanes in the mask
+int compactSpanGroupMask(unsigned int mask, int* lanes);
+
+#endif // SPANKERNEL_H
@@ -0,0 +1,67 @@
+// SpecularPower object: A specular exponent, with its evaluation strategy chosen once when the material is loaded
+// By Adam Badke
+
+#ifndef SPECULARPOWER_H
+#define SPECULARPOWER_H
+
+#include <cmath>
+
+// Largest exponent evaluated by repeated squaring. Larger (or fractional) exponents fall back to std::pow
+const double MAX_SQUARING_EXPONENT = 65535;
+
+class SpecularPower
+{
+public:
+    // Constructor
+    SpecularPower(double newExponent = 8);
+
+    // Raise a base to this exponent
+    // Pre-condition: base is in [0, 1], ie. the cosine of the angle between a view vector and a reflection vector
+    double evaluate(double base) const;
+
+    // Get the exponent
+    double getExponent() const;
+
+    // Check whether this exponent is evaluated by repeated squaring, rather than by std::pow
+    bool isIntegerExponent() const;
+
+private:
+    double exponent;
+    unsigned int integerExponent;   // The exponent, if it is a whole number. Its bits select the squares that are multiplied together
+    bool useSquaring;
+};
+
+// Inline definitions: Specular powers are evaluated once per light for every lit pixel
+//*************************************************************************************
+
+inline SpecularPower::SpecularPower(double newExponent){
+    exponent = newExponent;
+    useSquaring = newExponent >= 0 && newExponent <= MAX_SQUARING_EXPONENT && newExponent == std::floor(newExponent);
+    integerExponent = useSquaring ? (unsigned int)newExponent : 0;
+}
+
+inline double SpecularPower::evaluate(double base) const{
+    if (!useSquaring)
+        return std::pow(base, exponent);
+
+    // Exponentiation by squaring: Multiply together the squares selected by each set bit of the exponent
+    double result = 1.0;
+    double square = base;
+    for (unsigned int remainingBits = integerExponent; remainingBits != 0; remainingBits >>= 1){
+        if (remainingBits & 1)
+            result *= square;
+        square *= square;
+    }
+
+    return result;
+}
+
+inline double SpecularPower::getExponent() const{
+    return exponent;
+}
+
+inline bool SpecularPower::isIntegerExponent() const{
+    return useSquaring;
+}
+
+#endif // SPECULARPOWER_H
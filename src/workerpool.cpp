@@ -0,0 +1,87 @@
+// Worker pool object: A fixed set of threads that run a task together with the calling thread. Kept between frames, so threads aren't started per frame
+// By Adam Badke
+
+#include "workerpool.h"
+
+// Constructor
+WorkerPool::WorkerPool(){
+    currentTask = nullptr;
+    taskGeneration = 0;
+    numBusyWorkers = 0;
+    isStopping = false;
+}
+
+// Destructor
+WorkerPool::~WorkerPool(){
+    stopWorkers();
+}
+
+// Restart the pool with numWorkers workers
+void WorkerPool::resize(unsigned int numWorkers){
+    if (numWorkers == workers.size())
+        return;
+
+    stopWorkers();
+
+    // Workers wait for the next task posted. Tasks posted before they've started running are still theirs to run
+    for (unsigned int i = 0; i < numWorkers; i++)
+        workers.emplace_back(&WorkerPool::workerLoop, this, i, taskGeneration);
+}
+
+// Get the number of workers in the pool
+unsigned int WorkerPool::size() const{
+    return (unsigned int)workers.size();
+}
+
+// Run a task on every worker and on the calling thread at once, and wait for all of them to finish
+void WorkerPool::run(const std::function<void(unsigned int)>& task){
+    {
+        std::lock_guard<std::mutex> poolLock(poolMutex);
+        currentTask = &task;
+        numBusyWorkers = (unsigned int)workers.size();
+        taskGeneration++;
+    }
+    taskStarted.notify_all();
+
+    task((unsigned int)workers.size());
+
+    std::unique_lock<std::mutex> poolLock(poolMutex);
+    taskFinished.wait(poolLock, [this]{ return numBusyWorkers == 0; });
+    currentTask = nullptr;
+}
+
+// Wait for tasks, and run them, until the worker is stopped
+void WorkerPool::workerLoop(unsigned int workerIndex, unsigned int finishedGeneration){
+    std::unique_lock<std::mutex> poolLock(poolMutex);
+
+    while (true){
+        taskStarted.wait(poolLock, [this, finishedGeneration]{ return isStopping || taskGeneration != finishedGeneration; });
+        if (isStopping)
+            return;
+
+        finishedGeneration = taskGeneration;
+        const std::function<void(unsigned int)>* task = currentTask;
+
+        poolLock.unlock();
+        (*task)(workerIndex);
+        poolLock.lock();
+
+        if (--numBusyWorkers == 0)
+            taskFinished.notify_one();
+    }
+}
+
+// Stop and join every worker
+void WorkerPool::stopWorkers(){
+    {
+        std::lock_guard<std::mutex> poolLock(poolMutex);
+        isStopping = true;
+    }
+    taskStarted.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+    workers.clear();
+
+    isStopping = false;
+}
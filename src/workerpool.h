@@ -0,0 +1,58 @@
+// Worker pool object: A fixed set of threads that run a task together with the calling thread. Kept between frames, so threads aren't started per frame
+// By Adam Badke
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+class WorkerPool
+{
+public:
+    // Constructor: Starts with no workers
+    WorkerPool();
+
+    // Destructor: Stops and joins every worker
+    ~WorkerPool();
+
+    // Restart the pool with numWorkers workers. Does nothing if it already has that many
+    // Precondition: No task is running
+    void resize(unsigned int numWorkers);
+
+    // Get the number of workers in the pool
+    unsigned int size() const;
+
+    // Run a task on every worker and on the calling thread at once, and wait for all of them to finish
+    // Workers are passed their index, from 0 to size() - 1. The calling thread is passed size()
+    void run(const std::function<void(unsigned int)>& task);
+
+private:
+    // Worker pools cannot be copied
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Wait for tasks posted after finishedGeneration, and run them, until the worker is stopped
+    void workerLoop(unsigned int workerIndex, unsigned int finishedGeneration);
+
+    // Stop and join every worker
+    void stopWorkers();
+
+    vector<std::thread> workers;
+
+    std::mutex poolMutex;
+    std::condition_variable taskStarted;    // Signalled when a task is posted, or workers are stopped
+    std::condition_variable taskFinished;   // Signalled when the last worker finishes the current task
+
+    const std::function<void(unsigned int)>* currentTask;
+    unsigned int taskGeneration;            // Incremented each time a task is posted. Workers run each generation once
+    unsigned int numBusyWorkers;            // Workers still running the current task
+    bool isStopping;                        // Set to make every worker exit when it next wakes
+};
+
+#endif // WORKERPOOL_H